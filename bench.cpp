@@ -0,0 +1,623 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "arcball_camera.h"
+#include "cpu_profiler.h"
+#include "gpu_memory_tracker.h"
+#include "pipeline_disk_cache.h"
+#include "renderer.h"
+#include "surface_config.h"
+#include "wgpu_call_counters.h"
+#include <glm/ext.hpp>
+#include <glm/glm.hpp>
+
+#include <dawn/dawn_proc.h>
+#include <dawn/webgpu_cpp.h>
+
+/* Headless benchmark of the frame loop. Renders the same scene as the app's
+ * loop_iteration into an offscreen texture instead of a swap chain for a fixed
+ * number of frames and reports the frame time statistics as JSON, so it can run
+ * on machines without a display. The Null backend measures just the CPU overhead
+ * of the renderer and Dawn, while a software Vulkan adapter (SwiftShader or
+ * lavapipe) also executes the GPU work.
+ *
+ * The JSON report is written to stdout, or the --output file, and all other
+ * logging goes to stderr.
+ */
+
+namespace {
+
+struct Backend {
+    const char *name;
+    wgpu::BackendType type;
+    bool cpu_only;
+};
+
+const Backend backends[] = {
+    {"null", wgpu::BackendType::Null, false},
+    {"vulkan", wgpu::BackendType::Vulkan, false},
+    {"software", wgpu::BackendType::Vulkan, true},
+    {"d3d12", wgpu::BackendType::D3D12, false},
+    {"metal", wgpu::BackendType::Metal, false},
+};
+
+struct FrameTimeStats {
+    double mean = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double stddev = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    // The mean frame time of the slowest 1% and 0.1% of frames, i.e., the "1% lows"
+    double low_1_percent = 0.0;
+    double low_0_1_percent = 0.0;
+};
+
+// The nearest-rank percentile of the sorted frame times
+double percentile(const std::vector<double> &sorted, const double p)
+{
+    const size_t rank = std::ceil(p / 100.0 * sorted.size());
+    return sorted[std::min(std::max(rank, size_t(1)), sorted.size()) - 1];
+}
+
+// The mean of the slowest fraction of the sorted frame times, at least one frame
+double slowest_mean(const std::vector<double> &sorted, const double fraction)
+{
+    const size_t n = std::max(size_t(sorted.size() * fraction), size_t(1));
+    double sum = 0.0;
+    for (size_t i = sorted.size() - n; i < sorted.size(); ++i) {
+        sum += sorted[i];
+    }
+    return sum / n;
+}
+
+FrameTimeStats compute_stats(std::vector<double> frame_times)
+{
+    FrameTimeStats stats;
+    if (frame_times.empty()) {
+        return stats;
+    }
+    std::sort(frame_times.begin(), frame_times.end());
+
+    double sum = 0.0;
+    for (const auto &t : frame_times) {
+        sum += t;
+    }
+    stats.mean = sum / frame_times.size();
+
+    double sq_sum = 0.0;
+    for (const auto &t : frame_times) {
+        sq_sum += (t - stats.mean) * (t - stats.mean);
+    }
+    stats.stddev = std::sqrt(sq_sum / frame_times.size());
+
+    stats.min = frame_times.front();
+    stats.max = frame_times.back();
+    stats.p50 = percentile(frame_times, 50);
+    stats.p90 = percentile(frame_times, 90);
+    stats.p95 = percentile(frame_times, 95);
+    stats.p99 = percentile(frame_times, 99);
+    stats.low_1_percent = slowest_mean(frame_times, 0.01);
+    stats.low_0_1_percent = slowest_mean(frame_times, 0.001);
+    return stats;
+}
+
+// Escape the quotes, backslashes and control characters JSON strings can't contain
+std::string json_escape(const std::string &str)
+{
+    std::string escaped;
+    for (const auto &c : str) {
+        switch (c) {
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\b':
+            escaped += "\\b";
+            break;
+        case '\f':
+            escaped += "\\f";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        case '\r':
+            escaped += "\\r";
+            break;
+        case '\t':
+            escaped += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                const char *hex = "0123456789abcdef";
+                escaped += "\\u00";
+                escaped.push_back(hex[(c >> 4) & 0xf]);
+                escaped.push_back(hex[c & 0xf]);
+            } else {
+                escaped.push_back(c);
+            }
+            break;
+        }
+    }
+    return escaped;
+}
+
+// Render a frame with the camera orbited a bit further, so the view params are
+// uploaded every frame, as they would be while the user is interacting with the app.
+// Returns the CPU time spent recording and submitting the frame in milliseconds
+double render_orbit_frame(Renderer *renderer,
+                          ArcballCamera &camera,
+                          const glm::mat4 &proj,
+                          const wgpu::TextureView &target)
+{
+    // Process any completed async operations, e.g., staging buffer maps and error scopes
+    renderer->instance.ProcessEvents();
+    renderer->errors.report(std::cerr);
+    // Every frame must be drawn to be measured, so if the pacer says to skip the
+    // frame, wait until the GPU frees a slot instead of recording anything
+    while (!renderer->frame_pacer.begin_frame()) {
+        renderer->instance.ProcessEvents();
+    }
+
+    camera.rotate(glm::vec2(0.f), glm::vec2(0.01f, 0.f));
+    const glm::mat4 proj_view = proj * camera.transform();
+    const auto start = std::chrono::steady_clock::now();
+    render_frame(renderer, target, &proj_view);
+    const auto end = std::chrono::steady_clock::now();
+
+    renderer->frame_pacer.end_frame();
+    wgpu_counters_end_frame();
+    gpu_memory_end_frame();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void print_usage()
+{
+    std::cerr << "Usage: wgpu-bench [options]\n"
+              << "  --backend NAME          null, vulkan, software, d3d12 or metal "
+                 "(default null)\n"
+              << "  --frames N              Frames to measure (default 1000)\n"
+              << "  --warmup N              Frames to render before measuring (default 60)\n"
+              << "  --size W H              Size of the render target (default 1280 720)\n"
+              << "  --format NAME           bgra8unorm, rgba8unorm or rgba16float\n"
+              << "  --objects N             Number of objects in the scene (default 1)\n"
+              << "  --mesh FILE             Draw each object with the OBJ, PLY or glTF mesh\n"
+              << "  --mesh-threads N        Threads loading the mesh (default one per core)\n"
+              << "  --no-mesh-optimize      Skip deduplicating and reordering the mesh\n"
+              << "  --position-error E      Max vertex position error as a fraction of the "
+                 "mesh's size (default 1e-4)\n"
+              << "  --no-quantize           Keep the vertex attributes at full precision\n"
+              << "  --record-threads N      Threads to record the scene with (default 1)\n"
+              << "  --frames-in-flight N    Max frames the CPU can get ahead (default 2)\n"
+              << "  --no-bundles            Record the draws each frame\n"
+              << "  --no-cluster-cull       Draw whole meshes instead of culling meshlets\n"
+              << "  --no-gpu-driven         Draw each object from the CPU instead of culling "
+                 "and compacting the draws on the GPU\n"
+              << "  --pipeline-cache DIR    Persist compiled shaders and pipelines in DIR\n"
+              << "  --shader-features LIST  Scene shader features to enable, e.g. "
+                 "VERTEX_COLORS,SRGB_ENCODE,LIGHTING\n"
+              << "  --precompile-variants   Compile every scene shader variant at startup\n"
+              << "  --output FILE           Write the JSON report to FILE instead of stdout\n"
+              << "  --trace FILE            Write the CPU profiler's trace to FILE\n";
+}
+
+}
+
+int main(int argc, const char **argv)
+{
+    const Backend *backend = &backends[0];
+    uint32_t num_frames = 1000;
+    uint32_t warmup_frames = 60;
+    uint32_t width = 1280;
+    uint32_t height = 720;
+    wgpu::TextureFormat format = wgpu::TextureFormat::BGRA8Unorm;
+    uint32_t num_objects = 1;
+    uint32_t record_threads = 1;
+    uint32_t max_frames_in_flight = 2;
+    bool use_bundles = true;
+    bool cluster_culling = true;
+    bool gpu_driven = true;
+    std::string output_path;
+    std::string trace_path;
+    std::string pipeline_cache_dir;
+    std::string shader_features;
+    bool set_shader_features = false;
+    bool precompile_variants = false;
+    std::string mesh_path;
+    MeshLoadOptions mesh_options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            ++i;
+            backend = nullptr;
+            for (const auto &b : backends) {
+                if (std::strcmp(argv[i], b.name) == 0) {
+                    backend = &b;
+                }
+            }
+            if (!backend) {
+                std::cerr << "Unknown backend " << argv[i] << "\n";
+                print_usage();
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            num_frames = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup_frames = std::max(std::atoi(argv[++i]), 0);
+        } else if (std::strcmp(argv[i], "--size") == 0 && i + 2 < argc) {
+            width = std::max(std::atoi(argv[++i]), 1);
+            height = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (!parse_surface_format(argv[++i], format)) {
+                std::cerr << "Unknown format " << argv[i] << "\n";
+                print_usage();
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--objects") == 0 && i + 1 < argc) {
+            num_objects = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--mesh") == 0 && i + 1 < argc) {
+            mesh_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--mesh-threads") == 0 && i + 1 < argc) {
+            mesh_options.num_threads = std::max(std::atoi(argv[++i]), 0);
+        } else if (std::strcmp(argv[i], "--no-mesh-optimize") == 0) {
+            mesh_options.optimize = false;
+        } else if (std::strcmp(argv[i], "--position-error") == 0 && i + 1 < argc) {
+            mesh_options.error_bounds.position = std::max(std::atof(argv[++i]), 0.0);
+        } else if (std::strcmp(argv[i], "--no-quantize") == 0) {
+            mesh_options.error_bounds.position = 0.f;
+            mesh_options.error_bounds.color = 0.f;
+            mesh_options.error_bounds.normal_degrees = 0.f;
+        } else if (std::strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc) {
+            record_threads = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+            max_frames_in_flight = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--no-bundles") == 0) {
+            use_bundles = false;
+        } else if (std::strcmp(argv[i], "--no-cluster-cull") == 0) {
+            cluster_culling = false;
+        } else if (std::strcmp(argv[i], "--no-gpu-driven") == 0) {
+            gpu_driven = false;
+        } else if (std::strcmp(argv[i], "--pipeline-cache") == 0 && i + 1 < argc) {
+            pipeline_cache_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--shader-features") == 0 && i + 1 < argc) {
+            shader_features = argv[++i];
+            set_shader_features = true;
+        } else if (std::strcmp(argv[i], "--precompile-variants") == 0) {
+            precompile_variants = true;
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else {
+            print_usage();
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    cpu_profiler_set_thread_name("main");
+
+    // Off by default so each run measures a cold start unless asked otherwise.
+    // The cache is the instance's platform, so it must outlive the instance
+    std::unique_ptr<PipelineDiskCache> pipeline_cache;
+    dawn::native::DawnInstanceDescriptor dawn_instance_desc;
+    if (!pipeline_cache_dir.empty()) {
+        pipeline_cache.reset(new PipelineDiskCache(pipeline_cache_dir));
+        dawn_instance_desc.platform = pipeline_cache.get();
+    }
+
+    // Timed waits are needed for the frame pacer to block on submitted work
+    wgpu::InstanceDescriptor instance_desc;
+    instance_desc.nextInChain = &dawn_instance_desc;
+    instance_desc.features.timedWaitAnyEnable = true;
+    dawn::native::Instance dawn_instance(
+        reinterpret_cast<const WGPUInstanceDescriptor *>(&instance_desc));
+
+    dawn::native::Adapter adapter;
+    try {
+        adapter = request_adapter(dawn_instance, backend->type, backend->cpu_only);
+    } catch (const std::runtime_error &) {
+        std::cerr << "No " << backend->name << " adapter found\n";
+        return 1;
+    }
+    wgpu::AdapterProperties adapter_props;
+    adapter.GetProperties(&adapter_props);
+
+    Renderer renderer;
+    renderer.instance = wgpu::Instance(dawn_instance.Get());
+    renderer.device = create_device(adapter, record_threads > 1);
+    if (record_threads > 1 &&
+        !renderer.device.HasFeature(wgpu::FeatureName::ImplicitDeviceSynchronization)) {
+        std::cerr << "ImplicitDeviceSynchronization is not supported, "
+                  << "falling back to single threaded recording\n";
+        record_threads = 1;
+    }
+    renderer.errors = ErrorReporter(renderer.device);
+    renderer.object_cache = ObjectCache(renderer.device);
+    renderer.pipelines = PipelineLoader(renderer.device);
+
+    renderer.queue = renderer.device.GetQueue();
+    renderer.staging_ring = StagingRing(renderer.device);
+    renderer.frame_pacer = FramePacer(renderer.instance, renderer.queue, max_frames_in_flight);
+    renderer.recorder.reset(new ParallelRecorder(record_threads));
+    renderer.use_bundles = use_bundles;
+    renderer.cluster_culling = cluster_culling;
+    renderer.gpu_driven = gpu_driven;
+    renderer.vertex_error_bounds = mesh_options.error_bounds;
+    renderer.render_graph = RenderGraph(renderer.device);
+    renderer.gpu_profiler = GpuProfiler(renderer.instance, renderer.device);
+
+    // The mesh load is reported on its own, separate from startup
+    MeshLoadStats mesh_stats;
+    if (!mesh_path.empty()) {
+        try {
+            renderer.mesh = load_mesh(renderer.device, mesh_path, mesh_options, &mesh_stats);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        mesh_stats.print(std::cerr);
+    }
+
+    // Startup is timed from creating the scene, the device and adapter setup is
+    // the same regardless of the scene
+    using Clock = std::chrono::steady_clock;
+    const auto scene_start = Clock::now();
+    if (set_shader_features &&
+        !renderer.scene_variants.parse_features(shader_features, renderer.scene_variant)) {
+        std::cerr << "Unknown shader feature in " << shader_features << "\n";
+        print_usage();
+        return 1;
+    }
+    create_scene(&renderer, format, num_objects);
+    if (precompile_variants) {
+        precompile_scene_variants(&renderer);
+    }
+    if (pipeline_cache) {
+        prewarm_pipelines(&renderer, pipeline_cache->load_prewarm_list());
+    }
+
+    // Stands in for the swap chain image
+    wgpu::TextureDescriptor texture_desc;
+    texture_desc.format = format;
+    texture_desc.size.width = width;
+    texture_desc.size.height = height;
+    texture_desc.usage = wgpu::TextureUsage::RenderAttachment;
+    const wgpu::Texture texture =
+        gpu_memory_create_texture(renderer.device, texture_desc, "bench_target");
+    const wgpu::TextureView target = texture.CreateView();
+
+    const ArcballCamera start_camera(glm::vec3(0, 0, -2.5), glm::vec3(0), glm::vec3(0, 1, 0));
+    ArcballCamera camera = start_camera;
+    const glm::mat4 proj = glm::perspective(
+        glm::radians(50.f), static_cast<float>(width) / height, 0.1f, 100.f);
+
+    std::cerr << "Rendering " << warmup_frames << " warmup and " << num_frames
+              << " measured frames on " << adapter_props.name << " (" << backend->name
+              << ")\n";
+
+    // Frame times are measured from the start of one frame to the next, including
+    // any time spent blocked by the frame pacer on the GPU, like the app's frame rate
+    std::vector<double> frame_times;
+    frame_times.reserve(num_frames);
+    // The CPU time recording and submitting each frame, without waiting on the pacer,
+    // which the GPU driven draws keep flat as the objects grow
+    std::vector<double> record_times;
+    record_times.reserve(num_frames);
+    double first_frame_ms = 0.0;
+    double pipelines_ready_ms = 0.0;
+    for (uint32_t i = 0; i < warmup_frames + num_frames; ++i) {
+        CPU_ZONE("frame");
+        const auto start = Clock::now();
+        const double record_ms = render_orbit_frame(&renderer, camera, proj, target);
+        if (i >= warmup_frames) {
+            frame_times.push_back(
+                std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            record_times.push_back(record_ms);
+        }
+
+        // The first frame is drawn without waiting on the pipelines, the frames
+        // after it wait for them so every measured frame draws the full scene
+        if (i == 0) {
+            first_frame_ms =
+                std::chrono::duration<double, std::milli>(Clock::now() - scene_start).count();
+            wait_for_pipelines(&renderer);
+            pipelines_ready_ms =
+                std::chrono::duration<double, std::milli>(Clock::now() - scene_start).count();
+        }
+    }
+
+    // Render the same frames again without any culling, so the GPU time the culling
+    // saves is measured over the same views. The GPU driven draws would otherwise
+    // fall back to culling whole objects, so they're turned off too, and measured
+    // separately as a second baseline. The scene's GPU time includes the culling pass
+    const ClusterCuller &culler = renderer.cluster_culler;
+    const bool cull_clusters = cluster_culling && culler.is_enabled();
+    const double culled_cluster_percent = culler.average_culled_cluster_percent();
+    const double culled_triangle_percent = culler.average_culled_triangle_percent();
+    const double culled_scene_gpu_ms = renderer.gpu_profiler.average_ms("scene");
+    double unculled_scene_gpu_ms = 0.0;
+    double object_culled_scene_gpu_ms = 0.0;
+    // The objects are only culled as a whole when their meshlets aren't
+    const bool gpu_driven_enabled =
+        gpu_driven && (cull_clusters || renderer.object_culler.is_enabled());
+    const uint64_t scene_draw_calls = renderer.scene_draw_calls;
+    const double culled_object_percent =
+        cull_clusters ? 0.0 : renderer.object_culler.average_culled_cluster_percent();
+    const bool object_culling = gpu_driven && renderer.object_culler.is_enabled();
+    auto rerender_scene_gpu_ms = [&]() {
+        renderer.gpu_profiler.reset_stats();
+        camera = start_camera;
+        for (uint32_t i = 0; i < warmup_frames + num_frames; ++i) {
+            render_orbit_frame(&renderer, camera, proj, target);
+        }
+        return renderer.gpu_profiler.average_ms("scene");
+    };
+    if (cull_clusters) {
+        std::cerr << "Rendering the frames again without culling\n";
+        renderer.cluster_culling = false;
+        renderer.gpu_driven = false;
+        unculled_scene_gpu_ms = rerender_scene_gpu_ms();
+        if (object_culling) {
+            std::cerr << "Rendering the frames again culling whole objects\n";
+            renderer.gpu_driven = true;
+            object_culled_scene_gpu_ms = rerender_scene_gpu_ms();
+        }
+        renderer.cluster_culling = true;
+        renderer.gpu_driven = gpu_driven;
+        std::cerr << "Cluster culling culled " << culled_triangle_percent
+                  << "% of triangles, scene GPU time " << unculled_scene_gpu_ms << "ms -> "
+                  << culled_scene_gpu_ms << "ms\n";
+    }
+
+    // Pick up the errors from the last frame's scopes
+    renderer.instance.ProcessEvents();
+    renderer.errors.report(std::cerr);
+
+    const FrameTimeStats stats = compute_stats(frame_times);
+    const FrameTimeStats record_stats = compute_stats(record_times);
+    const GpuMemoryStats memory = gpu_memory_total();
+    const PipelineDiskCache::Stats cache_stats =
+        pipeline_cache ? pipeline_cache->get_stats() : PipelineDiskCache::Stats();
+
+    std::ofstream fout;
+    if (!output_path.empty()) {
+        fout.open(output_path.c_str());
+        if (!fout) {
+            std::cerr << "Failed to open " << output_path << "\n";
+            return 1;
+        }
+    }
+    std::ostream &os = output_path.empty() ? std::cout : fout;
+    const Mesh &mesh = renderer.mesh;
+    const uint32_t mesh_triangles =
+        (mesh.index_buf ? mesh.num_indices : mesh.num_vertices) / 3;
+    os << "{\n"
+       << "  \"backend\": \"" << backend->name << "\",\n"
+       << "  \"adapter\": \"" << json_escape(adapter_props.name) << "\",\n"
+       << "  \"width\": " << width << ",\n"
+       << "  \"height\": " << height << ",\n"
+       << "  \"format\": \"" << surface_format_name(format) << "\",\n"
+       << "  \"objects\": " << num_objects << ",\n"
+       << "  \"mesh\": {\n"
+       << "    \"path\": \"" << json_escape(mesh_path) << "\",\n"
+       << "    \"vertices\": " << mesh.num_vertices << ",\n"
+       << "    \"triangles\": " << mesh_triangles << ",\n"
+       << "    \"vertex_format\": \"" << mesh.format.name() << "\",\n"
+       << "    \"vertex_bytes\": " << mesh.format.stride << ",\n"
+       << "    \"vertex_buffer_bytes\": " << uint64_t(mesh.num_vertices) * mesh.format.stride
+       << ",\n"
+       << "    \"file_bytes\": " << mesh_stats.file_bytes << ",\n"
+       << "    \"load_threads\": " << mesh_stats.num_threads << ",\n"
+       << "    \"load_ms\": " << mesh_stats.load_ms << ",\n"
+       << "    \"load_mb_per_s\": " << mesh_stats.throughput_mb_s() << ",\n"
+       << "    \"optimized\": " << (mesh_stats.optimized ? "true" : "false") << ",\n"
+       << "    \"optimize_ms\": " << mesh_stats.optimize.total_ms() << ",\n"
+       << "    \"optimize_mtris_per_s\": " << mesh_stats.optimize.throughput_mtris_s() << ",\n"
+       << "    \"dedup_ms\": " << mesh_stats.optimize.dedup_ms << ",\n"
+       << "    \"vertex_cache_ms\": " << mesh_stats.optimize.cache_ms << ",\n"
+       << "    \"vertex_fetch_ms\": " << mesh_stats.optimize.fetch_ms << ",\n"
+       << "    \"vertex_shrink_ms\": " << mesh_stats.shrink_ms << ",\n"
+       << "    \"vertices_before_optimize\": " << mesh_stats.optimize.vertices_before << ",\n"
+       << "    \"acmr_before\": " << mesh_stats.optimize.cache_before.acmr << ",\n"
+       << "    \"acmr_after\": " << mesh_stats.optimize.cache_after.acmr << ",\n"
+       << "    \"atvr_before\": " << mesh_stats.optimize.cache_before.atvr << ",\n"
+       << "    \"atvr_after\": " << mesh_stats.optimize.cache_after.atvr << ",\n"
+       << "    \"meshlets\": " << mesh.num_meshlets << ",\n"
+       << "    \"meshlet_ms\": " << mesh_stats.meshlet_ms << ",\n"
+       << "    \"peak_rss_bytes\": " << mesh_stats.peak_rss_bytes << ",\n"
+       << "    \"peak_rss_growth_bytes\": " << mesh_stats.peak_rss_growth_bytes << "\n"
+       << "  },\n"
+       << "  \"record_threads\": " << record_threads << ",\n"
+       << "  \"frames_in_flight\": " << max_frames_in_flight << ",\n"
+       << "  \"bundles\": " << (use_bundles ? "true" : "false") << ",\n"
+       << "  \"cluster_culling\": {\n"
+       << "    \"enabled\": " << (cull_clusters ? "true" : "false") << ",\n"
+       << "    \"culled_cluster_percent\": " << culled_cluster_percent << ",\n"
+       << "    \"culled_triangle_percent\": " << culled_triangle_percent << ",\n"
+       << "    \"scene_gpu_ms\": " << culled_scene_gpu_ms << ",\n"
+       << "    \"scene_gpu_ms_without_culling\": " << unculled_scene_gpu_ms << ",\n"
+       << "    \"gpu_ms_saved\": "
+       << (cull_clusters ? unculled_scene_gpu_ms - culled_scene_gpu_ms : 0.0) << ",\n"
+       << "    \"scene_gpu_ms_with_object_culling\": " << object_culled_scene_gpu_ms << ",\n"
+       << "    \"gpu_ms_saved_over_object_culling\": "
+       << (cull_clusters && object_culling ? object_culled_scene_gpu_ms - culled_scene_gpu_ms
+                                           : 0.0)
+       << "\n"
+       << "  },\n"
+       << "  \"gpu_driven\": {\n"
+       << "    \"enabled\": " << (gpu_driven_enabled ? "true" : "false") << ",\n"
+       << "    \"draw_calls\": " << scene_draw_calls << ",\n"
+       << "    \"culled_object_percent\": " << culled_object_percent << "\n"
+       << "  },\n"
+       << "  \"shader_variant\": \""
+       << renderer.scene_variants.name(renderer.scene_variant) << "\",\n"
+       << "  \"warmup_frames\": " << warmup_frames << ",\n"
+       << "  \"frames\": " << frame_times.size() << ",\n"
+       << "  \"errors\": " << renderer.errors.num_errors() << ",\n"
+       << "  \"time_to_first_frame_ms\": " << first_frame_ms << ",\n"
+       << "  \"time_to_pipelines_ready_ms\": " << pipelines_ready_ms << ",\n"
+       << "  \"pipeline_cache\": {\n"
+       << "    \"enabled\": " << (pipeline_cache ? "true" : "false") << ",\n"
+       << "    \"warm\": " << (pipeline_cache && pipeline_cache->is_warm() ? "true" : "false")
+       << ",\n"
+       << "    \"hits\": " << cache_stats.num_hits << ",\n"
+       << "    \"misses\": " << cache_stats.num_misses << ",\n"
+       << "    \"hit_rate\": " << (pipeline_cache ? pipeline_cache->hit_rate() : 0.0) << "\n"
+       << "  },\n"
+       << "  \"frame_time_ms\": {\n"
+       << "    \"mean\": " << stats.mean << ",\n"
+       << "    \"stddev\": " << stats.stddev << ",\n"
+       << "    \"min\": " << stats.min << ",\n"
+       << "    \"max\": " << stats.max << ",\n"
+       << "    \"p50\": " << stats.p50 << ",\n"
+       << "    \"p90\": " << stats.p90 << ",\n"
+       << "    \"p95\": " << stats.p95 << ",\n"
+       << "    \"p99\": " << stats.p99 << "\n"
+       << "  },\n"
+       << "  \"record_time_ms\": {\n"
+       << "    \"mean\": " << record_stats.mean << ",\n"
+       << "    \"p50\": " << record_stats.p50 << ",\n"
+       << "    \"p99\": " << record_stats.p99 << "\n"
+       << "  },\n"
+       << "  \"fps\": {\n"
+       << "    \"mean\": " << 1000.0 / stats.mean << ",\n"
+       << "    \"low_1_percent\": " << 1000.0 / stats.low_1_percent << ",\n"
+       << "    \"low_0_1_percent\": " << 1000.0 / stats.low_0_1_percent << "\n"
+       << "  },\n"
+       << "  \"gpu_memory_bytes\": {\n"
+       << "    \"live\": " << memory.live_bytes << ",\n"
+       << "    \"peak\": " << memory.peak_bytes << ",\n"
+       << "    \"allocated\": " << memory.allocated_bytes << "\n"
+       << "  }\n"
+       << "}\n";
+
+    renderer.frame_pacer.print_summary(std::cerr);
+    renderer.object_cache.print_stats(std::cerr);
+    renderer.pipelines.print_stats(std::cerr);
+    if (pipeline_cache) {
+        pipeline_cache->print_stats(std::cerr);
+        pipeline_cache->save_prewarm_list(renderer.pipelines.ready_names());
+    }
+    renderer.gpu_profiler.print_summary(std::cerr);
+    renderer.cluster_culler.print_summary(std::cerr);
+    renderer.object_culler.print_summary(std::cerr);
+    wgpu_counters_print_summary(std::cerr);
+    gpu_memory_print_summary(std::cerr);
+    renderer.errors.print_summary(std::cerr);
+    if (!trace_path.empty() && !cpu_profiler_write_trace(trace_path)) {
+        std::cerr << "Failed to write CPU profile trace to " << trace_path << "\n";
+    }
+    return os ? 0 : 1;
+}
@@ -0,0 +1,421 @@
+#include "cluster_culler.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include "gpu_memory_tracker.h"
+
+namespace {
+
+// The workgroup size of cull_clusters in shaders/cluster_cull.wgsl
+const uint32_t CULL_WORKGROUP_SIZE = 64;
+
+// Matches the CullParams struct in shaders/cluster_cull.wgsl
+struct CullParams {
+    // Left, right, bottom, top, near and far, with normals pointing inside
+    glm::vec4 planes[6];
+    glm::vec4 camera_position;
+    uint32_t num_meshlets = 0;
+    uint32_t num_objects = 0;
+    // The threads in a row of the dispatch, to flatten 2D dispatches
+    uint32_t dispatch_width = 0;
+    // The draw_instances entries between the meshlets' lists
+    uint32_t instance_stride = 0;
+};
+
+// The visible clusters and the low and high words of the visible triangles,
+// matches CullCounts in the shader
+const uint64_t COUNTS_SIZE = 3 * sizeof(uint32_t);
+
+double culled_percent(const uint64_t total, const uint64_t visible)
+{
+    return total > 0 ? 100.0 * (total - std::min(visible, total)) / total : 0.0;
+}
+
+}
+
+double ClusterCullStats::culled_cluster_percent() const
+{
+    return culled_percent(num_clusters, visible_clusters);
+}
+
+double ClusterCullStats::culled_triangle_percent() const
+{
+    return culled_percent(num_triangles, visible_triangles);
+}
+
+ClusterCuller::ClusterCuller(const wgpu::Instance &instance,
+                             const wgpu::Device &device,
+                             const Mesh &mesh,
+                             const wgpu::Buffer &object_buf,
+                             const uint32_t num_objects,
+                             const wgpu::BindGroupLayout &draw_layout,
+                             const bool whole_objects,
+                             uint32_t num_readbacks)
+    : device(device),
+      whole_objects(whole_objects),
+      num_meshlets(whole_objects ? 1 : mesh.num_meshlets),
+      num_objects(num_objects),
+      mesh_triangles(mesh.num_indices / 3),
+      object_buf(object_buf)
+{
+    if (whole_objects && !mesh.index_buf) {
+        disabled_reason = "the mesh isn't indexed";
+        return;
+    }
+    if (num_meshlets == 0 || num_objects == 0) {
+        disabled_reason = "the mesh has no meshlets";
+        return;
+    }
+
+    wgpu::SupportedLimits limits;
+    device.GetLimits(&limits);
+    const uint64_t num_clusters = uint64_t(num_meshlets) * num_objects;
+    const uint64_t draw_args_size = num_clusters * DRAW_ARGS_STRIDE;
+    const uint64_t object_size = uint64_t(num_objects) * sizeof(glm::mat4);
+    if (std::max(draw_args_size, object_size) > limits.limits.maxStorageBufferBindingSize) {
+        disabled_reason = "the draw arguments exceed the max storage buffer binding size";
+        return;
+    }
+    const uint32_t offset_alignment = limits.limits.minStorageBufferOffsetAlignment;
+    const uint64_t instances_size = uint64_t(num_objects) * sizeof(uint32_t);
+    const uint64_t stride =
+        (instances_size + offset_alignment - 1) / offset_alignment * offset_alignment;
+    const uint64_t draw_instances_size = stride * num_meshlets;
+    if (draw_instances_size > limits.limits.maxStorageBufferBindingSize ||
+        draw_instances_size > std::numeric_limits<uint32_t>::max()) {
+        disabled_reason = "the compacted draws exceed the max storage buffer binding size";
+        return;
+    }
+    instance_stride = static_cast<uint32_t>(stride);
+
+    const uint64_t num_groups = (num_clusters + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE;
+    const uint32_t max_groups = limits.limits.maxComputeWorkgroupsPerDimension;
+    dispatch_x = static_cast<uint32_t>(std::min(num_groups, uint64_t(max_groups)));
+    const uint64_t num_rows = (num_groups + dispatch_x - 1) / dispatch_x;
+    reset_groups = (num_meshlets + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE;
+    if (num_rows > max_groups || reset_groups > max_groups) {
+        disabled_reason = "the clusters exceed the max compute workgroups";
+        return;
+    }
+    dispatch_y = static_cast<uint32_t>(num_rows);
+    enabled = true;
+
+    // Until the first view is set every cluster is inside the planes, and the
+    // camera at the origin
+    CullParams params;
+    for (auto &p : params.planes) {
+        p = glm::vec4(0.f, 0.f, 0.f, 1.f);
+    }
+    params.camera_position = glm::vec4(0.f, 0.f, 0.f, 1.f);
+    params.num_meshlets = num_meshlets;
+    params.num_objects = num_objects;
+    params.dispatch_width = dispatch_x * CULL_WORKGROUP_SIZE;
+    params.instance_stride = instance_stride / sizeof(uint32_t);
+
+    wgpu::BufferDescriptor buffer_desc;
+    buffer_desc.mappedAtCreation = true;
+    buffer_desc.size = sizeof(CullParams);
+    buffer_desc.usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::CopyDst;
+    cull_param_buf = gpu_memory_create_buffer(device, buffer_desc, "cluster_cull_params");
+    std::memcpy(cull_param_buf.GetMappedRange(), &params, sizeof(CullParams));
+    cull_param_buf.Unmap();
+
+    // The whole mesh is a single cluster bounded by the mesh's bounds, which never
+    // faces away since its cone cutoff is 1
+    wgpu::Buffer meshlet_buf = mesh.meshlet_buf;
+    if (whole_objects) {
+        Meshlet cluster;
+        cluster.center = 0.5f * (mesh.bounds_min + mesh.bounds_max);
+        cluster.radius = 0.5f * glm::length(mesh.bounds_max - mesh.bounds_min);
+        cluster.num_indices = mesh.num_indices;
+        cluster.num_vertices = mesh.num_vertices;
+        buffer_desc.size = sizeof(Meshlet);
+        buffer_desc.usage = wgpu::BufferUsage::Storage;
+        object_cluster_buf = gpu_memory_create_buffer(device, buffer_desc, "object_cluster");
+        std::memcpy(object_cluster_buf.GetMappedRange(), &cluster, sizeof(Meshlet));
+        object_cluster_buf.Unmap();
+        meshlet_buf = object_cluster_buf;
+    }
+
+    buffer_desc.mappedAtCreation = false;
+    buffer_desc.size = draw_args_size;
+    buffer_desc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::Indirect;
+    draw_args_buf = gpu_memory_create_buffer(device, buffer_desc, "cluster_draw_args");
+
+    buffer_desc.size = uint64_t(num_meshlets) * DRAW_ARGS_STRIDE;
+    compacted_draws_buf = gpu_memory_create_buffer(device, buffer_desc, "compacted_draws");
+
+    buffer_desc.size = draw_instances_size;
+    buffer_desc.usage = wgpu::BufferUsage::Storage;
+    draw_instances_buf = gpu_memory_create_buffer(device, buffer_desc, "draw_instances");
+
+    buffer_desc.size = COUNTS_SIZE;
+    buffer_desc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc |
+                        wgpu::BufferUsage::CopyDst;
+    counter_buf = gpu_memory_create_buffer(device, buffer_desc, "cluster_cull_counts");
+
+    readbacks =
+        ReadbackRing(instance, device, COUNTS_SIZE, num_readbacks, "cluster_cull_readback");
+
+    // The cull params, meshlets, object transforms, draw arguments, counts, and the
+    // compacted draws and their instances
+    const wgpu::BufferBindingType binding_types[] = {wgpu::BufferBindingType::Uniform,
+                                                     wgpu::BufferBindingType::ReadOnlyStorage,
+                                                     wgpu::BufferBindingType::ReadOnlyStorage,
+                                                     wgpu::BufferBindingType::Storage,
+                                                     wgpu::BufferBindingType::Storage,
+                                                     wgpu::BufferBindingType::Storage,
+                                                     wgpu::BufferBindingType::Storage};
+    const wgpu::Buffer buffers[] = {cull_param_buf,
+                                    meshlet_buf,
+                                    object_buf,
+                                    draw_args_buf,
+                                    counter_buf,
+                                    compacted_draws_buf,
+                                    draw_instances_buf};
+    const uint64_t sizes[] = {sizeof(CullParams),
+                              uint64_t(num_meshlets) * sizeof(Meshlet),
+                              object_size,
+                              draw_args_size,
+                              COUNTS_SIZE,
+                              uint64_t(num_meshlets) * DRAW_ARGS_STRIDE,
+                              draw_instances_size};
+    std::array<wgpu::BindGroupLayoutEntry, 7> layout_entries = {};
+    std::array<wgpu::BindGroupEntry, 7> bg_entries = {};
+    for (uint32_t i = 0; i < layout_entries.size(); ++i) {
+        layout_entries[i].binding = i;
+        layout_entries[i].buffer.type = binding_types[i];
+        layout_entries[i].visibility = wgpu::ShaderStage::Compute;
+
+        bg_entries[i].binding = i;
+        bg_entries[i].buffer = buffers[i];
+        bg_entries[i].size = sizes[i];
+    }
+
+    wgpu::BindGroupLayoutDescriptor layout_desc = {};
+    layout_desc.entryCount = layout_entries.size();
+    layout_desc.entries = layout_entries.data();
+    layout = device.CreateBindGroupLayout(&layout_desc);
+
+    wgpu::BindGroupDescriptor bind_group_desc = {};
+    bind_group_desc.layout = layout;
+    bind_group_desc.entryCount = bg_entries.size();
+    bind_group_desc.entries = bg_entries.data();
+    bind_group = device.CreateBindGroup(&bind_group_desc);
+
+    // The scene's instanced draws see a meshlet's list of instances at a time
+    std::array<wgpu::BindGroupEntry, 2> draw_entries = {};
+    draw_entries[0].binding = 1;
+    draw_entries[0].buffer = object_buf;
+    draw_entries[0].size = object_size;
+
+    draw_entries[1].binding = 2;
+    draw_entries[1].buffer = draw_instances_buf;
+    draw_entries[1].size = instances_size;
+
+    bind_group_desc.layout = draw_layout;
+    bind_group_desc.entryCount = draw_entries.size();
+    bind_group_desc.entries = draw_entries.data();
+    draw_group = device.CreateBindGroup(&bind_group_desc);
+}
+
+bool ClusterCuller::is_enabled() const
+{
+    return enabled;
+}
+
+const std::string &ClusterCuller::why_disabled() const
+{
+    return disabled_reason;
+}
+
+const wgpu::BindGroupLayout &ClusterCuller::bind_group_layout() const
+{
+    return layout;
+}
+
+const wgpu::Buffer &ClusterCuller::draw_args() const
+{
+    return draw_args_buf;
+}
+
+const wgpu::Buffer &ClusterCuller::compacted_draws() const
+{
+    return compacted_draws_buf;
+}
+
+const wgpu::BindGroup &ClusterCuller::draw_bind_group() const
+{
+    return draw_group;
+}
+
+uint32_t ClusterCuller::instance_offset(const uint32_t m) const
+{
+    return m * instance_stride;
+}
+
+uint32_t ClusterCuller::meshlet_count() const
+{
+    return num_meshlets;
+}
+
+void ClusterCuller::set_view(StagingRing &staging_ring,
+                             const wgpu::CommandEncoder &encoder,
+                             const glm::mat4 &view_proj)
+{
+    if (!enabled) {
+        return;
+    }
+    // Gribb and Hartmann's plane extraction. WebGPU clips to 0 <= z <= w, so the
+    // near plane is z >= 0 even though the projection maps the near plane to -w
+    const glm::mat4 &m = view_proj;
+    const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    CullParams params;
+    params.planes[0] = row3 + row0;
+    params.planes[1] = row3 - row0;
+    params.planes[2] = row3 + row1;
+    params.planes[3] = row3 - row1;
+    params.planes[4] = row2;
+    params.planes[5] = row3 - row2;
+    for (auto &p : params.planes) {
+        p /= glm::length(glm::vec3(p.x, p.y, p.z));
+    }
+
+    // The camera projects to w = 0 at the center of the view, so it's the point
+    // the inverse maps the direction along z back to
+    const glm::vec4 camera = glm::inverse(view_proj) * glm::vec4(0.f, 0.f, 1.f, 0.f);
+    params.camera_position = camera / camera.w;
+
+    // The counts and dispatch width are left as they were created
+    staging_ring.upload(
+        encoder, cull_param_buf, 0, &params, offsetof(CullParams, num_meshlets));
+}
+
+void ClusterCuller::begin_frame(const wgpu::CommandEncoder &encoder)
+{
+    if (!enabled) {
+        return;
+    }
+    collect_results();
+
+    // If every readback is still pending this frame's counts are dropped
+    readbacks.begin_frame();
+    encoder.ClearBuffer(counter_buf, 0, COUNTS_SIZE);
+}
+
+void ClusterCuller::dispatch(const wgpu::ComputePassEncoder &pass_enc,
+                             const wgpu::ComputePipeline &pipeline) const
+{
+    if (!enabled) {
+        return;
+    }
+    pass_enc.SetPipeline(pipeline);
+    pass_enc.SetBindGroup(0, bind_group);
+    pass_enc.DispatchWorkgroups(dispatch_x, dispatch_y);
+}
+
+void ClusterCuller::dispatch_compacted(const wgpu::ComputePassEncoder &pass_enc,
+                                       const wgpu::ComputePipeline &reset_pipeline,
+                                       const wgpu::ComputePipeline &cull_pipeline) const
+{
+    if (!enabled) {
+        return;
+    }
+    // Each dispatch is synchronized with the next, so the culling appends to the
+    // draws once they're all reset
+    pass_enc.SetBindGroup(0, bind_group);
+    pass_enc.SetPipeline(reset_pipeline);
+    pass_enc.DispatchWorkgroups(reset_groups);
+    pass_enc.SetPipeline(cull_pipeline);
+    pass_enc.DispatchWorkgroups(dispatch_x, dispatch_y);
+}
+
+void ClusterCuller::resolve(const wgpu::CommandEncoder &encoder)
+{
+    const wgpu::Buffer readback_buf = readbacks.buffer();
+    if (!readback_buf) {
+        return;
+    }
+    encoder.CopyBufferToBuffer(counter_buf, 0, readback_buf, 0, COUNTS_SIZE);
+}
+
+void ClusterCuller::end_frame()
+{
+    readbacks.end_frame(COUNTS_SIZE);
+}
+
+const ClusterCullStats &ClusterCuller::last_frame() const
+{
+    return last_stats;
+}
+
+double ClusterCuller::average_culled_cluster_percent() const
+{
+    return num_frames_measured > 0 ? culled_cluster_percent_sum / num_frames_measured : 0.0;
+}
+
+double ClusterCuller::average_culled_triangle_percent() const
+{
+    return num_frames_measured > 0 ? culled_triangle_percent_sum / num_frames_measured : 0.0;
+}
+
+void ClusterCuller::reset_stats()
+{
+    last_stats = ClusterCullStats();
+    num_frames_measured = 0;
+    culled_cluster_percent_sum = 0.0;
+    culled_triangle_percent_sum = 0.0;
+}
+
+void ClusterCuller::print_summary(std::ostream &os) const
+{
+    if (!enabled) {
+        os << (whole_objects ? "Object" : "Cluster") << " culling: disabled, "
+           << disabled_reason << "\n";
+        return;
+    }
+    if (whole_objects) {
+        os << "Object culling: " << num_objects << " objects, over " << num_frames_measured
+           << " frames culled " << average_culled_cluster_percent() << "% of objects and "
+           << average_culled_triangle_percent() << "% of triangles on average\n";
+        return;
+    }
+    os << "Cluster culling: " << num_meshlets << " meshlets x " << num_objects
+       << " objects, over " << num_frames_measured << " frames culled "
+       << average_culled_cluster_percent() << "% of clusters and "
+       << average_culled_triangle_percent() << "% of triangles on average\n";
+}
+
+void ClusterCuller::release()
+{
+    gpu_memory_release(cull_param_buf);
+    gpu_memory_release(object_cluster_buf);
+    gpu_memory_release(draw_args_buf);
+    gpu_memory_release(compacted_draws_buf);
+    gpu_memory_release(draw_instances_buf);
+    gpu_memory_release(counter_buf);
+    readbacks.release();
+}
+
+void ClusterCuller::collect_results()
+{
+    // The counts are collected oldest first, leaving the most recent frame's counts
+    // in last_stats
+    readbacks.collect([&](uint32_t, uint64_t, const void *data) {
+        uint32_t counts[3];
+        std::memcpy(counts, data, COUNTS_SIZE);
+
+        last_stats.num_clusters = uint64_t(num_meshlets) * num_objects;
+        last_stats.num_triangles = mesh_triangles * num_objects;
+        last_stats.visible_clusters = counts[0];
+        last_stats.visible_triangles = (uint64_t(counts[2]) << 32) | counts[1];
+        culled_cluster_percent_sum += last_stats.culled_cluster_percent();
+        culled_triangle_percent_sum += last_stats.culled_triangle_percent();
+        ++num_frames_measured;
+    });
+}
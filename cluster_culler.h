@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "mesh_loader.h"
+#include "readback_ring.h"
+#include "staging_ring.h"
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+// The clusters and triangles of a frame, and how many survived culling
+struct ClusterCullStats {
+    uint64_t num_clusters = 0;
+    uint64_t num_triangles = 0;
+    uint64_t visible_clusters = 0;
+    uint64_t visible_triangles = 0;
+
+    double culled_cluster_percent() const;
+
+    double culled_triangle_percent() const;
+};
+
+/* Culls the meshlets of every object on the GPU each frame, against the view
+ * frustum and by their normal cones, before the scene is drawn. A compute pass
+ * with a thread per object and meshlet writes each pair's DrawIndexedIndirect
+ * arguments, which draw the meshlet's index range if it's visible and nothing
+ * otherwise, so the render pass issues the same indirect draws every frame and
+ * can replay them from a bundle. The visible clusters and triangles are counted
+ * and read back through a ReadbackRing, like the GPU profiler's timestamps, so
+ * the CPU never waits on them.
+ *
+ * For GPU driven drawing dispatch_compacted() culls the same clusters, but
+ * appends each visible object to its meshlet's list of instances instead, so the
+ * scene is drawn with one instanced indirect draw per meshlet, whatever the
+ * number of objects. Made with whole_objects the culler treats the whole mesh as
+ * a single cluster, to cull the objects of meshes without meshlets.
+ *
+ * The cone test culls clusters whose triangles all face away from the camera,
+ * which matches the scene pipelines culling the back faces of meshes with
+ * meshlets, so culling never changes what's drawn. The model transforms must
+ * scale uniformly, as the scene's do.
+ *
+ * Each frame: begin_frame(), dispatch() or dispatch_compacted() in a compute pass,
+ * resolve() once the pass is recorded, then end_frame() after Queue::Submit.
+ */
+class ClusterCuller {
+public:
+    // The size of a DrawIndexedIndirect argument struct in the draw buffer
+    static const uint32_t DRAW_ARGS_STRIDE = 5 * sizeof(uint32_t);
+
+private:
+    wgpu::Device device;
+    bool whole_objects = false;
+    bool enabled = false;
+    std::string disabled_reason;
+
+    uint32_t num_meshlets = 0;
+    uint32_t num_objects = 0;
+    uint64_t mesh_triangles = 0;
+    // The workgroups dispatched along x and y, y is only used when there are more
+    // than the device allows along one dimension
+    uint32_t dispatch_x = 0;
+    uint32_t dispatch_y = 0;
+    uint32_t reset_groups = 0;
+    // The bytes between the meshlets' lists of visible objects, a multiple of the
+    // storage buffer offset alignment so each list can be bound with a dynamic offset
+    uint32_t instance_stride = 0;
+
+    wgpu::BindGroupLayout layout;
+    wgpu::BindGroup bind_group;
+    wgpu::BindGroup draw_group;
+    wgpu::Buffer cull_param_buf;
+    // The single cluster bounding the whole mesh, when culling whole objects
+    wgpu::Buffer object_cluster_buf;
+    // Owned by the renderer, the culler only binds it
+    wgpu::Buffer object_buf;
+    wgpu::Buffer draw_args_buf;
+    wgpu::Buffer compacted_draws_buf;
+    wgpu::Buffer draw_instances_buf;
+    wgpu::Buffer counter_buf;
+
+    ReadbackRing readbacks;
+
+    ClusterCullStats last_stats;
+    uint64_t num_frames_measured = 0;
+    double culled_cluster_percent_sum = 0.0;
+    double culled_triangle_percent_sum = 0.0;
+
+public:
+    ClusterCuller() = default;
+
+    /* Create the buffers to cull the mesh's meshlets, or the whole mesh if
+     * whole_objects is set, for each of the num_objects transforms in object_buf,
+     * with num_readbacks readbacks of the counts in flight. The compacted draws are
+     * bound through draw_layout, with the transforms at binding 1 and the draw's
+     * instances at binding 2. Culling is disabled if the mesh has no meshlets, or
+     * isn't indexed when culling whole objects, or if the buffers would exceed the
+     * device's limits.
+     */
+    ClusterCuller(const wgpu::Instance &instance,
+                  const wgpu::Device &device,
+                  const Mesh &mesh,
+                  const wgpu::Buffer &object_buf,
+                  const uint32_t num_objects,
+                  const wgpu::BindGroupLayout &draw_layout,
+                  const bool whole_objects,
+                  uint32_t num_readbacks = 4);
+
+    bool is_enabled() const;
+
+    // Why culling is disabled, empty if it's enabled
+    const std::string &why_disabled() const;
+
+    // Get the layout of the cull shader's bind group, null if culling is disabled
+    const wgpu::BindGroupLayout &bind_group_layout() const;
+
+    // The indirect arguments of object o's meshlet m are at index o * num_meshlets + m
+    const wgpu::Buffer &draw_args() const;
+
+    // The instanced indirect arguments of meshlet m are at index m
+    const wgpu::Buffer &compacted_draws() const;
+
+    /* Get the bind group the compacted draws read the object transforms and their
+     * instances through, bound with instance_offset of the meshlet drawn
+     */
+    const wgpu::BindGroup &draw_bind_group() const;
+
+    // Get the dynamic offset of meshlet m's instances in the draw bind group
+    uint32_t instance_offset(const uint32_t m) const;
+
+    // The meshlets of each object, 1 when culling whole objects
+    uint32_t meshlet_count() const;
+
+    /* Upload the frustum planes and camera position of the view projection, the
+     * culling keeps using them until the view changes
+     */
+    void set_view(StagingRing &staging_ring,
+                  const wgpu::CommandEncoder &encoder,
+                  const glm::mat4 &view_proj);
+
+    // Collect any completed readbacks and clear the counts for the frame
+    void begin_frame(const wgpu::CommandEncoder &encoder);
+
+    // Record the culling into the compute pass
+    void dispatch(const wgpu::ComputePassEncoder &pass_enc,
+                  const wgpu::ComputePipeline &pipeline) const;
+
+    /* Record the culling compacting the visible objects into the compute pass, with
+     * the pipelines of the reset_draws and cull_compact entry points
+     */
+    void dispatch_compacted(const wgpu::ComputePassEncoder &pass_enc,
+                            const wgpu::ComputePipeline &reset_pipeline,
+                            const wgpu::ComputePipeline &cull_pipeline) const;
+
+    // Copy the frame's counts to a readback buffer, if one is free
+    void resolve(const wgpu::CommandEncoder &encoder);
+
+    // Start reading back the frame's counts, must be called after Queue::Submit
+    void end_frame();
+
+    // Get the counts of the most recent frame whose readback has completed
+    const ClusterCullStats &last_frame() const;
+
+    // Get the average percent of the clusters and triangles culled over the frames
+    // read back
+    double average_culled_cluster_percent() const;
+
+    double average_culled_triangle_percent() const;
+
+    void reset_stats();
+
+    void print_summary(std::ostream &os) const;
+
+    // Release the buffers from the GPU memory tracker
+    void release();
+
+private:
+    // Read the counts from any readbacks that have completed
+    void collect_results();
+};
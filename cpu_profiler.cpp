@@ -0,0 +1,163 @@
+#include "cpu_profiler.h"
+
+#ifdef CPU_PROFILER_ENABLED
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// The number of zones kept per thread, older zones are overwritten
+const uint64_t RING_SIZE = 1 << 16;
+
+const Clock::time_point start_time = Clock::now();
+
+/* The fields are atomic so the exporting thread can read them while the owning
+ * thread writes, relaxed loads and stores compile to plain moves on the
+ * platforms we target
+ */
+struct ZoneEvent {
+    std::atomic<const char *> name;
+    std::atomic<uint64_t> begin_ns;
+    std::atomic<uint64_t> end_ns;
+};
+
+struct ZoneRecord {
+    const char *name;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+};
+
+struct ThreadBuffer {
+    uint32_t id = 0;
+    // Guarded by registry_mutex
+    std::string name;
+    std::unique_ptr<ZoneEvent[]> events;
+    // The total number of zones written, only modified by the owning thread
+    std::atomic<uint64_t> head;
+
+    ThreadBuffer() : events(new ZoneEvent[RING_SIZE]), head(0) {}
+};
+
+// Buffers are kept for the life of the program so zones from threads that
+// have exited are still exported
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+ThreadBuffer *thread_buffer()
+{
+    static thread_local ThreadBuffer *buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.emplace_back(new ThreadBuffer);
+        buffer = registry.back().get();
+        buffer->id = registry.size();
+        buffer->name = "thread " + std::to_string(buffer->id);
+    }
+    return buffer;
+}
+
+uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time)
+        .count();
+}
+
+std::string json_escape(const std::string &str)
+{
+    std::string escaped;
+    for (const auto &c : str) {
+        if (c == '"' || c == '\\') {
+            escaped.push_back('\\');
+        }
+        escaped.push_back(c);
+    }
+    return escaped;
+}
+
+}
+
+CpuZone::CpuZone(const char *name) : name(name), begin_ns(now_ns()) {}
+
+CpuZone::~CpuZone()
+{
+    end();
+}
+
+void CpuZone::end()
+{
+    if (!name) {
+        return;
+    }
+    ThreadBuffer *buffer = thread_buffer();
+    const uint64_t h = buffer->head.load(std::memory_order_relaxed);
+    ZoneEvent &e = buffer->events[h % RING_SIZE];
+    e.name.store(name, std::memory_order_relaxed);
+    e.begin_ns.store(begin_ns, std::memory_order_relaxed);
+    e.end_ns.store(now_ns(), std::memory_order_relaxed);
+    buffer->head.store(h + 1, std::memory_order_release);
+    name = nullptr;
+}
+
+void cpu_profiler_set_thread_name(const std::string &name)
+{
+    ThreadBuffer *buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    buffer->name = name;
+}
+
+bool cpu_profiler_write_trace(const std::string &path)
+{
+    std::ofstream fout(path.c_str());
+    if (!fout) {
+        return false;
+    }
+
+    // Timestamps are in microseconds, keep ns precision
+    fout << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    bool first = true;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (const auto &buffer : registry) {
+        fout << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+             << "\"tid\":" << buffer->id << ",\"args\":{\"name\":\""
+             << json_escape(buffer->name) << "\"}}";
+        first = false;
+
+        // Copy out the zones without stopping the owning thread, then drop any it
+        // may have overwritten while we were reading them, including the slot of a
+        // zone it's in the middle of writing
+        const uint64_t head = buffer->head.load(std::memory_order_acquire);
+        const uint64_t begin = head > RING_SIZE ? head - RING_SIZE : 0;
+        std::vector<ZoneRecord> zones;
+        for (uint64_t i = begin; i < head; ++i) {
+            const ZoneEvent &e = buffer->events[i % RING_SIZE];
+            ZoneRecord z;
+            z.name = e.name.load(std::memory_order_relaxed);
+            z.begin_ns = e.begin_ns.load(std::memory_order_relaxed);
+            z.end_ns = e.end_ns.load(std::memory_order_relaxed);
+            zones.push_back(z);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t new_head = buffer->head.load(std::memory_order_relaxed);
+        const uint64_t valid_begin = new_head >= RING_SIZE ? new_head - RING_SIZE + 1 : 0;
+
+        for (uint64_t i = std::max(begin, valid_begin); i < head; ++i) {
+            const ZoneRecord &z = zones[i - begin];
+            fout << ",\n{\"name\":\"" << json_escape(z.name) << "\",\"ph\":\"X\",\"pid\":1,"
+                 << "\"tid\":" << buffer->id << ",\"ts\":" << z.begin_ns / 1000.0
+                 << ",\"dur\":" << (z.end_ns - z.begin_ns) / 1000.0 << "}";
+        }
+    }
+    fout << "\n]}\n";
+    return bool(fout);
+}
+
+#endif
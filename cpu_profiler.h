@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/* A low overhead CPU zone profiler. Zones are marked with CPU_ZONE("name") for
+ * the rest of the enclosing scope, or CPU_ZONE_BEGIN(var, "name") and
+ * CPU_ZONE_END(var) for phases that don't map to a scope. Each thread writes its
+ * completed zones to its own fixed size ring buffer without taking any locks, and
+ * the buffers can be exported as Chrome trace-event JSON (chrome://tracing or
+ * Perfetto) at any time. Zone names must be string literals, as only the pointer
+ * is stored.
+ *
+ * The profiler is only compiled in when CPU_PROFILER_ENABLED is defined (the
+ * CPU_PROFILER CMake option), otherwise the macros expand to nothing and the
+ * functions are empty.
+ */
+
+#define CPU_PROFILER_CONCAT_IMPL(a, b) a##b
+#define CPU_PROFILER_CONCAT(a, b) CPU_PROFILER_CONCAT_IMPL(a, b)
+
+#ifdef CPU_PROFILER_ENABLED
+
+#define CPU_ZONE(name) CpuZone CPU_PROFILER_CONCAT(cpu_zone_, __LINE__)(name)
+#define CPU_ZONE_BEGIN(var, name) CpuZone var(name)
+#define CPU_ZONE_END(var) var.end()
+
+class CpuZone {
+    const char *name = nullptr;
+    uint64_t begin_ns = 0;
+
+public:
+    explicit CpuZone(const char *name);
+
+    ~CpuZone();
+
+    // End the zone before the end of its scope
+    void end();
+
+    CpuZone(const CpuZone &) = delete;
+    CpuZone &operator=(const CpuZone &) = delete;
+};
+
+// Name the calling thread in the exported trace
+void cpu_profiler_set_thread_name(const std::string &name);
+
+/* Write the zones currently in each thread's ring buffer to the file as Chrome
+ * trace-event JSON. Returns false if the file couldn't be written.
+ */
+bool cpu_profiler_write_trace(const std::string &path);
+
+#else
+
+#define CPU_ZONE(name)
+#define CPU_ZONE_BEGIN(var, name)
+#define CPU_ZONE_END(var)
+
+inline void cpu_profiler_set_thread_name(const std::string &)
+{
+}
+
+inline bool cpu_profiler_write_trace(const std::string &)
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,178 @@
+#include "error_reporter.h"
+#include <utility>
+
+static const char *error_type_name(WGPUErrorType type)
+{
+    switch (static_cast<wgpu::ErrorType>(type)) {
+    case wgpu::ErrorType::Validation:
+        return "validation";
+    case wgpu::ErrorType::OutOfMemory:
+        return "out of memory";
+    case wgpu::ErrorType::Internal:
+        return "internal";
+    case wgpu::ErrorType::DeviceLost:
+        return "device lost";
+    default:
+        return "unknown";
+    }
+}
+
+ErrorReporter::ErrorReporter(const wgpu::Device &device, double report_interval_ms)
+    : device(device), queue(std::make_shared<Queue>()), report_interval_ms(report_interval_ms)
+{
+    // The device holds a raw pointer to the queue, which the reporter keeps alive
+    // until it removes the callback when it's destroyed
+    device.SetUncapturedErrorCallback(error_callback, queue.get());
+}
+
+ErrorReporter::~ErrorReporter()
+{
+    release();
+}
+
+ErrorReporter::ErrorReporter(ErrorReporter &&other)
+{
+    *this = std::move(other);
+}
+
+ErrorReporter &ErrorReporter::operator=(ErrorReporter &&other)
+{
+    if (this == &other) {
+        return *this;
+    }
+    release();
+    // The queue keeps its address, so the callback installed by other stays valid
+    device = other.device;
+    queue = other.queue;
+    report_interval_ms = other.report_interval_ms;
+    scopes = std::move(other.scopes);
+    aggregates = std::move(other.aggregates);
+    total_errors = other.total_errors;
+    other.device = nullptr;
+    other.queue = nullptr;
+    return *this;
+}
+
+void ErrorReporter::push_scope(const std::string &label)
+{
+    if (!device) {
+        return;
+    }
+    scopes.push_back(label);
+    device.PushErrorScope(wgpu::ErrorFilter::OutOfMemory);
+    device.PushErrorScope(wgpu::ErrorFilter::Validation);
+}
+
+void ErrorReporter::pop_scope()
+{
+    if (!device || scopes.empty()) {
+        return;
+    }
+    for (int i = 0; i < 2; ++i) {
+        PopData *data = new PopData;
+        data->queue = queue;
+        data->label = scopes.back();
+        device.PopErrorScope(pop_callback, data);
+    }
+    scopes.pop_back();
+}
+
+void ErrorReporter::report(std::ostream &os)
+{
+    if (!queue) {
+        return;
+    }
+    std::vector<Error> errors;
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        errors.swap(queue->errors);
+    }
+
+    const auto now = Clock::now();
+    for (const auto &e : errors) {
+        const std::string key = e.label + "\n" + error_type_name(e.type) + "\n" + e.message;
+        auto fnd = aggregates.find(key);
+        if (fnd == aggregates.end()) {
+            Aggregate a;
+            a.label = e.label;
+            a.type = e.type;
+            a.message = e.message;
+            a.count = 1;
+            a.last_report = now;
+            aggregates[key] = a;
+            os << "WebGPU " << error_type_name(e.type) << " error in " << e.label << ": "
+               << e.message << "\n";
+        } else {
+            ++fnd->second.count;
+            ++fnd->second.unreported;
+        }
+        ++total_errors;
+    }
+
+    for (auto &it : aggregates) {
+        Aggregate &a = it.second;
+        const double since_report_ms =
+            std::chrono::duration<double, std::milli>(now - a.last_report).count();
+        if (a.unreported > 0 && since_report_ms >= report_interval_ms) {
+            os << "WebGPU " << error_type_name(a.type) << " error in " << a.label
+               << " repeated " << a.unreported << " times in the last "
+               << since_report_ms / 1000.0 << "s: " << a.message << "\n";
+            a.unreported = 0;
+            a.last_report = now;
+        }
+    }
+}
+
+uint64_t ErrorReporter::num_errors() const
+{
+    return total_errors;
+}
+
+void ErrorReporter::print_summary(std::ostream &os) const
+{
+    if (aggregates.empty()) {
+        return;
+    }
+    os << "WebGPU errors: " << total_errors << "\n";
+    for (const auto &it : aggregates) {
+        const Aggregate &a = it.second;
+        os << "  " << a.label << " (" << error_type_name(a.type) << ", " << a.count
+           << " times): " << a.message << "\n";
+    }
+}
+
+void ErrorReporter::release()
+{
+    if (device) {
+        device.SetUncapturedErrorCallback(nullptr, nullptr);
+    }
+    device = nullptr;
+    queue = nullptr;
+}
+
+void ErrorReporter::error_callback(WGPUErrorType type, const char *message, void *user_data)
+{
+    Queue *queue = reinterpret_cast<Queue *>(user_data);
+    Error e;
+    e.label = "uncaptured";
+    e.type = type;
+    e.message = message ? message : "";
+
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->errors.push_back(e);
+}
+
+void ErrorReporter::pop_callback(WGPUErrorType type, const char *message, void *user_data)
+{
+    std::unique_ptr<PopData> data(reinterpret_cast<PopData *>(user_data));
+    if (type == WGPUErrorType_NoError) {
+        return;
+    }
+    Error e;
+    e.label = data->label;
+    e.type = type;
+    e.message = message ? message : "";
+
+    std::lock_guard<std::mutex> lock(data->queue->mutex);
+    data->queue->errors.push_back(e);
+}
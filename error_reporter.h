@@ -0,0 +1,110 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+/* Attributes WebGPU errors to labeled operations with error scopes and reports
+ * them without stopping the app. push_scope/pop_scope bracket an operation, e.g.
+ * creating the scene or encoding a frame, with validation and out of memory
+ * scopes. The scopes are popped asynchronously, their callbacks only queue the
+ * errors, and are run by the Instance::ProcessEvents call the frame loop already
+ * makes while handling events, so nothing waits on the device in the frame.
+ * Errors outside any scope are caught by the uncaptured error callback and
+ * attributed to "uncaptured".
+ *
+ * report() aggregates the queued errors by label, type and message. The first
+ * occurrence of an error is printed immediately, repeats are only summarized
+ * once per report interval, so an error hit every frame doesn't flood the log.
+ */
+class ErrorReporter {
+    using Clock = std::chrono::steady_clock;
+
+    struct Error {
+        std::string label;
+        WGPUErrorType type;
+        std::string message;
+    };
+
+    // Shared with the callbacks, which may outlive the reporter or run on other threads
+    struct Queue {
+        std::mutex mutex;
+        std::vector<Error> errors;
+    };
+
+    struct PopData {
+        std::shared_ptr<Queue> queue;
+        std::string label;
+    };
+
+    struct Aggregate {
+        std::string label;
+        WGPUErrorType type;
+        std::string message;
+        uint64_t count = 0;
+        // Occurrences since the error was last printed
+        uint64_t unreported = 0;
+        Clock::time_point last_report;
+    };
+
+    wgpu::Device device;
+    std::shared_ptr<Queue> queue;
+    double report_interval_ms = 0.0;
+
+    // The labels of the open scopes, innermost last
+    std::vector<std::string> scopes;
+    std::map<std::string, Aggregate> aggregates;
+    uint64_t total_errors = 0;
+
+public:
+    ErrorReporter() = default;
+
+    /* Create a reporter for the device and install its uncaptured error callback.
+     * Repeats of an error are printed at most once every report_interval_ms.
+     */
+    ErrorReporter(const wgpu::Device &device, double report_interval_ms = 5000.0);
+
+    // Removes the uncaptured error callback, which points at the reporter's queue
+    ~ErrorReporter();
+
+    // Moving hands the callback over to the new reporter, copies would share it
+    ErrorReporter(ErrorReporter &&other);
+    ErrorReporter &operator=(ErrorReporter &&other);
+
+    ErrorReporter(const ErrorReporter &) = delete;
+    ErrorReporter &operator=(const ErrorReporter &) = delete;
+
+    // Begin attributing errors to the operation with the label
+    void push_scope(const std::string &label);
+
+    // End the innermost scope, its errors are queued when the device resolves it
+    void pop_scope();
+
+    // Aggregate the errors queued since the last call and print new or repeating ones
+    void report(std::ostream &os);
+
+    // Get the number of errors reported so far
+    uint64_t num_errors() const;
+
+    // Print the count of each distinct error
+    void print_summary(std::ostream &os) const;
+
+private:
+    // Remove the uncaptured error callback and release the device and queue
+    void release();
+
+    static void error_callback(WGPUErrorType type, const char *message, void *user_data);
+
+    static void pop_callback(WGPUErrorType type, const char *message, void *user_data);
+};
@@ -0,0 +1,150 @@
+#include "frame_pacer.h"
+#include <algorithm>
+
+// How long SKIP mode waits for the oldest frame before skipping
+static const uint64_t SKIP_WAIT_NS = 1000000;
+
+FramePacer::FramePacer(const wgpu::Instance &instance,
+                       const wgpu::Queue &queue,
+                       uint32_t max_frames_in_flight,
+                       Mode mode)
+    : instance(instance),
+      queue(queue),
+      max_frames_in_flight(std::max(max_frames_in_flight, 1u)),
+      mode(mode)
+{
+#ifdef __EMSCRIPTEN__
+    this->mode = Mode::SKIP;
+#endif
+}
+
+bool FramePacer::begin_frame()
+{
+    retire_completed();
+
+    const auto start = Clock::now();
+    while (in_flight.size() >= max_frames_in_flight) {
+        if (mode == Mode::SKIP) {
+            wait_oldest(SKIP_WAIT_NS);
+            retire_completed();
+            if (in_flight.size() >= max_frames_in_flight) {
+                ++num_skipped;
+                return false;
+            }
+            break;
+        }
+        wait_oldest();
+        retire_completed();
+    }
+    current_start_time = Clock::now();
+    current_cpu_wait_ms =
+        std::chrono::duration<double, std::milli>(current_start_time - start).count();
+    return true;
+}
+
+void FramePacer::end_frame()
+{
+    std::unique_ptr<Frame> f(new Frame);
+    f->frame = frame_index++;
+    f->cpu_wait_ms = current_cpu_wait_ms;
+    f->start_time = current_start_time;
+    f->submit_time = Clock::now();
+
+#ifdef __EMSCRIPTEN__
+    queue.OnSubmittedWorkDone(
+        [](WGPUQueueWorkDoneStatus, void *user_data) {
+            Frame *frame = reinterpret_cast<Frame *>(user_data);
+            frame->done_time = Clock::now();
+            frame->done = true;
+        },
+        f.get());
+#else
+    wgpu::QueueWorkDoneCallbackInfo callback_info;
+    callback_info.mode = wgpu::CallbackMode::WaitAnyOnly;
+    callback_info.callback = [](WGPUQueueWorkDoneStatus, void *user_data) {
+        Frame *frame = reinterpret_cast<Frame *>(user_data);
+        frame->done_time = Clock::now();
+        frame->done = true;
+    };
+    callback_info.userdata = f.get();
+    f->future = queue.OnSubmittedWorkDoneF(callback_info);
+#endif
+
+    in_flight.push_back(std::move(f));
+    current_cpu_wait_ms = 0.0;
+}
+
+uint32_t FramePacer::frames_in_flight() const
+{
+    return in_flight.size();
+}
+
+const FrameTiming &FramePacer::last_completed() const
+{
+    return last_timing;
+}
+
+void FramePacer::print_summary(std::ostream &os) const
+{
+    os << "Frame pacing: " << num_completed << " frames completed, " << num_skipped
+       << " skipped, max in flight " << max_frames_in_flight << "\n";
+    if (num_completed > 0) {
+        os << "  avg CPU wait: " << total_cpu_wait_ms / num_completed << "ms"
+           << ", avg submit to retire: " << total_submit_to_retire_ms / num_completed
+           << "ms\n"
+           << "  latency avg: " << total_latency_ms / num_completed << "ms"
+           << ", min: " << min_latency_ms << "ms, max: " << max_latency_ms << "ms\n";
+    }
+}
+
+void FramePacer::retire_completed()
+{
+#ifndef __EMSCRIPTEN__
+    // Poll the outstanding futures without blocking, the callbacks are only
+    // invoked from within WaitAny since they use CallbackMode::WaitAnyOnly
+    for (auto &f : in_flight) {
+        if (!f->done) {
+            wgpu::FutureWaitInfo wait_info;
+            wait_info.future = f->future;
+            instance.WaitAny(1, &wait_info, 0);
+        }
+    }
+#endif
+    // Queue work completes in submission order, so we only need to check the front
+    while (!in_flight.empty() && in_flight.front()->done) {
+        const Frame &f = *in_flight.front();
+        last_timing.frame = f.frame;
+        last_timing.cpu_wait_ms = f.cpu_wait_ms;
+        last_timing.submit_to_retire_ms =
+            std::chrono::duration<double, std::milli>(f.done_time - f.submit_time).count();
+        last_timing.latency_ms =
+            std::chrono::duration<double, std::milli>(f.done_time - f.start_time).count();
+
+        if (num_completed == 0) {
+            min_latency_ms = last_timing.latency_ms;
+            max_latency_ms = last_timing.latency_ms;
+        }
+        min_latency_ms = std::min(min_latency_ms, last_timing.latency_ms);
+        max_latency_ms = std::max(max_latency_ms, last_timing.latency_ms);
+
+        ++num_completed;
+        total_cpu_wait_ms += last_timing.cpu_wait_ms;
+        total_submit_to_retire_ms += last_timing.submit_to_retire_ms;
+        total_latency_ms += last_timing.latency_ms;
+        in_flight.pop_front();
+    }
+}
+
+void FramePacer::wait_oldest(uint64_t timeout_ns)
+{
+#ifndef __EMSCRIPTEN__
+    if (in_flight.empty() || in_flight.front()->done) {
+        return;
+    }
+    wgpu::FutureWaitInfo wait_info;
+    wait_info.future = in_flight.front()->future;
+    instance.WaitAny(1, &wait_info, timeout_ns);
+#else
+    (void)timeout_ns;
+#endif
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <ostream>
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+struct FrameTiming {
+    uint64_t frame = 0;
+    // Time the CPU spent blocked waiting for a frame slot before recording the frame
+    double cpu_wait_ms = 0.0;
+    /* Time from the frame's submission until the pacer observed its work to be
+     * done. This includes waiting behind earlier frames' work and how often the
+     * pacer polls, so it bounds the frame's GPU time from above rather than
+     * measuring it, the GpuProfiler's timestamps give the GPU time itself.
+     */
+    double submit_to_retire_ms = 0.0;
+    /* Time from the start of the frame (after any pacing wait) until its work,
+     * including the present, was observed to be done. This approximates the
+     * latency from input to the frame reaching the display, and is what changes
+     * between present modes, e.g. Fifo blocks acquiring the next image.
+     */
+    double latency_ms = 0.0;
+};
+
+/* Bounds the number of frames the CPU can get ahead of the GPU. Each submitted
+ * frame is tracked by a Queue::OnSubmittedWorkDone future, when max_frames_in_flight
+ * frames are outstanding begin_frame will either block on the oldest one with
+ * Instance::WaitAny or tell the caller to skip the frame. Before skipping, the
+ * pacer waits briefly on the oldest frame so a caller looping on begin_frame
+ * doesn't spin. On Emscripten we can't block the browser's event loop, so the
+ * pacer always skips without waiting.
+ */
+class FramePacer {
+public:
+    enum class Mode { BLOCK, SKIP };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Frame {
+        uint64_t frame = 0;
+        double cpu_wait_ms = 0.0;
+        Clock::time_point start_time;
+        Clock::time_point submit_time;
+        Clock::time_point done_time;
+        bool done = false;
+#ifndef __EMSCRIPTEN__
+        wgpu::Future future;
+#endif
+    };
+
+    wgpu::Instance instance;
+    wgpu::Queue queue;
+    uint32_t max_frames_in_flight = 2;
+    Mode mode = Mode::BLOCK;
+
+    // Frames are heap allocated so the pointers passed to the callbacks stay valid
+    std::deque<std::unique_ptr<Frame>> in_flight;
+    uint64_t frame_index = 0;
+    double current_cpu_wait_ms = 0.0;
+    Clock::time_point current_start_time;
+
+    FrameTiming last_timing;
+    uint64_t num_completed = 0;
+    uint64_t num_skipped = 0;
+    double total_cpu_wait_ms = 0.0;
+    double total_submit_to_retire_ms = 0.0;
+    double total_latency_ms = 0.0;
+    double min_latency_ms = 0.0;
+    double max_latency_ms = 0.0;
+
+public:
+    FramePacer() = default;
+
+    FramePacer(const wgpu::Instance &instance,
+               const wgpu::Queue &queue,
+               uint32_t max_frames_in_flight = 2,
+               Mode mode = Mode::BLOCK);
+
+    /* Wait for a free frame slot. Returns false if the pacer is in SKIP mode and
+     * max_frames_in_flight frames are still outstanding, in which case the caller
+     * should not record or submit anything this frame.
+     */
+    bool begin_frame();
+
+    /* Track the work submitted for the frame, must be called after Queue::Submit.
+     * On native this should be called after presenting so the present is included
+     * in the frame's latency.
+     */
+    void end_frame();
+
+    // Get the number of frames submitted but not yet observed to be done
+    uint32_t frames_in_flight() const;
+
+    // Get the timing of the most recently completed frame
+    const FrameTiming &last_completed() const;
+
+    // Print the average CPU wait, submit to retire time and latency over all completed frames
+    void print_summary(std::ostream &os) const;
+
+private:
+    // Retire any frames at the front of the queue whose work is done
+    void retire_completed();
+
+    // Block until the oldest frame in flight is done or the timeout passes
+    void wait_oldest(uint64_t timeout_ns = std::numeric_limits<uint64_t>::max());
+};
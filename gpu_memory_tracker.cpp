@@ -0,0 +1,380 @@
+#include "gpu_memory_tracker.h"
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+std::mutex tracker_mutex;
+std::unordered_map<const void *, GpuMemoryResource> live_resources;
+
+// Live and peak sizes are current, the churn is since startup
+GpuMemoryStats total;
+std::map<std::string, GpuMemoryStats> categories;
+
+// The churn since the last gpu_memory_end_frame
+GpuMemoryStats frame_total;
+std::map<std::string, GpuMemoryStats> frame_categories;
+
+uint64_t num_frames = 0;
+GpuMemoryFrame last_frame;
+
+uint64_t budget_bytes = 0;
+bool over_budget = false;
+
+struct FormatBlock {
+    uint32_t bytes;
+    uint32_t width;
+    uint32_t height;
+};
+
+// The size of a texel block of the format, uncompressed formats have 1x1 blocks.
+// Formats not listed here are assumed to be 4 bytes per texel
+FormatBlock format_block(const wgpu::TextureFormat format)
+{
+    switch (format) {
+    case wgpu::TextureFormat::R8Unorm:
+    case wgpu::TextureFormat::R8Snorm:
+    case wgpu::TextureFormat::R8Uint:
+    case wgpu::TextureFormat::R8Sint:
+    case wgpu::TextureFormat::Stencil8:
+        return FormatBlock{1, 1, 1};
+    case wgpu::TextureFormat::R16Uint:
+    case wgpu::TextureFormat::R16Sint:
+    case wgpu::TextureFormat::R16Float:
+    case wgpu::TextureFormat::RG8Unorm:
+    case wgpu::TextureFormat::RG8Snorm:
+    case wgpu::TextureFormat::RG8Uint:
+    case wgpu::TextureFormat::RG8Sint:
+    case wgpu::TextureFormat::Depth16Unorm:
+        return FormatBlock{2, 1, 1};
+    case wgpu::TextureFormat::RG32Float:
+    case wgpu::TextureFormat::RG32Uint:
+    case wgpu::TextureFormat::RG32Sint:
+    case wgpu::TextureFormat::RGBA16Uint:
+    case wgpu::TextureFormat::RGBA16Sint:
+    case wgpu::TextureFormat::RGBA16Float:
+    case wgpu::TextureFormat::Depth32FloatStencil8:
+        return FormatBlock{8, 1, 1};
+    case wgpu::TextureFormat::RGBA32Float:
+    case wgpu::TextureFormat::RGBA32Uint:
+    case wgpu::TextureFormat::RGBA32Sint:
+        return FormatBlock{16, 1, 1};
+    case wgpu::TextureFormat::BC1RGBAUnorm:
+    case wgpu::TextureFormat::BC1RGBAUnormSrgb:
+    case wgpu::TextureFormat::BC4RUnorm:
+    case wgpu::TextureFormat::BC4RSnorm:
+    case wgpu::TextureFormat::ETC2RGB8Unorm:
+    case wgpu::TextureFormat::ETC2RGB8UnormSrgb:
+    case wgpu::TextureFormat::ETC2RGB8A1Unorm:
+    case wgpu::TextureFormat::ETC2RGB8A1UnormSrgb:
+    case wgpu::TextureFormat::EACR11Unorm:
+    case wgpu::TextureFormat::EACR11Snorm:
+        return FormatBlock{8, 4, 4};
+    case wgpu::TextureFormat::BC2RGBAUnorm:
+    case wgpu::TextureFormat::BC2RGBAUnormSrgb:
+    case wgpu::TextureFormat::BC3RGBAUnorm:
+    case wgpu::TextureFormat::BC3RGBAUnormSrgb:
+    case wgpu::TextureFormat::BC5RGUnorm:
+    case wgpu::TextureFormat::BC5RGSnorm:
+    case wgpu::TextureFormat::BC6HRGBUfloat:
+    case wgpu::TextureFormat::BC6HRGBFloat:
+    case wgpu::TextureFormat::BC7RGBAUnorm:
+    case wgpu::TextureFormat::BC7RGBAUnormSrgb:
+    case wgpu::TextureFormat::ETC2RGBA8Unorm:
+    case wgpu::TextureFormat::ETC2RGBA8UnormSrgb:
+    case wgpu::TextureFormat::EACRG11Unorm:
+    case wgpu::TextureFormat::EACRG11Snorm:
+    case wgpu::TextureFormat::ASTC4x4Unorm:
+    case wgpu::TextureFormat::ASTC4x4UnormSrgb:
+        return FormatBlock{16, 4, 4};
+    default:
+        return FormatBlock{4, 1, 1};
+    }
+}
+
+void add_allocation(GpuMemoryStats &stats, const uint64_t bytes)
+{
+    stats.live_bytes += bytes;
+    stats.peak_bytes = std::max(stats.peak_bytes, stats.live_bytes);
+    ++stats.live_count;
+    stats.allocated_bytes += bytes;
+    ++stats.num_allocated;
+}
+
+void add_release(GpuMemoryStats &stats, const uint64_t bytes)
+{
+    stats.live_bytes -= std::min(stats.live_bytes, bytes);
+    stats.live_count -= std::min(stats.live_count, uint64_t(1));
+    stats.released_bytes += bytes;
+    ++stats.num_released;
+}
+
+void release_locked(std::unordered_map<const void *, GpuMemoryResource>::iterator fnd)
+{
+    const GpuMemoryResource &r = fnd->second;
+    add_release(total, r.bytes);
+    add_release(categories[r.category], r.bytes);
+    add_release(frame_total, r.bytes);
+    add_release(frame_categories[r.category], r.bytes);
+    live_resources.erase(fnd);
+}
+
+void track(const void *handle, const GpuMemoryResource &resource)
+{
+    if (!handle) {
+        return;
+    }
+    const std::string &category = resource.category;
+    const uint64_t bytes = resource.bytes;
+    std::lock_guard<std::mutex> lock(tracker_mutex);
+    // A new object at the address of a tracked one means the old one was freed
+    // without being released, count it as released now
+    auto fnd = live_resources.find(handle);
+    if (fnd != live_resources.end()) {
+        release_locked(fnd);
+    }
+
+    live_resources[handle] = resource;
+
+    add_allocation(total, bytes);
+    add_allocation(categories[category], bytes);
+    add_allocation(frame_total, bytes);
+    add_allocation(frame_categories[category], bytes);
+}
+
+void untrack(const void *handle)
+{
+    if (!handle) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(tracker_mutex);
+    auto fnd = live_resources.find(handle);
+    if (fnd != live_resources.end()) {
+        release_locked(fnd);
+    }
+}
+
+void print_stats(std::ostream &os, const GpuMemoryStats &stats)
+{
+    const double mb = 1.0 / (1024.0 * 1024.0);
+    os << stats.live_bytes * mb << "MB live (" << stats.live_count << "), "
+       << stats.peak_bytes * mb << "MB peak, " << stats.allocated_bytes * mb
+       << "MB allocated (" << stats.num_allocated << "), " << stats.released_bytes * mb
+       << "MB released (" << stats.num_released << ")\n";
+}
+
+// Append the flag's name to the usage name if the usage has it
+template <typename Usage>
+void add_usage_name(std::string &name,
+                    const Usage usage,
+                    const Usage flag,
+                    const char *flag_name)
+{
+    if ((usage & flag) == Usage::None) {
+        return;
+    }
+    if (name.back() != ' ') {
+        name += "|";
+    }
+    name += flag_name;
+}
+
+}
+
+wgpu::Buffer gpu_memory_create_buffer(const wgpu::Device &device,
+                                      const wgpu::BufferDescriptor &desc,
+                                      const char *label)
+{
+    wgpu::Buffer buffer = device.CreateBuffer(&desc);
+    buffer.SetLabel(label);
+    GpuMemoryResource resource;
+    resource.label = label;
+    resource.category = std::string("buffer/") + label;
+    resource.bytes = desc.size;
+    resource.buffer_usage = desc.usage;
+    track(buffer.Get(), resource);
+    return buffer;
+}
+
+wgpu::Texture gpu_memory_create_texture(const wgpu::Device &device,
+                                        const wgpu::TextureDescriptor &desc,
+                                        const char *label)
+{
+    wgpu::Texture texture = device.CreateTexture(&desc);
+    texture.SetLabel(label);
+    GpuMemoryResource resource;
+    resource.label = label;
+    resource.category = std::string("texture/") + label;
+    resource.bytes = gpu_memory_texture_size(desc);
+    resource.texture_usage = desc.usage;
+    track(texture.Get(), resource);
+    return texture;
+}
+
+void gpu_memory_release(const wgpu::Buffer &buffer)
+{
+    untrack(buffer.Get());
+}
+
+void gpu_memory_release(const wgpu::Texture &texture)
+{
+    untrack(texture.Get());
+}
+
+uint64_t gpu_memory_texture_size(const wgpu::TextureDescriptor &desc)
+{
+    const FormatBlock block = format_block(desc.format);
+    const bool is_3d = desc.dimension == wgpu::TextureDimension::e3D;
+    uint64_t size = 0;
+    for (uint32_t i = 0; i < std::max(desc.mipLevelCount, 1u); ++i) {
+        const uint64_t width = std::max(desc.size.width >> i, 1u);
+        const uint64_t height = std::max(desc.size.height >> i, 1u);
+        const uint64_t depth = is_3d ? std::max(desc.size.depthOrArrayLayers >> i, 1u)
+                                     : desc.size.depthOrArrayLayers;
+        const uint64_t blocks_x = (width + block.width - 1) / block.width;
+        const uint64_t blocks_y = (height + block.height - 1) / block.height;
+        size += blocks_x * blocks_y * depth * block.bytes;
+    }
+    return size * std::max(desc.sampleCount, 1u);
+}
+
+GpuMemoryStats gpu_memory_total()
+{
+    std::lock_guard<std::mutex> lock(tracker_mutex);
+    return total;
+}
+
+std::map<std::string, GpuMemoryStats> gpu_memory_categories()
+{
+    std::lock_guard<std::mutex> lock(tracker_mutex);
+    return categories;
+}
+
+std::vector<GpuMemoryResource> gpu_memory_live_resources()
+{
+    std::lock_guard<std::mutex> lock(tracker_mutex);
+    std::vector<GpuMemoryResource> resources;
+    resources.reserve(live_resources.size());
+    for (const auto &r : live_resources) {
+        resources.push_back(r.second);
+    }
+    return resources;
+}
+
+std::string gpu_memory_usage_name(const GpuMemoryResource &resource)
+{
+    const bool is_buffer = resource.category.compare(0, 7, "buffer/") == 0;
+    std::string name = is_buffer ? "buffer " : "texture ";
+    if (is_buffer) {
+        using U = wgpu::BufferUsage;
+        const U usage = resource.buffer_usage;
+        add_usage_name(name, usage, U::MapRead, "MapRead");
+        add_usage_name(name, usage, U::MapWrite, "MapWrite");
+        add_usage_name(name, usage, U::CopySrc, "CopySrc");
+        add_usage_name(name, usage, U::CopyDst, "CopyDst");
+        add_usage_name(name, usage, U::Index, "Index");
+        add_usage_name(name, usage, U::Vertex, "Vertex");
+        add_usage_name(name, usage, U::Uniform, "Uniform");
+        add_usage_name(name, usage, U::Storage, "Storage");
+        add_usage_name(name, usage, U::Indirect, "Indirect");
+        add_usage_name(name, usage, U::QueryResolve, "QueryResolve");
+    } else {
+        using U = wgpu::TextureUsage;
+        const U usage = resource.texture_usage;
+        add_usage_name(name, usage, U::CopySrc, "CopySrc");
+        add_usage_name(name, usage, U::CopyDst, "CopyDst");
+        add_usage_name(name, usage, U::TextureBinding, "TextureBinding");
+        add_usage_name(name, usage, U::StorageBinding, "StorageBinding");
+        add_usage_name(name, usage, U::RenderAttachment, "RenderAttachment");
+    }
+    if (name.back() == ' ') {
+        name += "None";
+    }
+    return name;
+}
+
+void gpu_memory_set_budget(uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(tracker_mutex);
+    budget_bytes = bytes;
+}
+
+bool gpu_memory_over_budget()
+{
+    std::lock_guard<std::mutex> lock(tracker_mutex);
+    return budget_bytes > 0 && total.live_bytes > budget_bytes;
+}
+
+void gpu_memory_end_frame()
+{
+    std::lock_guard<std::mutex> lock(tracker_mutex);
+    GpuMemoryFrame frame;
+    frame.frame = num_frames++;
+    frame.total = frame_total;
+    frame.total.live_bytes = total.live_bytes;
+    frame.total.peak_bytes = total.peak_bytes;
+    frame.total.live_count = total.live_count;
+    for (const auto &c : categories) {
+        GpuMemoryStats &stats = frame.categories[c.first];
+        stats = frame_categories[c.first];
+        stats.live_bytes = c.second.live_bytes;
+        stats.peak_bytes = c.second.peak_bytes;
+        stats.live_count = c.second.live_count;
+    }
+    frame_total = GpuMemoryStats();
+    frame_categories.clear();
+    last_frame = frame;
+
+    // Only report crossing the budget, not every frame we stay over it
+    const bool over = budget_bytes > 0 && total.live_bytes > budget_bytes;
+    if (over && !over_budget) {
+        std::cout << "GPU memory over budget in frame " << frame.frame << ": "
+                  << total.live_bytes << " bytes live, budget " << budget_bytes << "\n";
+    }
+    over_budget = over;
+}
+
+GpuMemoryFrame gpu_memory_last_frame()
+{
+    std::lock_guard<std::mutex> lock(tracker_mutex);
+    return last_frame;
+}
+
+void gpu_memory_print_frame(std::ostream &os)
+{
+    const GpuMemoryFrame frame = gpu_memory_last_frame();
+    os << "GPU memory in frame " << frame.frame << ": ";
+    print_stats(os, frame.total);
+    for (const auto &c : frame.categories) {
+        os << "  " << c.first << ": ";
+        print_stats(os, c.second);
+    }
+}
+
+void gpu_memory_print_summary(std::ostream &os)
+{
+    std::lock_guard<std::mutex> lock(tracker_mutex);
+    os << "GPU memory over " << num_frames << " frames: ";
+    print_stats(os, total);
+    for (const auto &c : categories) {
+        os << "  " << c.first << ": ";
+        print_stats(os, c.second);
+    }
+
+    // Resources with the same usage flags are grouped, e.g. to see how much of the
+    // live memory is vertex data, staging or render targets
+    std::map<std::string, GpuMemoryStats> usages;
+    for (const auto &r : live_resources) {
+        GpuMemoryStats &stats = usages[gpu_memory_usage_name(r.second)];
+        stats.live_bytes += r.second.bytes;
+        ++stats.live_count;
+    }
+    const double mb = 1.0 / (1024.0 * 1024.0);
+    os << "GPU memory live by usage:\n";
+    for (const auto &u : usages) {
+        os << "  " << u.first << ": " << u.second.live_bytes * mb << "MB ("
+           << u.second.live_count << ")\n";
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+/* Accounting of the GPU memory allocated for buffers and textures. Resources
+ * are created through gpu_memory_create_buffer/texture, which label them and
+ * record their size and usage flags under a category, e.g.
+ * "buffer/staging_ring", and must be
+ * passed to gpu_memory_release when their owner drops them. WebGPU doesn't tell
+ * us when an object is actually freed, so a missed release shows up as a leak.
+ *
+ * Texture sizes are estimated from the format, extent, mip levels and sample
+ * count, the driver may pad or compress them differently.
+ */
+
+struct GpuMemoryStats {
+    uint64_t live_bytes = 0;
+    uint64_t peak_bytes = 0;
+    uint64_t live_count = 0;
+    // The churn: bytes and resources allocated and released, in total or per frame
+    uint64_t allocated_bytes = 0;
+    uint64_t released_bytes = 0;
+    uint64_t num_allocated = 0;
+    uint64_t num_released = 0;
+};
+
+// A resource the tracker counts as live
+struct GpuMemoryResource {
+    std::string label;
+    // "buffer/<label>" or "texture/<label>"
+    std::string category;
+    uint64_t bytes = 0;
+    // The usage the resource was created with, the other kind's is None
+    wgpu::BufferUsage buffer_usage = wgpu::BufferUsage::None;
+    wgpu::TextureUsage texture_usage = wgpu::TextureUsage::None;
+};
+
+struct GpuMemoryFrame {
+    uint64_t frame = 0;
+    // The live and peak sizes at the end of the frame and the churn during it
+    GpuMemoryStats total;
+    std::map<std::string, GpuMemoryStats> categories;
+};
+
+/* Create a buffer labeled with the label and track its memory under the
+ * "buffer/<label>" category
+ */
+wgpu::Buffer gpu_memory_create_buffer(const wgpu::Device &device,
+                                      const wgpu::BufferDescriptor &desc,
+                                      const char *label);
+
+/* Create a texture labeled with the label and track its memory under the
+ * "texture/<label>" category
+ */
+wgpu::Texture gpu_memory_create_texture(const wgpu::Device &device,
+                                        const wgpu::TextureDescriptor &desc,
+                                        const char *label);
+
+// Record that the owner has dropped the resource. Null or untracked handles are ignored
+void gpu_memory_release(const wgpu::Buffer &buffer);
+
+void gpu_memory_release(const wgpu::Texture &texture);
+
+// Get the size of a texture with the given descriptor, as counted by the tracker
+uint64_t gpu_memory_texture_size(const wgpu::TextureDescriptor &desc);
+
+// Get the stats over all resources since startup
+GpuMemoryStats gpu_memory_total();
+
+// Get the stats of each category since startup
+std::map<std::string, GpuMemoryStats> gpu_memory_categories();
+
+// Get the resources currently live, with their label, size and usage
+std::vector<GpuMemoryResource> gpu_memory_live_resources();
+
+// Get the resource's usage flags joined by '|', e.g. "buffer Vertex|CopyDst"
+std::string gpu_memory_usage_name(const GpuMemoryResource &resource);
+
+/* Set a budget for the live bytes, the end of any frame exceeding it is reported.
+ * 0 disables the budget
+ */
+void gpu_memory_set_budget(uint64_t bytes);
+
+bool gpu_memory_over_budget();
+
+/* Mark the end of a frame, moving the churn since the last call into the frame
+ * returned by gpu_memory_last_frame
+ */
+void gpu_memory_end_frame();
+
+GpuMemoryFrame gpu_memory_last_frame();
+
+// Print the live bytes and churn of the last frame by category
+void gpu_memory_print_frame(std::ostream &os);
+
+/* Print the live, peak and total churn by category since startup, and the live
+ * bytes broken down by usage
+ */
+void gpu_memory_print_summary(std::ostream &os);
@@ -0,0 +1,183 @@
+#include "gpu_profiler.h"
+#include <algorithm>
+#include "gpu_memory_tracker.h"
+
+GpuProfiler::GpuProfiler(const wgpu::Instance &instance,
+                         const wgpu::Device &device,
+                         uint32_t max_scopes,
+                         uint32_t num_frames,
+                         size_t window_size)
+    : device(device),
+      enabled(device.HasFeature(wgpu::FeatureName::TimestampQuery)),
+      max_scopes(max_scopes),
+      window_size(std::max(window_size, size_t(1)))
+{
+    if (!enabled) {
+        return;
+    }
+
+    // Each scope has a begin and end timestamp, stored as 64-bit ticks in nanoseconds
+    const uint32_t num_queries = 2 * max_scopes;
+    num_frames = std::max(num_frames, 1u);
+    for (uint32_t i = 0; i < num_frames; ++i) {
+        Frame f;
+        wgpu::QuerySetDescriptor query_set_desc;
+        query_set_desc.label = "GpuProfiler";
+        query_set_desc.type = wgpu::QueryType::Timestamp;
+        query_set_desc.count = num_queries;
+        f.query_set = device.CreateQuerySet(&query_set_desc);
+
+        wgpu::BufferDescriptor buffer_desc;
+        buffer_desc.size = num_queries * sizeof(uint64_t);
+        buffer_desc.usage = wgpu::BufferUsage::QueryResolve | wgpu::BufferUsage::CopySrc;
+        f.resolve_buf = gpu_memory_create_buffer(device, buffer_desc, "gpu_profiler_resolve");
+        frames.push_back(f);
+    }
+    readbacks = ReadbackRing(
+        instance, device, num_queries * sizeof(uint64_t), num_frames, "gpu_profiler_readback");
+}
+
+bool GpuProfiler::is_enabled() const
+{
+    return enabled;
+}
+
+void GpuProfiler::begin_frame()
+{
+    current = nullptr;
+    if (!enabled) {
+        return;
+    }
+
+    collect_results();
+
+    if (!readbacks.begin_frame()) {
+        ++num_dropped;
+        return;
+    }
+    current = &frames[readbacks.index()];
+    current->scope_names.clear();
+}
+
+GpuProfiler::Scope GpuProfiler::begin_scope(const wgpu::CommandEncoder &encoder,
+                                            const std::string &name)
+{
+    if (!current || current->scope_names.size() >= max_scopes) {
+        return INVALID_SCOPE;
+    }
+    const Scope scope = current->scope_names.size();
+    current->scope_names.push_back(name);
+    encoder.WriteTimestamp(current->query_set, 2 * scope);
+    return scope;
+}
+
+void GpuProfiler::end_scope(const wgpu::CommandEncoder &encoder, Scope scope)
+{
+    if (!current || scope == INVALID_SCOPE) {
+        return;
+    }
+    encoder.WriteTimestamp(current->query_set, 2 * scope + 1);
+}
+
+void GpuProfiler::resolve(const wgpu::CommandEncoder &encoder)
+{
+    if (!current || current->scope_names.empty()) {
+        return;
+    }
+    const uint32_t num_queries = 2 * current->scope_names.size();
+    encoder.ResolveQuerySet(current->query_set, 0, num_queries, current->resolve_buf, 0);
+    encoder.CopyBufferToBuffer(
+        current->resolve_buf, 0, readbacks.buffer(), 0, num_queries * sizeof(uint64_t));
+}
+
+void GpuProfiler::end_frame()
+{
+    if (!current || current->scope_names.empty()) {
+        current = nullptr;
+        return;
+    }
+
+    readbacks.end_frame(2 * current->scope_names.size() * sizeof(uint64_t));
+    current = nullptr;
+}
+
+const std::vector<GpuScopeTiming> &GpuProfiler::last_frame() const
+{
+    return last_timings;
+}
+
+uint64_t GpuProfiler::last_frame_number() const
+{
+    return last_frame_index;
+}
+
+double GpuProfiler::average_ms(const std::string &name) const
+{
+    auto fnd = stats.find(name);
+    if (fnd == stats.end() || fnd->second.samples.empty()) {
+        return 0.0;
+    }
+    double total = 0.0;
+    for (const auto &t : fnd->second.samples) {
+        total += t;
+    }
+    return total / fnd->second.samples.size();
+}
+
+void GpuProfiler::reset_stats()
+{
+    stats.clear();
+}
+
+void GpuProfiler::print_summary(std::ostream &os) const
+{
+    if (!enabled) {
+        os << "GPU profiler: timestamp queries are not supported\n";
+        return;
+    }
+    os << "GPU profiler: " << num_dropped << " frames not profiled, stats over the last "
+       << window_size << " frames\n";
+    for (const auto &s : stats) {
+        const std::deque<double> &samples = s.second.samples;
+        if (samples.empty()) {
+            continue;
+        }
+        double total = 0.0;
+        for (const auto &t : samples) {
+            total += t;
+        }
+        os << "  " << s.first
+           << ": min: " << *std::min_element(samples.begin(), samples.end())
+           << "ms, avg: " << total / samples.size()
+           << "ms, max: " << *std::max_element(samples.begin(), samples.end()) << "ms\n";
+    }
+}
+
+void GpuProfiler::collect_results()
+{
+    // The results are collected oldest first, leaving the most recent frame's
+    // results in last_timings
+    readbacks.collect([&](uint32_t index, uint64_t frame, const void *data) {
+        const Frame &f = frames[index];
+        const uint64_t *timestamps = reinterpret_cast<const uint64_t *>(data);
+
+        last_frame_index = frame;
+        last_timings.clear();
+        for (size_t i = 0; i < f.scope_names.size(); ++i) {
+            GpuScopeTiming timing;
+            timing.name = f.scope_names[i];
+            // Timestamps aren't guaranteed to be monotonic, e.g. across a
+            // power state change, so treat a negative duration as 0
+            const uint64_t begin = timestamps[2 * i];
+            const uint64_t end = timestamps[2 * i + 1];
+            timing.ms = end > begin ? (end - begin) * 1e-6 : 0.0;
+            last_timings.push_back(timing);
+
+            std::deque<double> &samples = stats[timing.name].samples;
+            samples.push_back(timing.ms);
+            if (samples.size() > window_size) {
+                samples.pop_front();
+            }
+        }
+    });
+}
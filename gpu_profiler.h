@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "readback_ring.h"
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+struct GpuScopeTiming {
+    std::string name;
+    double ms = 0.0;
+};
+
+/* Measures the GPU time of named scopes using timestamp queries. Each scope writes
+ * a timestamp at its begin and end with CommandEncoder::WriteTimestamp, and at the
+ * end of the frame the queries are resolved and copied to a readback buffer which
+ * is mapped asynchronously. A query set per buffer of a ReadbackRing is used so
+ * the CPU never waits on the readback, the results for a frame are available a
+ * few frames later through last_frame(). If all the readback buffers are still
+ * pending, or the device doesn't support TimestampQuery, the frame isn't profiled
+ * and all calls are no-ops.
+ */
+class GpuProfiler {
+public:
+    using Scope = uint32_t;
+
+    // Returned by begin_scope when the frame isn't being profiled
+    static const Scope INVALID_SCOPE = ~0u;
+
+private:
+    // The queries of the frames using each of the readback ring's buffers
+    struct Frame {
+        wgpu::QuerySet query_set;
+        wgpu::Buffer resolve_buf;
+        std::vector<std::string> scope_names;
+    };
+
+    struct ScopeStats {
+        // The most recent samples for the rolling min/avg/max
+        std::deque<double> samples;
+    };
+
+    wgpu::Device device;
+    bool enabled = false;
+    uint32_t max_scopes = 0;
+    size_t window_size = 0;
+
+    std::vector<Frame> frames;
+    ReadbackRing readbacks;
+    Frame *current = nullptr;
+    uint64_t num_dropped = 0;
+
+    uint64_t last_frame_index = 0;
+    std::vector<GpuScopeTiming> last_timings;
+    std::map<std::string, ScopeStats> stats;
+
+public:
+    GpuProfiler() = default;
+
+    /* Create a profiler tracking up to max_scopes per frame with num_frames
+     * readbacks in flight. Stats are computed over the last window_size frames.
+     */
+    GpuProfiler(const wgpu::Instance &instance,
+                const wgpu::Device &device,
+                uint32_t max_scopes = 16,
+                uint32_t num_frames = 4,
+                size_t window_size = 120);
+
+    // Check if the device supports timestamp queries
+    bool is_enabled() const;
+
+    // Collect any completed readbacks and pick the query set to use for the frame
+    void begin_frame();
+
+    Scope begin_scope(const wgpu::CommandEncoder &encoder, const std::string &name);
+
+    void end_scope(const wgpu::CommandEncoder &encoder, Scope scope);
+
+    /* Resolve the frame's queries into its readback buffer, this must be recorded
+     * after the last scope has ended
+     */
+    void resolve(const wgpu::CommandEncoder &encoder);
+
+    // Start reading back the frame's queries, must be called after Queue::Submit
+    void end_frame();
+
+    // Get the scope timings of the most recent frame whose results are available
+    const std::vector<GpuScopeTiming> &last_frame() const;
+
+    // Get the index of the frame returned by last_frame
+    uint64_t last_frame_number() const;
+
+    // Get the rolling average time of the named scope, 0 if it has no samples
+    double average_ms(const std::string &name) const;
+
+    // Clear the rolling stats, e.g. to measure a different configuration
+    void reset_stats();
+
+    // Print the rolling min/avg/max time of each scope
+    void print_summary(std::ostream &os) const;
+
+private:
+    // Read the timings from any frames whose readback has completed
+    void collect_results();
+};
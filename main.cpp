@@ -1,9 +1,19 @@
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include "arcball_camera.h"
+#include "cpu_profiler.h"
+#include "gpu_memory_tracker.h"
+#include "renderer.h"
+#include "surface_config.h"
+#include "wgpu_call_counters.h"
 #include <glm/ext.hpp>
 #include <glm/glm.hpp>
 
@@ -15,7 +25,10 @@
 #include <webgpu/webgpu_cpp.h>
 #else
 #include <dawn/dawn_proc.h>
+#include <dawn/native/DawnNative.h>
 #include <dawn/webgpu_cpp.h>
+#include "pipeline_disk_cache.h"
+#include "shader_watcher.h"
 
 // Note: include order does matter on Linux
 #include <SDL.h>
@@ -32,77 +45,63 @@
 
 #endif
 
-const std::string WGSL_SHADER = R"(
-alias float4 = vec4<f32>;
-
-struct VertexInput {
-    @location(0) position: float4,
-    @location(1) color: float4,
-};
-
-struct VertexOutput {
-    @builtin(position) position: float4,
-    @location(0) color: float4,
-};
-
-struct ViewParams {
-    view_proj: mat4x4<f32>,
+// What has changed since the last rendered frame, anything set requires a redraw
+enum DirtyFlags : uint32_t {
+    DIRTY_NONE = 0,
+    DIRTY_CAMERA = 1,
+    DIRTY_SCENE = 2,
+    DIRTY_RESIZE = 4
 };
 
-@group(0) @binding(0)
-var<uniform> view_params: ViewParams;
-
-@vertex
-fn vertex_main(vert: VertexInput) -> VertexOutput {
-    var out: VertexOutput;
-    out.color = vert.color;
-    out.position = view_params.view_proj * vert.position;
-    return out;
-};
-
-@fragment
-fn fragment_main(in: VertexOutput) -> @location(0) float4 {
-    return float4(in.color);
-}
-)";
-
-#ifndef __EMSCRIPTEN__
-dawn::native::Adapter request_adapter(dawn::native::Instance &instance,
-                                      const wgpu::BackendType backend_type)
-{
-    std::vector<dawn::native::Adapter> adapters = instance.EnumerateAdapters();
-    for (const auto &a : adapters) {
-        wgpu::AdapterProperties props;
-        a.GetProperties(&props);
-        std::cout << "Adapter name: " << props.name
-                  << ", driver desc: " << props.driverDescription << "\n";
-        if (props.backendType == backend_type) {
-            return a;
-        }
-    }
-    throw std::runtime_error("No suitable adapter found!");
-}
-#endif
-
 struct AppState {
-    wgpu::Device device;
-    wgpu::Queue queue;
+    Renderer renderer;
 
     wgpu::Surface surface;
     wgpu::SwapChain swap_chain;
-    wgpu::RenderPipeline render_pipeline;
-    wgpu::Buffer vertex_buf;
-    wgpu::Buffer view_param_buf;
-    wgpu::BindGroup bind_group;
+    SurfaceConfig surface_config;
+    // The size the swap chain was created at and the size it should be. Resize
+    // events only update the latter, and the swap chain is recreated at most once
+    // per frame when they differ, so a burst of events during a drag is coalesced
+    uint32_t swap_chain_width = 0;
+    uint32_t swap_chain_height = 0;
+    uint32_t drawable_width = 0;
+    uint32_t drawable_height = 0;
 
     ArcballCamera camera;
     glm::mat4 proj;
 
     bool done = false;
-    bool camera_changed = true;
+    uint32_t dirty = DIRTY_CAMERA | DIRTY_SCENE;
+    // Only render frames when something has changed, sleeping while idle
+    bool on_demand = false;
+    // The longest we sleep waiting for events when idle, so completed async
+    // work (e.g., staging buffer maps) is still processed
+    int idle_timeout_ms = 250;
+    // Where to write the CPU profiler's trace, on exit if set or when T is pressed
+    std::string trace_path;
+    // Print the WebGPU call counters every N frames when built with them, 0 disables
+    uint32_t api_report_interval = 0;
+    // Print the GPU memory tracker's frame summary every N frames, 0 disables
+    uint32_t memory_report_interval = 0;
+    uint64_t frame_count = 0;
+    // Pipelines are created asynchronously, while any are pending we keep drawing
+    // frames so the scene appears as soon as they're ready
+    bool pipelines_pending = true;
+    // Startup is over once all pipelines have been ready, pipelines created later,
+    // e.g. when switching shader variants, aren't reported
+    bool startup_reported = false;
+    std::chrono::steady_clock::time_point start_time;
+#ifndef __EMSCRIPTEN__
+    // Dawn's shader and pipeline blobs persisted between runs, the browser caches
+    // these itself. Must outlive the Dawn instance, which uses it as its platform
+    std::unique_ptr<PipelineDiskCache> pipeline_cache;
+    // Watches the renderer's shader directory to reload shaders when they change
+    std::unique_ptr<ShaderWatcher> shader_watcher;
+#endif
     glm::vec2 prev_mouse = glm::vec2(-2.f);
 };
 
+// The window (or canvas CSS) size, used to map mouse positions to [-1, 1]
 int win_width = 640;
 int win_height = 480;
 
@@ -113,17 +112,154 @@ glm::vec2 transform_mouse(glm::vec2 in)
 
 void loop_iteration(void *_app_state);
 
+// Mark part of the app state as changed, waking up the render loop if it's idle
+void mark_dirty(AppState *app_state, uint32_t flags);
+
+#ifndef __EMSCRIPTEN__
+void handle_event(AppState *app_state, const SDL_Event &event);
+
+// Set the drawable size to the window's size in pixels, which is larger than its
+// size in window units on HiDPI displays
+void update_drawable_size(AppState *app_state, SDL_Window *window);
+#else
+// Size the canvas to fill the window, at the display's pixel density
+int resize_callback(int type, const EmscriptenUiEvent *event, void *_app_state);
+#endif
+
+// Recreate the swap chain at the drawable size and update the projection
+void resize_swap_chain(AppState *app_state);
+
+// Export the CPU profiler's zones to the trace path, or trace.json if none was given
+void write_trace(const AppState *app_state);
+
 int main(int argc, const char **argv)
 {
+    uint32_t max_frames_in_flight = 2;
+    FramePacer::Mode pacer_mode = FramePacer::Mode::BLOCK;
+    uint32_t num_objects = 1;
+    uint32_t record_threads = 1;
+    bool bench_encode = false;
+    bool use_bundles = true;
+    bool cluster_culling = true;
+    bool gpu_driven = true;
+    bool on_demand = false;
+    int idle_timeout_ms = 250;
+    SurfaceConfig surface_config;
+    std::string trace_path;
+    uint32_t api_report_interval = 0;
+    uint32_t memory_report_interval = 0;
+    std::string pipeline_cache_dir = "pipeline_cache";
+    std::string shader_features;
+    bool set_shader_features = false;
+    bool precompile_variants = false;
+#ifdef SHADER_SOURCE_DIR
+    std::string shader_dir = SHADER_SOURCE_DIR;
+#else
+    std::string shader_dir;
+#endif
+    bool shader_reload = true;
+    std::string mesh_path;
+    MeshLoadOptions mesh_options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+            max_frames_in_flight = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--skip-frames") == 0) {
+            pacer_mode = FramePacer::Mode::SKIP;
+        } else if (std::strcmp(argv[i], "--objects") == 0 && i + 1 < argc) {
+            num_objects = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--mesh") == 0 && i + 1 < argc) {
+            mesh_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--mesh-threads") == 0 && i + 1 < argc) {
+            mesh_options.num_threads = std::max(std::atoi(argv[++i]), 0);
+        } else if (std::strcmp(argv[i], "--no-mesh-optimize") == 0) {
+            mesh_options.optimize = false;
+        } else if (std::strcmp(argv[i], "--position-error") == 0 && i + 1 < argc) {
+            mesh_options.error_bounds.position = std::max(std::atof(argv[++i]), 0.0);
+        } else if (std::strcmp(argv[i], "--no-quantize") == 0) {
+            mesh_options.error_bounds.position = 0.f;
+            mesh_options.error_bounds.color = 0.f;
+            mesh_options.error_bounds.normal_degrees = 0.f;
+        } else if (std::strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc) {
+            record_threads = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--bench-encode") == 0) {
+            bench_encode = true;
+        } else if (std::strcmp(argv[i], "--no-bundles") == 0) {
+            use_bundles = false;
+        } else if (std::strcmp(argv[i], "--no-cluster-cull") == 0) {
+            cluster_culling = false;
+        } else if (std::strcmp(argv[i], "--no-gpu-driven") == 0) {
+            gpu_driven = false;
+        } else if (std::strcmp(argv[i], "--on-demand") == 0) {
+            on_demand = true;
+        } else if (std::strcmp(argv[i], "--idle-timeout") == 0 && i + 1 < argc) {
+            idle_timeout_ms = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--api-report") == 0 && i + 1 < argc) {
+            api_report_interval = std::max(std::atoi(argv[++i]), 0);
+        } else if (std::strcmp(argv[i], "--memory-report") == 0 && i + 1 < argc) {
+            memory_report_interval = std::max(std::atoi(argv[++i]), 0);
+        } else if (std::strcmp(argv[i], "--memory-budget") == 0 && i + 1 < argc) {
+            // In MB
+            gpu_memory_set_budget(uint64_t(std::max(std::atoi(argv[++i]), 0)) << 20);
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--pipeline-cache") == 0 && i + 1 < argc) {
+            pipeline_cache_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--no-pipeline-cache") == 0) {
+            pipeline_cache_dir.clear();
+        } else if (std::strcmp(argv[i], "--shader-features") == 0 && i + 1 < argc) {
+            shader_features = argv[++i];
+            set_shader_features = true;
+        } else if (std::strcmp(argv[i], "--precompile-variants") == 0) {
+            precompile_variants = true;
+        } else if (std::strcmp(argv[i], "--shader-dir") == 0 && i + 1 < argc) {
+            shader_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--no-shader-reload") == 0) {
+            shader_reload = false;
+        } else if (std::strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc) {
+            if (!parse_present_mode(argv[++i], surface_config.present_mode)) {
+                std::cout << "Unknown present mode " << argv[i]
+                          << ", expected fifo, mailbox or immediate\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--surface-format") == 0 && i + 1 < argc) {
+            if (!parse_surface_format(argv[++i], surface_config.format)) {
+                std::cout << "Unknown surface format " << argv[i]
+                          << ", expected bgra8unorm, rgba8unorm or rgba16float\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--surface-usage") == 0 && i + 1 < argc) {
+            if (!parse_surface_usage(argv[++i], surface_config.usage)) {
+                std::cout << "Unknown surface usage in " << argv[i] << ", expected a list of "
+                          << "render, copy-src, copy-dst, texture-binding or storage\n";
+                return 1;
+            }
+        }
+    }
+
+    cpu_profiler_set_thread_name("main");
+    CPU_ZONE_BEGIN(startup_zone, "startup");
+
     AppState *app_state = new AppState;
+    app_state->start_time = std::chrono::steady_clock::now();
 
 #ifdef __EMSCRIPTEN__
-    app_state->device = wgpu::Device::Acquire(emscripten_webgpu_get_device());
+    app_state->renderer.device = wgpu::Device::Acquire(emscripten_webgpu_get_device());
 
     wgpu::InstanceDescriptor instance_desc;
     wgpu::Instance instance = wgpu::CreateInstance(&instance_desc);
 #else
-    dawn::native::Instance dawn_instance;
+    dawn::native::DawnInstanceDescriptor dawn_instance_desc;
+    if (!pipeline_cache_dir.empty()) {
+        app_state->pipeline_cache.reset(new PipelineDiskCache(pipeline_cache_dir));
+        dawn_instance_desc.platform = app_state->pipeline_cache.get();
+    }
+
+    // Timed waits are needed for the frame pacer to block on submitted work
+    wgpu::InstanceDescriptor instance_desc;
+    instance_desc.nextInChain = &dawn_instance_desc;
+    instance_desc.features.timedWaitAnyEnable = true;
+    dawn::native::Instance dawn_instance(
+        reinterpret_cast<const WGPUInstanceDescriptor *>(&instance_desc));
 
 #if defined(_WIN32)
     const auto backend_type = wgpu::BackendType::D3D12;
@@ -133,37 +269,68 @@ int main(int argc, const char **argv)
     const auto backend_type = wgpu::BackendType::Vulkan;
 #endif
 
+    CPU_ZONE_BEGIN(adapter_zone, "request_adapter");
     auto adapter = request_adapter(dawn_instance, backend_type);
-    DawnProcTable procs(dawn::native::GetProcs());
-    dawnProcSetProcs(&procs);
+    CPU_ZONE_END(adapter_zone);
 
     wgpu::Instance instance = dawn_instance.Get();
-    app_state->device = wgpu::Device::Acquire(adapter.CreateDevice());
+    CPU_ZONE_BEGIN(device_zone, "create_device");
+    app_state->renderer.device = create_device(adapter, record_threads > 1 || bench_encode);
+    CPU_ZONE_END(device_zone);
+    if ((record_threads > 1 || bench_encode) &&
+        !app_state->renderer.device.HasFeature(
+            wgpu::FeatureName::ImplicitDeviceSynchronization)) {
+        std::cout << "ImplicitDeviceSynchronization is not supported, "
+                  << "falling back to single threaded recording\n";
+        record_threads = 1;
+        bench_encode = false;
+    }
 
     SDL_Window *window = SDL_CreateWindow("wgpu-starter",
                                           SDL_WINDOWPOS_CENTERED,
                                           SDL_WINDOWPOS_CENTERED,
                                           win_width,
                                           win_height,
-                                          0);
+                                          SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
 
 #endif
-    app_state->device.SetUncapturedErrorCallback(
-        [](WGPUErrorType type, const char *msg, void *data) {
-            std::cout << "WebGPU Error: " << msg << "\n" << std::flush;
-            std::exit(1);
-        },
-        nullptr);
+    Renderer &renderer = app_state->renderer;
+    if (set_shader_features &&
+        !renderer.scene_variants.parse_features(shader_features, renderer.scene_variant)) {
+        std::cout << "Unknown shader feature in " << shader_features
+                  << ", expected a list of VERTEX_COLORS, SRGB_ENCODE or LIGHTING\n";
+        return 1;
+    }
+    renderer.shader_dir = shader_dir;
+    renderer.errors = ErrorReporter(renderer.device);
+    renderer.object_cache = ObjectCache(renderer.device);
+    renderer.pipelines = PipelineLoader(renderer.device);
 
     /*
-    app_state->device.SetLoggingCallback(
+    renderer.device.SetLoggingCallback(
         [](WGPULoggingType type, const char *msg, void *data) {
             std::cout << "WebGPU Log: " << msg << "\n" << std::flush;
         },
         nullptr);
         */
 
-    app_state->queue = app_state->device.GetQueue();
+    renderer.instance = instance;
+    renderer.queue = renderer.device.GetQueue();
+    renderer.staging_ring = StagingRing(renderer.device);
+    renderer.frame_pacer =
+        FramePacer(instance, renderer.queue, max_frames_in_flight, pacer_mode);
+    renderer.recorder.reset(new ParallelRecorder(record_threads));
+    renderer.use_bundles = use_bundles;
+    renderer.cluster_culling = cluster_culling;
+    renderer.gpu_driven = gpu_driven;
+    renderer.vertex_error_bounds = mesh_options.error_bounds;
+    renderer.render_graph = RenderGraph(renderer.device);
+    renderer.gpu_profiler = GpuProfiler(instance, renderer.device);
+    app_state->on_demand = on_demand;
+    app_state->trace_path = trace_path;
+    app_state->api_report_interval = api_report_interval;
+    app_state->memory_report_interval = memory_report_interval;
+    app_state->idle_timeout_ms = idle_timeout_ms;
 
 #ifdef __EMSCRIPTEN__
     wgpu::SurfaceDescriptorFromCanvasHTMLSelector selector;
@@ -205,165 +372,81 @@ int main(int argc, const char **argv)
 
     app_state->surface = instance.CreateSurface(&surface_desc);
 
-    wgpu::SwapChainDescriptor swap_chain_desc;
-    swap_chain_desc.format = wgpu::TextureFormat::BGRA8Unorm;
-    swap_chain_desc.usage = wgpu::TextureUsage::RenderAttachment;
-    swap_chain_desc.presentMode = wgpu::PresentMode::Fifo;
-    swap_chain_desc.width = win_width;
-    swap_chain_desc.height = win_height;
-
-    app_state->swap_chain =
-        app_state->device.CreateSwapChain(app_state->surface, &swap_chain_desc);
-
-    wgpu::ShaderModule shader_module;
-    {
-        wgpu::ShaderModuleWGSLDescriptor shader_module_wgsl;
-        shader_module_wgsl.code = WGSL_SHADER.c_str();
-
-        wgpu::ShaderModuleDescriptor shader_module_desc;
-        shader_module_desc.nextInChain = &shader_module_wgsl;
-        shader_module = app_state->device.CreateShaderModule(&shader_module_desc);
-
-        // TODO: Status always seems to be success even when there are errors?
-        // Unimplemented on Emscripten? Did the name change?
-        /*
-        shader_module.GetCompilationInfo(
-            [](WGPUCompilationInfoRequestStatus status,
-               WGPUCompilationInfo const *info,
-               void *) {
-                if (info->messageCount != 0) {
-                    std::cout << "Shader compilation info:\n";
-                    for (uint32_t i = 0; i < info->messageCount; ++i) {
-                        const auto &m = info->messages[i];
-                        std::cout << m.lineNum << ":" << m.linePos << ": ";
-                        switch (m.type) {
-                        case WGPUCompilationMessageType_Error:
-                            std::cout << "error";
-                            break;
-                        case WGPUCompilationMessageType_Warning:
-                            std::cout << "warning";
-                            break;
-                        case WGPUCompilationMessageType_Info:
-                            std::cout << "info";
-                            break;
-                        case WGPUCompilationMessageType_Force32:
-                            std::cout << "force32";
-                            break;
-                        default:
-                            break;
-                        }
-
-                        std::cout << ": " << m.message << "\n";
-                    }
-                }
-            },
-            nullptr);
-            */
-    }
-
-    // Upload vertex data
-    const std::vector<float> vertex_data = {
-        1,  -1, 0, 1,  // position
-        1,  0,  0, 1,  // color
-        -1, -1, 0, 1,  // position
-        0,  1,  0, 1,  // color
-        0,  1,  0, 1,  // position
-        0,  0,  1, 1,  // color
-    };
-    wgpu::BufferDescriptor buffer_desc;
-    buffer_desc.mappedAtCreation = true;
-    buffer_desc.size = vertex_data.size() * sizeof(float);
-    buffer_desc.usage = wgpu::BufferUsage::Vertex;
-    app_state->vertex_buf = app_state->device.CreateBuffer(&buffer_desc);
-    std::memcpy(app_state->vertex_buf.GetMappedRange(), vertex_data.data(), buffer_desc.size);
-    app_state->vertex_buf.Unmap();
-
-    std::array<wgpu::VertexAttribute, 2> vertex_attributes;
-    vertex_attributes[0].format = wgpu::VertexFormat::Float32x4;
-    vertex_attributes[0].offset = 0;
-    vertex_attributes[0].shaderLocation = 0;
-
-    vertex_attributes[1].format = wgpu::VertexFormat::Float32x4;
-    vertex_attributes[1].offset = 4 * 4;
-    vertex_attributes[1].shaderLocation = 1;
-
-    wgpu::VertexBufferLayout vertex_buf_layout;
-    vertex_buf_layout.arrayStride = 2 * 4 * 4;
-    vertex_buf_layout.attributeCount = vertex_attributes.size();
-    vertex_buf_layout.attributes = vertex_attributes.data();
-
-    wgpu::VertexState vertex_state;
-    vertex_state.module = shader_module;
-    vertex_state.entryPoint = "vertex_main";
-    vertex_state.bufferCount = 1;
-    vertex_state.buffers = &vertex_buf_layout;
-
-    wgpu::ColorTargetState render_target_state;
-    render_target_state.format = wgpu::TextureFormat::BGRA8Unorm;
-
-    wgpu::FragmentState fragment_state;
-    fragment_state.module = shader_module;
-    fragment_state.entryPoint = "fragment_main";
-    fragment_state.targetCount = 1;
-    fragment_state.targets = &render_target_state;
-
-    wgpu::BindGroupLayoutEntry view_param_layout_entry = {};
-    view_param_layout_entry.binding = 0;
-    view_param_layout_entry.buffer.hasDynamicOffset = false;
-    view_param_layout_entry.buffer.type = wgpu::BufferBindingType::Uniform;
-    view_param_layout_entry.visibility = wgpu::ShaderStage::Vertex;
-
-    wgpu::BindGroupLayoutDescriptor view_params_bg_layout_desc = {};
-    view_params_bg_layout_desc.entryCount = 1;
-    view_params_bg_layout_desc.entries = &view_param_layout_entry;
-
-    wgpu::BindGroupLayout view_params_bg_layout =
-        app_state->device.CreateBindGroupLayout(&view_params_bg_layout_desc);
-
-    wgpu::PipelineLayoutDescriptor pipeline_layout_desc = {};
-    pipeline_layout_desc.bindGroupLayoutCount = 1;
-    pipeline_layout_desc.bindGroupLayouts = &view_params_bg_layout;
-
-    wgpu::PipelineLayout pipeline_layout =
-        app_state->device.CreatePipelineLayout(&pipeline_layout_desc);
-
-    wgpu::RenderPipelineDescriptor render_pipeline_desc;
-    render_pipeline_desc.vertex = vertex_state;
-    render_pipeline_desc.fragment = &fragment_state;
-    render_pipeline_desc.layout = pipeline_layout;
-    // Default primitive state is what we want, triangle list, no indices
-
-    app_state->render_pipeline = app_state->device.CreateRenderPipeline(&render_pipeline_desc);
-
-    // Create the UBO for our bind group
-    wgpu::BufferDescriptor ubo_buffer_desc;
-    ubo_buffer_desc.mappedAtCreation = false;
-    ubo_buffer_desc.size = 16 * sizeof(float);
-    ubo_buffer_desc.usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::CopyDst;
-    app_state->view_param_buf = app_state->device.CreateBuffer(&ubo_buffer_desc);
-
-    wgpu::BindGroupEntry view_param_bg_entry = {};
-    view_param_bg_entry.binding = 0;
-    view_param_bg_entry.buffer = app_state->view_param_buf;
-    view_param_bg_entry.size = ubo_buffer_desc.size;
-
-    wgpu::BindGroupDescriptor bind_group_desc = {};
-    bind_group_desc.layout = view_params_bg_layout;
-    bind_group_desc.entryCount = 1;
-    bind_group_desc.entries = &view_param_bg_entry;
-
-    app_state->bind_group = app_state->device.CreateBindGroup(&bind_group_desc);
+    app_state->surface_config = surface_config;
+#ifdef __EMSCRIPTEN__
+    resize_callback(0, nullptr, app_state);
+#else
+    update_drawable_size(app_state, window);
+#endif
+    resize_swap_chain(app_state);
+    if (!app_state->swap_chain) {
+        return 1;
+    }
+    std::cout << "Swap chain: requested present mode "
+              << present_mode_name(app_state->surface_config.present_mode) << ", format "
+              << surface_format_name(app_state->surface_config.format) << "\n";
+
+    if (!mesh_path.empty()) {
+        MeshLoadStats mesh_stats;
+        try {
+            renderer.mesh = load_mesh(renderer.device, mesh_path, mesh_options, &mesh_stats);
+        } catch (const std::exception &e) {
+            std::cout << e.what() << "\n";
+            return 1;
+        }
+        mesh_stats.print(std::cout);
+    }
+    create_scene(&renderer, app_state->surface_config.format, num_objects);
+    if (precompile_variants) {
+        precompile_scene_variants(&renderer);
+    }
+#ifndef __EMSCRIPTEN__
+    if (app_state->pipeline_cache) {
+        prewarm_pipelines(&renderer, app_state->pipeline_cache->load_prewarm_list());
+    }
+    if (shader_reload && !shader_dir.empty()) {
+        app_state->shader_watcher.reset(new ShaderWatcher(shader_dir, shader_files()));
+    }
+#endif
 
-    app_state->proj = glm::perspective(
-        glm::radians(50.f), static_cast<float>(win_width) / win_height, 0.1f, 100.f);
     app_state->camera = ArcballCamera(glm::vec3(0, 0, -2.5), glm::vec3(0), glm::vec3(0, 1, 0));
 
+    CPU_ZONE_END(startup_zone);
+
 #ifdef __EMSCRIPTEN__
+    emscripten_set_resize_callback(
+        EMSCRIPTEN_EVENT_TARGET_WINDOW, app_state, true, resize_callback);
     emscripten_set_main_loop_arg(loop_iteration, app_state, -1, 0);
 #else
+    if (bench_encode) {
+        benchmark_encoding(&renderer, win_width, win_height);
+        SDL_DestroyWindow(window);
+        return 0;
+    }
+
     while (!app_state->done) {
         loop_iteration(app_state);
     }
+    std::cout << "Requested present mode: "
+              << present_mode_name(app_state->surface_config.present_mode) << "\n";
+    renderer.frame_pacer.print_summary(std::cout);
+    renderer.bundle_cache.print_stats(std::cout);
+    renderer.render_graph.print_stats(std::cout);
+    renderer.object_cache.print_stats(std::cout);
+    renderer.pipelines.print_stats(std::cout);
+    if (app_state->pipeline_cache) {
+        app_state->pipeline_cache->print_stats(std::cout);
+        app_state->pipeline_cache->save_prewarm_list(renderer.pipelines.ready_names());
+    }
+    renderer.gpu_profiler.print_summary(std::cout);
+    renderer.cluster_culler.print_summary(std::cout);
+    renderer.object_culler.print_summary(std::cout);
+    wgpu_counters_print_summary(std::cout);
+    gpu_memory_print_summary(std::cout);
+    renderer.errors.print_summary(std::cout);
+    if (!app_state->trace_path.empty()) {
+        write_trace(app_state);
+    }
     SDL_DestroyWindow(window);
 #endif
     return 0;
@@ -379,10 +462,10 @@ int mouse_move_callback(int type, const EmscriptenMouseEvent *event, void *_app_
     if (app_state->prev_mouse != glm::vec2(-2.f)) {
         if (event->buttons & 1) {
             app_state->camera.rotate(app_state->prev_mouse, cur_mouse);
-            app_state->camera_changed = true;
+            mark_dirty(app_state, DIRTY_CAMERA);
         } else if (event->buttons & 2) {
             app_state->camera.pan(cur_mouse - app_state->prev_mouse);
-            app_state->camera_changed = true;
+            mark_dirty(app_state, DIRTY_CAMERA);
         }
     }
     app_state->prev_mouse = cur_mouse;
@@ -395,7 +478,24 @@ int mouse_wheel_callback(int type, const EmscriptenWheelEvent *event, void *_app
     AppState *app_state = reinterpret_cast<AppState *>(_app_state);
 
     app_state->camera.zoom(event->deltaY * 0.00005f);
-    app_state->camera_changed = true;
+    mark_dirty(app_state, DIRTY_CAMERA);
+    return true;
+}
+
+int resize_callback(int type, const EmscriptenUiEvent *event, void *_app_state)
+{
+    AppState *app_state = reinterpret_cast<AppState *>(_app_state);
+
+    double css_width = 0;
+    double css_height = 0;
+    emscripten_get_element_css_size("#webgpu-canvas", &css_width, &css_height);
+    win_width = css_width;
+    win_height = css_height;
+
+    const double pixel_ratio = emscripten_get_device_pixel_ratio();
+    app_state->drawable_width = css_width * pixel_ratio;
+    app_state->drawable_height = css_height * pixel_ratio;
+    mark_dirty(app_state, DIRTY_RESIZE);
     return true;
 }
 #endif
@@ -403,89 +503,258 @@ int mouse_wheel_callback(int type, const EmscriptenWheelEvent *event, void *_app
 void loop_iteration(void *_app_state)
 {
     AppState *app_state = reinterpret_cast<AppState *>(_app_state);
+    CPU_ZONE("loop_iteration");
 #ifndef __EMSCRIPTEN__
+    CPU_ZONE_BEGIN(events_zone, "poll_events");
     SDL_Event event;
     // TODO: Because I don't make the window/canvas with SDL_CreateWindow
     // it won't attach the listeners properly to get events with SDL.
     // So I need to use the Emscripten HTML5 input API to get events instead
-    while (SDL_PollEvent(&event)) {
-        if (event.type == SDL_QUIT) {
-            app_state->done = true;
-        }
-        if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE) {
-            app_state->done = true;
+    if (app_state->on_demand && app_state->dirty == DIRTY_NONE) {
+        // Nothing to draw, so sleep until we get an event or hit the idle timeout
+        if (SDL_WaitEventTimeout(&event, app_state->idle_timeout_ms)) {
+            handle_event(app_state, event);
         }
-        if (event.type == SDL_MOUSEMOTION) {
-            const glm::vec2 cur_mouse =
-                transform_mouse(glm::vec2(event.motion.x, event.motion.y));
-            if (app_state->prev_mouse != glm::vec2(-2.f)) {
-                if (event.motion.state & SDL_BUTTON_LMASK) {
-                    app_state->camera.rotate(app_state->prev_mouse, cur_mouse);
-                    app_state->camera_changed = true;
-                } else if (event.motion.state & SDL_BUTTON_RMASK) {
-                    app_state->camera.pan(cur_mouse - app_state->prev_mouse);
-                    app_state->camera_changed = true;
-                }
+    }
+    while (SDL_PollEvent(&event)) {
+        handle_event(app_state, event);
+    }
+    // Process any completed async operations, e.g., staging buffer maps and error scopes
+    app_state->renderer.instance.ProcessEvents();
+    CPU_ZONE_END(events_zone);
+
+    // Pick up shader changes at the frame boundary, the scene keeps drawing with
+    // the previous pipelines while the new ones compile
+    if (app_state->shader_watcher) {
+        for (const auto &change : app_state->shader_watcher->poll_changes()) {
+            std::cout << "Reloading " << change.file << "\n";
+            if (reload_shader(&app_state->renderer, change.file, change.source)) {
+                app_state->pipelines_pending = true;
+                app_state->dirty |= DIRTY_SCENE;
             }
-            app_state->prev_mouse = cur_mouse;
-        }
-        if (event.type == SDL_MOUSEWHEEL) {
-            app_state->camera.zoom(event.wheel.y * 0.05f);
-            app_state->camera_changed = true;
         }
     }
 #else
     emscripten_set_mousemove_callback("#webgpu-canvas", app_state, true, mouse_move_callback);
     emscripten_set_wheel_callback("#webgpu-canvas", app_state, true, mouse_wheel_callback);
 #endif
+    app_state->renderer.errors.report(std::cout);
+
+    // Check before drawing, so the frame where the last pipeline became ready is
+    // the one reported as the first complete frame
+    const bool pipelines_were_pending = app_state->pipelines_pending;
+    if (pipelines_were_pending) {
+        app_state->dirty |= DIRTY_SCENE;
+        app_state->pipelines_pending = app_state->renderer.pipelines.num_pending() > 0;
+    }
+
+    if (app_state->on_demand && app_state->dirty == DIRTY_NONE) {
+#ifdef __EMSCRIPTEN__
+        // Stop requesting animation frames until an input callback marks us dirty again
+        emscripten_pause_main_loop();
+#endif
+        return;
+    }
 
-    wgpu::Buffer upload_buf;
-    if (app_state->camera_changed) {
-        wgpu::BufferDescriptor upload_buffer_desc;
-        upload_buffer_desc.mappedAtCreation = true;
-        upload_buffer_desc.size = 16 * sizeof(float);
-        upload_buffer_desc.usage = wgpu::BufferUsage::CopySrc;
-        upload_buf = app_state->device.CreateBuffer(&upload_buffer_desc);
+    // Nothing can be presented while the window is minimized
+    if (app_state->drawable_width == 0 || app_state->drawable_height == 0) {
+        return;
+    }
 
-        const glm::mat4 proj_view = app_state->proj * app_state->camera.transform();
+    // If the GPU is too far behind, skip the frame. Any pending changes are kept
+    // and picked up on the next frame we do render.
+    CPU_ZONE_BEGIN(pacer_zone, "frame_pacer_wait");
+    if (!app_state->renderer.frame_pacer.begin_frame()) {
+        return;
+    }
+    CPU_ZONE_END(pacer_zone);
 
-        std::memcpy(
-            upload_buf.GetMappedRange(), glm::value_ptr(proj_view), 16 * sizeof(float));
-        upload_buf.Unmap();
+    if (app_state->drawable_width != app_state->swap_chain_width ||
+        app_state->drawable_height != app_state->swap_chain_height) {
+        resize_swap_chain(app_state);
     }
 
-    wgpu::RenderPassColorAttachment color_attachment;
-    color_attachment.view = app_state->swap_chain.GetCurrentTextureView();
-    color_attachment.clearValue.r = 0.f;
-    color_attachment.clearValue.g = 0.f;
-    color_attachment.clearValue.b = 0.f;
-    color_attachment.clearValue.a = 1.f;
-    color_attachment.loadOp = wgpu::LoadOp::Clear;
-    color_attachment.storeOp = wgpu::StoreOp::Store;
+    CPU_ZONE_BEGIN(acquire_zone, "acquire_image");
+    const wgpu::TextureView target = app_state->swap_chain.GetCurrentTextureView();
+    CPU_ZONE_END(acquire_zone);
 
-    wgpu::RenderPassDescriptor pass_desc;
-    pass_desc.colorAttachmentCount = 1;
-    pass_desc.colorAttachments = &color_attachment;
+    if (app_state->dirty & DIRTY_CAMERA) {
+        const glm::mat4 proj_view = app_state->proj * app_state->camera.transform();
+        render_frame(&app_state->renderer, target, &proj_view);
+    } else {
+        render_frame(&app_state->renderer, target, nullptr);
+    }
+
+#ifndef __EMSCRIPTEN__
+    CPU_ZONE_BEGIN(present_zone, "present");
+    app_state->swap_chain.Present();
+    CPU_ZONE_END(present_zone);
+#endif
+    // Track the frame after presenting so its latency includes the present
+    app_state->renderer.frame_pacer.end_frame();
+    app_state->dirty = DIRTY_NONE;
+
+    const double elapsed_ms = std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - app_state->start_time)
+                                  .count();
+    if (app_state->frame_count == 0) {
+        std::cout << "Time to first frame: " << elapsed_ms << "ms\n";
+    }
+    if (pipelines_were_pending && !app_state->pipelines_pending &&
+        !app_state->startup_reported) {
+        app_state->startup_reported = true;
+        std::cout << "Time to first frame with all pipelines ready: " << elapsed_ms << "ms";
+#ifndef __EMSCRIPTEN__
+        const PipelineDiskCache *cache = app_state->pipeline_cache.get();
+        if (cache) {
+            std::cout << " (" << (cache->is_warm() ? "warm" : "cold")
+                      << " pipeline cache, " << cache->hit_rate() * 100.0 << "% hit rate)";
+        }
+#endif
+        std::cout << "\n";
+    }
 
-    wgpu::CommandEncoder encoder = app_state->device.CreateCommandEncoder();
-    if (app_state->camera_changed) {
-        encoder.CopyBufferToBuffer(
-            upload_buf, 0, app_state->view_param_buf, 0, 16 * sizeof(float));
+    wgpu_counters_end_frame();
+    gpu_memory_end_frame();
+    ++app_state->frame_count;
+    if (app_state->api_report_interval > 0 &&
+        app_state->frame_count % app_state->api_report_interval == 0) {
+        wgpu_counters_print_frame(std::cout);
+    }
+    if (app_state->memory_report_interval > 0 &&
+        app_state->frame_count % app_state->memory_report_interval == 0) {
+        gpu_memory_print_frame(std::cout);
     }
+}
+
+void resize_swap_chain(AppState *app_state)
+{
+    CPU_ZONE("resize_swap_chain");
+    const uint32_t width = app_state->drawable_width;
+    const uint32_t height = app_state->drawable_height;
+#ifdef __EMSCRIPTEN__
+    emscripten_set_canvas_element_size("#webgpu-canvas", width, height);
+#endif
+    // Release the old swap chain first, a surface can only have one at a time
+    app_state->swap_chain = wgpu::SwapChain();
+    app_state->swap_chain = create_swap_chain(app_state->renderer.instance,
+                                              app_state->renderer.device,
+                                              app_state->surface,
+                                              width,
+                                              height,
+                                              app_state->surface_config);
+    app_state->swap_chain_width = width;
+    app_state->swap_chain_height = height;
+
+    // Attachments sized to match the swap chain, e.g. render graph transients, are
+    // reallocated when they're next used at the new size
+    app_state->proj = glm::perspective(
+        glm::radians(50.f), static_cast<float>(width) / height, 0.1f, 100.f);
+    app_state->dirty |= DIRTY_CAMERA;
+}
 
-    wgpu::RenderPassEncoder render_pass_enc = encoder.BeginRenderPass(&pass_desc);
-    render_pass_enc.SetPipeline(app_state->render_pipeline);
-    render_pass_enc.SetVertexBuffer(0, app_state->vertex_buf);
-    render_pass_enc.SetBindGroup(0, app_state->bind_group);
-    render_pass_enc.Draw(3);
-    render_pass_enc.End();
+void write_trace(const AppState *app_state)
+{
+    const std::string path =
+        app_state->trace_path.empty() ? "trace.json" : app_state->trace_path;
+    if (cpu_profiler_write_trace(path)) {
+        std::cout << "Wrote CPU profile trace to " << path << "\n";
+    } else {
+#ifdef CPU_PROFILER_ENABLED
+        std::cout << "Failed to write CPU profile trace to " << path << "\n";
+#else
+        std::cout << "The CPU profiler is disabled, build with -DCPU_PROFILER=ON\n";
+#endif
+    }
+}
 
-    wgpu::CommandBuffer commands = encoder.Finish();
-    // Here the # refers to the number of command buffers being submitted
-    app_state->queue.Submit(1, &commands);
+void mark_dirty(AppState *app_state, uint32_t flags)
+{
+#ifdef __EMSCRIPTEN__
+    if (app_state->on_demand && app_state->dirty == DIRTY_NONE) {
+        emscripten_resume_main_loop();
+    }
+#endif
+    app_state->dirty |= flags;
+}
 
 #ifndef __EMSCRIPTEN__
-    app_state->swap_chain.Present();
+void handle_event(AppState *app_state, const SDL_Event &event)
+{
+    if (event.type == SDL_QUIT) {
+        app_state->done = true;
+    }
+    if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE) {
+        app_state->done = true;
+    }
+    if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_t) {
+        write_trace(app_state);
+    }
+    if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_v) {
+        // Cycle through the scene shader's variants
+        Renderer &renderer = app_state->renderer;
+        const size_t num_variants = renderer.scene_variants.all_variants().size();
+        set_scene_variant(&renderer, (renderer.scene_variant + 1) % num_variants);
+        std::cout << "Scene shader variant: "
+                  << renderer.scene_variants.name(renderer.scene_variant) << "\n";
+        app_state->pipelines_pending = true;
+        mark_dirty(app_state, DIRTY_SCENE);
+    }
+    if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_c) {
+        // Compare the scene's GPU time with and without culling the clusters
+        Renderer &renderer = app_state->renderer;
+        renderer.cluster_culling = !renderer.cluster_culling;
+        std::cout << "Cluster culling: " << (renderer.cluster_culling ? "on" : "off") << "\n";
+        mark_dirty(app_state, DIRTY_SCENE);
+    }
+    if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_g) {
+        // Compare drawing each object from the CPU with the GPU driven draws
+        Renderer &renderer = app_state->renderer;
+        renderer.gpu_driven = !renderer.gpu_driven;
+        std::cout << "GPU driven drawing: " << (renderer.gpu_driven ? "on" : "off") << "\n";
+        mark_dirty(app_state, DIRTY_SCENE);
+    }
+    if (event.type == SDL_MOUSEMOTION) {
+        const glm::vec2 cur_mouse = transform_mouse(glm::vec2(event.motion.x, event.motion.y));
+        if (app_state->prev_mouse != glm::vec2(-2.f)) {
+            if (event.motion.state & SDL_BUTTON_LMASK) {
+                app_state->camera.rotate(app_state->prev_mouse, cur_mouse);
+                mark_dirty(app_state, DIRTY_CAMERA);
+            } else if (event.motion.state & SDL_BUTTON_RMASK) {
+                app_state->camera.pan(cur_mouse - app_state->prev_mouse);
+                mark_dirty(app_state, DIRTY_CAMERA);
+            }
+        }
+        app_state->prev_mouse = cur_mouse;
+    }
+    if (event.type == SDL_MOUSEWHEEL) {
+        app_state->camera.zoom(event.wheel.y * 0.05f);
+        mark_dirty(app_state, DIRTY_CAMERA);
+    }
+    if (event.type == SDL_WINDOWEVENT) {
+        if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+            // The event's size is in window units, which the mouse positions use
+            win_width = event.window.data1;
+            win_height = event.window.data2;
+            update_drawable_size(app_state, SDL_GetWindowFromID(event.window.windowID));
+            mark_dirty(app_state, DIRTY_RESIZE);
+        } else if (event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+            mark_dirty(app_state, DIRTY_RESIZE);
+        }
+    }
+}
+
+void update_drawable_size(AppState *app_state, SDL_Window *window)
+{
+    int width = win_width;
+    int height = win_height;
+#if SDL_VERSION_ATLEAST(2, 26, 0)
+    SDL_GetWindowSizeInPixels(window, &width, &height);
+#else
+    // Older SDL can't query the pixel size, so HiDPI windows render at window units
+    (void)window;
 #endif
-    app_state->camera_changed = false;
+    app_state->drawable_width = width;
+    app_state->drawable_height = height;
 }
+#endif
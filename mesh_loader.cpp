@@ -0,0 +1,2117 @@
+#include "mesh_loader.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "cpu_profiler.h"
+#include "gpu_memory_tracker.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Text is split into chunks of about this size, so a few large files can still be
+// balanced across the threads
+const size_t TEXT_CHUNK_BYTES = 4 << 20;
+// Binary data is split into chunks of this many vertices, faces or indices
+const uint64_t BINARY_CHUNK_ITEMS = 1 << 18;
+
+/* A read-only memory mapping of a file. The pages are read in as they're first
+ * touched, and can be dropped from our resident memory once they've been parsed.
+ */
+class MappedFile {
+    const char *data = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+public:
+    // Map the file, throws if it can't be opened or is empty
+    explicit MappedFile(const std::string &path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *begin() const
+    {
+        return data;
+    }
+
+    const char *end() const
+    {
+        return data + length;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    /* Drop the pages fully inside [begin, end) from our resident memory. They're
+     * read back from the page cache if touched again.
+     */
+    void release(const char *range_begin, const char *range_end) const;
+};
+
+MappedFile::MappedFile(const std::string &path)
+{
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(),
+                       GENERIC_READ,
+                       FILE_SHARE_READ,
+                       nullptr,
+                       OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                       nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        throw std::runtime_error(path + " is empty");
+    }
+    length = static_cast<size_t>(file_size.QuadPart);
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping) {
+        data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (!data) {
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        throw std::runtime_error("Failed to map " + path);
+    }
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        throw std::runtime_error(path + " is empty");
+    }
+    length = static_cast<size_t>(st.st_size);
+    void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file open
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Failed to map " + path);
+    }
+    data = static_cast<const char *>(mapped);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(mapping);
+    CloseHandle(file);
+#else
+    munmap(const_cast<char *>(data), length);
+#endif
+}
+
+void MappedFile::release(const char *range_begin, const char *range_end) const
+{
+#if defined(MADV_DONTNEED) && !defined(__EMSCRIPTEN__)
+    static const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    const uintptr_t first = (reinterpret_cast<uintptr_t>(range_begin) + page_size - 1) &
+                            ~(page_size - 1);
+    const uintptr_t last = reinterpret_cast<uintptr_t>(range_end) & ~(page_size - 1);
+    if (first < last) {
+        madvise(reinterpret_cast<void *>(first), last - first, MADV_DONTNEED);
+    }
+#else
+    (void)range_begin;
+    (void)range_end;
+#endif
+}
+
+uint64_t peak_resident_bytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#elif defined(__EMSCRIPTEN__)
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    // Linux reports it in KB
+    return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+/* Run fn(i) for each i in [0, n) on up to num_threads threads, including the
+ * calling thread, then rethrow the first exception thrown by any call. On
+ * Emscripten everything runs on the calling thread.
+ */
+void parallel_for(const uint64_t n,
+                  const uint32_t num_threads,
+                  const std::function<void(uint64_t)> &fn)
+{
+    std::atomic<uint64_t> next(0);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto work = [&]() {
+        for (uint64_t i = next++; i < n; i = next++) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+#ifndef __EMSCRIPTEN__
+    std::vector<std::thread> threads;
+    for (uint64_t i = 1; i < std::min(uint64_t(num_threads), n); ++i) {
+        threads.emplace_back([&]() {
+            cpu_profiler_set_thread_name("mesh loader");
+            work();
+        });
+    }
+    work();
+    for (auto &t : threads) {
+        t.join();
+    }
+#else
+    (void)num_threads;
+    work();
+#endif
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+struct Bounds {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    void add(const glm::vec3 &p)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    void merge(const Bounds &b)
+    {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+};
+
+// Normalize a normal read from a file, zero length normals point along +z
+glm::vec3 unit_normal(const glm::vec3 &n)
+{
+    const float length = glm::length(n);
+    return length > 0.f ? n / length : glm::vec3(0.f, 0.f, 1.f);
+}
+
+// The mesh's buffers, mapped while the loader writes into them
+struct MeshOutput {
+    Mesh mesh;
+    char *vertices = nullptr;
+    uint32_t *indices = nullptr;
+
+    // Encode vertex i in the mesh's format, normal is ignored if it has no normals
+    void write_vertex(const uint64_t i,
+                      const glm::vec3 &position,
+                      const glm::vec3 &color,
+                      const glm::vec3 &normal = glm::vec3(0.f, 0.f, 1.f)) const
+    {
+        encode_vertex(mesh.format, position, color, normal, vertices + i * mesh.format.stride);
+    }
+};
+
+// The state of loading a mesh file, shared by the format loaders
+struct MeshLoad {
+    wgpu::Device device;
+    const MappedFile *file = nullptr;
+    std::string path;
+    uint32_t num_threads = 1;
+    // The file's size plus any external buffers it references
+    uint64_t file_bytes = 0;
+    VertexErrorBounds error_bounds;
+    MeshOutput out;
+    // The bounds of all vertex positions, which the loader must find before creating
+    // the buffers so the format can be chosen
+    Bounds bounds;
+};
+
+/* Choose the vertex format and create the mesh's buffers mapped, once the loader
+ * knows the size and bounds of the mesh
+ */
+void create_mesh_buffers(MeshLoad &load,
+                         const uint64_t num_vertices,
+                         const uint64_t num_triangles,
+                         const bool has_normals)
+{
+    const wgpu::Device &device = load.device;
+    const std::string &path = load.path;
+    if (num_vertices == 0 || num_triangles == 0) {
+        throw std::runtime_error(path + " has no triangles");
+    }
+    MeshOutput &out = load.out;
+    out.mesh.format =
+        choose_vertex_format(load.bounds.min, load.bounds.max, has_normals, load.error_bounds);
+    const uint64_t vertex_bytes = num_vertices * out.mesh.format.stride;
+    const uint64_t index_bytes = num_triangles * 3 * sizeof(uint32_t);
+
+    wgpu::SupportedLimits limits;
+    device.GetLimits(&limits);
+    const uint64_t max_size = limits.limits.maxBufferSize;
+    if (num_vertices > std::numeric_limits<uint32_t>::max() ||
+        num_triangles * 3 > std::numeric_limits<uint32_t>::max() || vertex_bytes > max_size ||
+        index_bytes > max_size) {
+        throw std::runtime_error(path + " needs a " +
+                                 std::to_string(std::max(vertex_bytes, index_bytes) >> 20) +
+                                 "MB buffer, over the device's " +
+                                 std::to_string(max_size >> 20) + "MB limit");
+    }
+
+    wgpu::BufferDescriptor buffer_desc;
+    buffer_desc.mappedAtCreation = true;
+    buffer_desc.size = vertex_bytes;
+    buffer_desc.usage = wgpu::BufferUsage::Vertex;
+    out.mesh.vertex_buf = gpu_memory_create_buffer(device, buffer_desc, "mesh_vertices");
+
+    buffer_desc.size = index_bytes;
+    buffer_desc.usage = wgpu::BufferUsage::Index;
+    out.mesh.index_buf = gpu_memory_create_buffer(device, buffer_desc, "mesh_indices");
+
+    out.vertices = static_cast<char *>(out.mesh.vertex_buf.GetMappedRange());
+    out.indices = static_cast<uint32_t *>(out.mesh.index_buf.GetMappedRange());
+    if (!out.vertices || !out.indices) {
+        release_mesh(out.mesh);
+        throw std::runtime_error("Failed to allocate the buffers for " + path);
+    }
+    out.mesh.num_vertices = num_vertices;
+    out.mesh.num_indices = num_triangles * 3;
+}
+
+// Text parsing helpers. The mapped file isn't null terminated, so all of them stop
+// at the end of the line or range they're given
+
+bool is_digit(const char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+bool is_space(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+void skip_space(const char *&p, const char *end)
+{
+    while (p < end && is_space(*p)) {
+        ++p;
+    }
+}
+
+void skip_token(const char *&p, const char *end)
+{
+    while (p < end && !is_space(*p)) {
+        ++p;
+    }
+}
+
+const char *line_end(const char *p, const char *end)
+{
+    const void *nl = std::memchr(p, '\n', end - p);
+    return nl ? static_cast<const char *>(nl) : end;
+}
+
+double pow10(const int exponent)
+{
+    static const double POW10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                   1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                   1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    if (exponent >= 0 && exponent <= 22) {
+        return POW10[exponent];
+    }
+    if (exponent < 0 && exponent >= -22) {
+        return 1.0 / POW10[-exponent];
+    }
+    return std::pow(10.0, exponent);
+}
+
+/* Parse a decimal number, e.g. "-1.5e3", advancing p past it. Returns false if p
+ * isn't at a number. Much faster than strtod, which also needs a null terminator,
+ * at the cost of rounding the last bit differently on some inputs.
+ */
+bool parse_float(const char *&p, const char *end, float &value)
+{
+    const char *s = p;
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = *s == '-';
+        ++s;
+    }
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int num_digits = 0;
+    for (; s < end && is_digit(*s); ++s, ++num_digits) {
+        if (mantissa < 100000000000000000ull) {
+            mantissa = mantissa * 10 + (*s - '0');
+        } else {
+            ++exponent;
+        }
+    }
+    if (s < end && *s == '.') {
+        for (++s; s < end && is_digit(*s); ++s, ++num_digits) {
+            if (mantissa < 100000000000000000ull) {
+                mantissa = mantissa * 10 + (*s - '0');
+                --exponent;
+            }
+        }
+    }
+    if (num_digits == 0) {
+        return false;
+    }
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char *e = s + 1;
+        bool negative_exponent = false;
+        if (e < end && (*e == '-' || *e == '+')) {
+            negative_exponent = *e == '-';
+            ++e;
+        }
+        if (e < end && is_digit(*e)) {
+            int x = 0;
+            for (; e < end && is_digit(*e); ++e) {
+                x = std::min(x * 10 + (*e - '0'), 1000);
+            }
+            exponent += negative_exponent ? -x : x;
+            s = e;
+        }
+    }
+    const double v = double(mantissa) * pow10(exponent);
+    value = static_cast<float>(negative ? -v : v);
+    p = s;
+    return true;
+}
+
+bool parse_int(const char *&p, const char *end, int64_t &value)
+{
+    const char *s = p;
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = *s == '-';
+        ++s;
+    }
+    if (s == end || !is_digit(*s)) {
+        return false;
+    }
+    int64_t v = 0;
+    for (; s < end && is_digit(*s); ++s) {
+        v = v * 10 + (*s - '0');
+    }
+    value = negative ? -v : v;
+    p = s;
+    return true;
+}
+
+/* Split [begin, end) into chunks of about chunk_bytes each, starting at line
+ * starts. Returns the chunk boundaries, begin and end included.
+ */
+std::vector<const char *> split_lines(const char *begin, const char *end, size_t chunk_bytes)
+{
+    std::vector<const char *> bounds = {begin};
+    const char *p = begin;
+    while (size_t(end - p) > chunk_bytes) {
+        p = line_end(p + chunk_bytes, end);
+        if (p == end) {
+            break;
+        }
+        ++p;
+        bounds.push_back(p);
+    }
+    bounds.push_back(end);
+    return bounds;
+}
+
+// A chunk of a text file and where its output goes
+struct TextChunk {
+    const char *begin = nullptr;
+    const char *end = nullptr;
+    uint64_t first_line = 0;
+    uint64_t num_lines = 0;
+    uint64_t vertex_base = 0;
+    uint64_t num_vertices = 0;
+    uint64_t triangle_base = 0;
+    uint64_t num_triangles = 0;
+    Bounds bounds;
+};
+
+std::vector<TextChunk> make_text_chunks(const char *begin, const char *end)
+{
+    const std::vector<const char *> bounds = split_lines(begin, end, TEXT_CHUNK_BYTES);
+    std::vector<TextChunk> chunks(bounds.size() - 1);
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        chunks[i].begin = bounds[i];
+        chunks[i].end = bounds[i + 1];
+    }
+    return chunks;
+}
+
+// Set each chunk's output offsets from the counts of the chunks before it, and
+// return the totals
+void prefix_sum_chunks(std::vector<TextChunk> &chunks,
+                       uint64_t &num_vertices,
+                       uint64_t &num_triangles)
+{
+    num_vertices = 0;
+    num_triangles = 0;
+    for (auto &c : chunks) {
+        c.vertex_base = num_vertices;
+        c.triangle_base = num_triangles;
+        num_vertices += c.num_vertices;
+        num_triangles += c.num_triangles;
+    }
+}
+
+
+std::runtime_error parse_error(const std::string &path, const std::string &message)
+{
+    return std::runtime_error("Failed to parse " + path + ": " + message);
+}
+
+/* Write the triangle fan of a polygon, the first vertex is given as the polygon's
+ * first index, called for each following index
+ */
+struct FanWriter {
+    uint32_t *out = nullptr;
+    uint32_t first = 0;
+    uint32_t prev = 0;
+    uint32_t count = 0;
+
+    void add(const uint32_t index)
+    {
+        if (count == 0) {
+            first = index;
+        } else if (count >= 2) {
+            out[0] = first;
+            out[1] = prev;
+            out[2] = index;
+            out += 3;
+        }
+        prev = index;
+        ++count;
+    }
+};
+
+// OBJ ---------------------------------------------------------------------------
+
+bool is_obj_line(const char *p, const char *end, const char type)
+{
+    return p + 1 < end && p[0] == type && is_space(p[1]);
+}
+
+/* Parse the values of a vertex line after the "v": x y z, with an optional w and
+ * the common r g b extension. Returns the number of values.
+ */
+size_t parse_obj_vertex(const char *p,
+                        const char *le,
+                        std::array<float, 7> &v,
+                        const std::string &path)
+{
+    size_t n = 0;
+    for (; n < v.size(); ++n) {
+        skip_space(p, le);
+        if (!parse_float(p, le, v[n])) {
+            break;
+        }
+    }
+    if (n < 3) {
+        throw parse_error(path, "vertex with fewer than 3 coordinates");
+    }
+    return n;
+}
+
+// Count the chunk's vertices and triangles and find the bounds of its vertices
+void count_obj_chunk(TextChunk &chunk, const std::string &path)
+{
+    std::array<float, 7> v = {};
+    for (const char *p = chunk.begin; p < chunk.end;) {
+        const char *le = line_end(p, chunk.end);
+        skip_space(p, le);
+        if (is_obj_line(p, le, 'v')) {
+            parse_obj_vertex(p + 1, le, v, path);
+            chunk.bounds.add(glm::vec3(v[0], v[1], v[2]));
+            ++chunk.num_vertices;
+        } else if (is_obj_line(p, le, 'f')) {
+            uint64_t num_indices = 0;
+            for (p += 1;;) {
+                skip_space(p, le);
+                if (p == le || *p == '#') {
+                    break;
+                }
+                skip_token(p, le);
+                ++num_indices;
+            }
+            if (num_indices >= 3) {
+                chunk.num_triangles += num_indices - 2;
+            }
+        }
+        p = le + 1;
+    }
+}
+
+void parse_obj_chunk(const TextChunk &chunk,
+                     const MeshOutput &out,
+                     const std::string &path)
+{
+    FanWriter fan;
+    fan.out = out.indices + chunk.triangle_base * 3;
+    uint64_t num_vertices = 0;
+    std::array<float, 7> v = {};
+    for (const char *p = chunk.begin; p < chunk.end;) {
+        const char *le = line_end(p, chunk.end);
+        skip_space(p, le);
+        if (is_obj_line(p, le, 'v')) {
+            const size_t n = parse_obj_vertex(p + 1, le, v, path);
+            glm::vec3 color(1.f);
+            if (n >= 6) {
+                color = n == 7 ? glm::vec3(v[4], v[5], v[6]) : glm::vec3(v[3], v[4], v[5]);
+            }
+            out.write_vertex(
+                chunk.vertex_base + num_vertices++, glm::vec3(v[0], v[1], v[2]), color);
+        } else if (is_obj_line(p, le, 'f')) {
+            // Negative indices are relative to the vertices read so far
+            const int64_t vertices_so_far = chunk.vertex_base + num_vertices;
+            fan.count = 0;
+            for (p += 1;;) {
+                skip_space(p, le);
+                if (p == le || *p == '#') {
+                    break;
+                }
+                int64_t index = 0;
+                if (!parse_int(p, le, index)) {
+                    throw parse_error(path, "invalid face index");
+                }
+                // Skip the texture coordinate and normal indices
+                skip_token(p, le);
+                const int64_t resolved = index > 0 ? index - 1 : vertices_so_far + index;
+                if (index == 0 || resolved < 0 || resolved >= out.mesh.num_vertices) {
+                    throw parse_error(path, "face index out of range");
+                }
+                fan.add(static_cast<uint32_t>(resolved));
+            }
+        }
+        p = le + 1;
+    }
+}
+
+void load_obj(MeshLoad &load)
+{
+    const MappedFile &file = *load.file;
+    std::vector<TextChunk> chunks = make_text_chunks(file.begin(), file.end());
+    {
+        CPU_ZONE("count_obj");
+        parallel_for(chunks.size(), load.num_threads, [&](uint64_t i) {
+            count_obj_chunk(chunks[i], load.path);
+            file.release(chunks[i].begin, chunks[i].end);
+        });
+    }
+    uint64_t num_vertices = 0;
+    uint64_t num_triangles = 0;
+    prefix_sum_chunks(chunks, num_vertices, num_triangles);
+    for (const auto &c : chunks) {
+        load.bounds.merge(c.bounds);
+    }
+
+    // Normals are indexed per face corner in OBJ, so they can't be stored per
+    // vertex without splitting vertices and aren't loaded
+    create_mesh_buffers(load, num_vertices, num_triangles, false);
+    {
+        CPU_ZONE("parse_obj");
+        parallel_for(chunks.size(), load.num_threads, [&](uint64_t i) {
+            parse_obj_chunk(chunks[i], load.out, load.path);
+            file.release(chunks[i].begin, chunks[i].end);
+        });
+    }
+}
+
+// PLY ---------------------------------------------------------------------------
+
+enum class PlyType { INVALID, INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64 };
+
+enum class PlyFormat { ASCII, BINARY_LITTLE_ENDIAN, BINARY_BIG_ENDIAN };
+
+struct PlyProperty {
+    std::string name;
+    PlyType type = PlyType::INVALID;
+    // Set for list properties, the type of the list's length
+    PlyType count_type = PlyType::INVALID;
+};
+
+struct PlyElement {
+    std::string name;
+    uint64_t count = 0;
+    std::vector<PlyProperty> properties;
+    // The size of each item if the element has no list properties, otherwise 0
+    uint32_t stride = 0;
+};
+
+struct PlyHeader {
+    PlyFormat format = PlyFormat::ASCII;
+    std::vector<PlyElement> elements;
+    // The offset of the data following the header
+    size_t data_offset = 0;
+};
+
+PlyType parse_ply_type(const std::string &name)
+{
+    if (name == "char" || name == "int8") {
+        return PlyType::INT8;
+    }
+    if (name == "uchar" || name == "uint8") {
+        return PlyType::UINT8;
+    }
+    if (name == "short" || name == "int16") {
+        return PlyType::INT16;
+    }
+    if (name == "ushort" || name == "uint16") {
+        return PlyType::UINT16;
+    }
+    if (name == "int" || name == "int32") {
+        return PlyType::INT32;
+    }
+    if (name == "uint" || name == "uint32") {
+        return PlyType::UINT32;
+    }
+    if (name == "float" || name == "float32") {
+        return PlyType::FLOAT32;
+    }
+    if (name == "double" || name == "float64") {
+        return PlyType::FLOAT64;
+    }
+    return PlyType::INVALID;
+}
+
+uint32_t ply_type_size(const PlyType type)
+{
+    switch (type) {
+    case PlyType::INT8:
+    case PlyType::UINT8:
+        return 1;
+    case PlyType::INT16:
+    case PlyType::UINT16:
+        return 2;
+    case PlyType::INT32:
+    case PlyType::UINT32:
+    case PlyType::FLOAT32:
+        return 4;
+    case PlyType::FLOAT64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+// Get the value that maps to 1.0 for color properties of the type
+float ply_color_scale(const PlyType type)
+{
+    switch (type) {
+    case PlyType::UINT8:
+        return 255.f;
+    case PlyType::UINT16:
+        return 65535.f;
+    default:
+        return 1.f;
+    }
+}
+
+template <typename T>
+T load_value(const char *p, const bool swap)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, p, sizeof(T));
+    if (swap) {
+        std::reverse(bytes, bytes + sizeof(T));
+    }
+    T v;
+    std::memcpy(&v, bytes, sizeof(T));
+    return v;
+}
+
+double read_ply_value(const char *p, const PlyType type, const bool swap)
+{
+    switch (type) {
+    case PlyType::INT8:
+        return load_value<int8_t>(p, swap);
+    case PlyType::UINT8:
+        return load_value<uint8_t>(p, swap);
+    case PlyType::INT16:
+        return load_value<int16_t>(p, swap);
+    case PlyType::UINT16:
+        return load_value<uint16_t>(p, swap);
+    case PlyType::INT32:
+        return load_value<int32_t>(p, swap);
+    case PlyType::UINT32:
+        return load_value<uint32_t>(p, swap);
+    case PlyType::FLOAT32:
+        return load_value<float>(p, swap);
+    case PlyType::FLOAT64:
+        return load_value<double>(p, swap);
+    default:
+        return 0.0;
+    }
+}
+
+PlyHeader parse_ply_header(const MappedFile &file, const std::string &path)
+{
+    PlyHeader header;
+    const char *p = file.begin();
+    bool first_line = true;
+    bool has_format = false;
+    while (true) {
+        if (p >= file.end()) {
+            throw parse_error(path, "missing end_header");
+        }
+        const char *le = line_end(p, file.end());
+        std::vector<std::string> tokens;
+        for (const char *t = p;;) {
+            skip_space(t, le);
+            if (t == le) {
+                break;
+            }
+            const char *token_begin = t;
+            skip_token(t, le);
+            tokens.emplace_back(token_begin, t);
+        }
+        p = le + 1;
+
+        if (first_line) {
+            if (tokens.size() != 1 || tokens[0] != "ply") {
+                throw parse_error(path, "not a PLY file");
+            }
+            first_line = false;
+        } else if (tokens.empty() || tokens[0] == "comment" || tokens[0] == "obj_info") {
+            continue;
+        } else if (tokens[0] == "format" && tokens.size() >= 2) {
+            if (tokens[1] == "ascii") {
+                header.format = PlyFormat::ASCII;
+            } else if (tokens[1] == "binary_little_endian") {
+                header.format = PlyFormat::BINARY_LITTLE_ENDIAN;
+            } else if (tokens[1] == "binary_big_endian") {
+                header.format = PlyFormat::BINARY_BIG_ENDIAN;
+            } else {
+                throw parse_error(path, "unknown format " + tokens[1]);
+            }
+            has_format = true;
+        } else if (tokens[0] == "element" && tokens.size() == 3) {
+            PlyElement element;
+            element.name = tokens[1];
+            element.count = std::strtoull(tokens[2].c_str(), nullptr, 10);
+            header.elements.push_back(element);
+        } else if (tokens[0] == "property" && !header.elements.empty()) {
+            PlyProperty prop;
+            if (tokens.size() == 5 && tokens[1] == "list") {
+                prop.count_type = parse_ply_type(tokens[2]);
+                prop.type = parse_ply_type(tokens[3]);
+                prop.name = tokens[4];
+                if (prop.count_type == PlyType::INVALID) {
+                    throw parse_error(path, "unknown property type " + tokens[2]);
+                }
+            } else if (tokens.size() == 3) {
+                prop.type = parse_ply_type(tokens[1]);
+                prop.name = tokens[2];
+            }
+            if (prop.type == PlyType::INVALID) {
+                throw parse_error(path, "invalid property " + prop.name);
+            }
+            header.elements.back().properties.push_back(prop);
+        } else if (tokens[0] == "end_header") {
+            break;
+        } else {
+            throw parse_error(path, "unexpected header line " + tokens[0]);
+        }
+    }
+    if (!has_format) {
+        throw parse_error(path, "missing format");
+    }
+    header.data_offset = p - file.begin();
+
+    for (auto &e : header.elements) {
+        e.stride = 0;
+        bool has_list = false;
+        for (const auto &prop : e.properties) {
+            has_list = has_list || prop.count_type != PlyType::INVALID;
+            e.stride += ply_type_size(prop.type);
+        }
+        if (has_list) {
+            e.stride = 0;
+        }
+    }
+    return header;
+}
+
+// Where the vertex attributes we use are in the vertex element
+struct PlyVertexLayout {
+    // The property index of x, y, z, red, green, blue, nx, ny and nz, -1 if missing
+    std::array<int, 9> props = {{-1, -1, -1, -1, -1, -1, -1, -1, -1}};
+    // The byte offsets of the properties within a binary vertex
+    std::array<uint32_t, 9> offsets = {};
+    std::array<PlyType, 9> types = {};
+    bool has_color = false;
+    bool has_normals = false;
+};
+
+PlyVertexLayout ply_vertex_layout(const PlyElement &vertex, const std::string &path)
+{
+    static const char *NAMES[] = {"x", "y", "z", "red", "green", "blue", "nx", "ny", "nz"};
+    PlyVertexLayout layout;
+    uint32_t offset = 0;
+    for (size_t i = 0; i < vertex.properties.size(); ++i) {
+        const PlyProperty &prop = vertex.properties[i];
+        if (prop.count_type != PlyType::INVALID) {
+            throw parse_error(path, "list properties on vertices aren't supported");
+        }
+        for (size_t j = 0; j < layout.props.size(); ++j) {
+            if (prop.name == NAMES[j]) {
+                layout.props[j] = i;
+                layout.offsets[j] = offset;
+                layout.types[j] = prop.type;
+            }
+        }
+        offset += ply_type_size(prop.type);
+    }
+    if (layout.props[0] < 0 || layout.props[1] < 0 || layout.props[2] < 0) {
+        throw parse_error(path, "vertices must have x, y and z");
+    }
+    layout.has_color = layout.props[3] >= 0 && layout.props[4] >= 0 && layout.props[5] >= 0;
+    layout.has_normals = layout.props[6] >= 0 && layout.props[7] >= 0 && layout.props[8] >= 0;
+    return layout;
+}
+
+glm::vec3 read_ply_position(const char *v, const PlyVertexLayout &layout, const bool swap)
+{
+    glm::vec3 position;
+    for (int j = 0; j < 3; ++j) {
+        position[j] = read_ply_value(v + layout.offsets[j], layout.types[j], swap);
+    }
+    return position;
+}
+
+// Read the color and normal of a binary vertex, defaulting to white and +z
+void read_ply_attributes(const char *v,
+                         const PlyVertexLayout &layout,
+                         const bool swap,
+                         glm::vec3 &color,
+                         glm::vec3 &normal)
+{
+    color = glm::vec3(1.f);
+    normal = glm::vec3(0.f, 0.f, 1.f);
+    for (int j = 0; j < 3; ++j) {
+        if (layout.has_color) {
+            color[j] = read_ply_value(v + layout.offsets[3 + j], layout.types[3 + j], swap) /
+                       ply_color_scale(layout.types[3 + j]);
+        }
+        if (layout.has_normals) {
+            normal[j] = read_ply_value(v + layout.offsets[6 + j], layout.types[6 + j], swap);
+        }
+    }
+    normal = unit_normal(normal);
+}
+
+// Find the face element's index list property, returns -1 if it has none
+int ply_face_indices(const PlyElement &face)
+{
+    for (size_t i = 0; i < face.properties.size(); ++i) {
+        const PlyProperty &prop = face.properties[i];
+        if (prop.count_type != PlyType::INVALID &&
+            (prop.name == "vertex_indices" || prop.name == "vertex_index")) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// A chunk of binary PLY faces, found by scanning the variable size faces
+struct PlyFaceChunk {
+    const char *begin = nullptr;
+    const char *end = nullptr;
+    uint64_t num_faces = 0;
+    uint64_t triangle_base = 0;
+    uint64_t num_triangles = 0;
+};
+
+/* Skip over an item of an element with list properties, returning the number of
+ * triangles in its index list property
+ */
+uint64_t skip_ply_item(const char *&p,
+                       const char *end,
+                       const PlyElement &element,
+                       const int index_prop,
+                       const bool swap,
+                       const std::string &path)
+{
+    uint64_t num_triangles = 0;
+    for (size_t i = 0; i < element.properties.size(); ++i) {
+        const PlyProperty &prop = element.properties[i];
+        uint64_t count = 1;
+        if (prop.count_type != PlyType::INVALID) {
+            const uint32_t count_size = ply_type_size(prop.count_type);
+            if (uint64_t(end - p) < count_size) {
+                throw parse_error(path, "truncated " + element.name);
+            }
+            count = static_cast<uint64_t>(read_ply_value(p, prop.count_type, swap));
+            p += count_size;
+            if (int(i) == index_prop && count >= 3) {
+                num_triangles = count - 2;
+            }
+        }
+        const uint64_t size = count * ply_type_size(prop.type);
+        if (uint64_t(end - p) < size) {
+            throw parse_error(path, "truncated " + element.name);
+        }
+        p += size;
+    }
+    return num_triangles;
+}
+
+void load_binary_ply(MeshLoad &load, const PlyHeader &header)
+{
+    const MappedFile &file = *load.file;
+    const std::string &path = load.path;
+    const bool swap = header.format == PlyFormat::BINARY_BIG_ENDIAN;
+    const PlyElement *vertex = nullptr;
+    const PlyElement *face = nullptr;
+    const char *vertex_data = nullptr;
+    int index_prop = -1;
+    std::vector<PlyFaceChunk> face_chunks;
+    uint64_t num_triangles = 0;
+
+    // Find where each element starts. Elements with lists have to be scanned, and
+    // while scanning the faces we split them into chunks and count their triangles
+    CPU_ZONE_BEGIN(scan_zone, "scan_ply");
+    const char *p = file.begin() + header.data_offset;
+    for (const auto &e : header.elements) {
+        if (e.name == "vertex") {
+            vertex = &e;
+            vertex_data = p;
+        }
+        if (e.stride != 0) {
+            if (uint64_t(file.end() - p) / e.stride < e.count) {
+                throw parse_error(path, "truncated " + e.name);
+            }
+            p += e.count * e.stride;
+            continue;
+        }
+        if (e.name != "face") {
+            for (uint64_t i = 0; i < e.count; ++i) {
+                skip_ply_item(p, file.end(), e, -1, swap, path);
+            }
+            continue;
+        }
+        face = &e;
+        index_prop = ply_face_indices(e);
+        if (index_prop < 0) {
+            throw parse_error(path, "faces have no vertex_indices");
+        }
+        for (uint64_t i = 0; i < e.count; i += BINARY_CHUNK_ITEMS) {
+            PlyFaceChunk chunk;
+            chunk.begin = p;
+            chunk.num_faces = std::min(BINARY_CHUNK_ITEMS, e.count - i);
+            chunk.triangle_base = num_triangles;
+            for (uint64_t j = 0; j < chunk.num_faces; ++j) {
+                chunk.num_triangles += skip_ply_item(p, file.end(), e, index_prop, swap, path);
+            }
+            chunk.end = p;
+            num_triangles += chunk.num_triangles;
+            face_chunks.push_back(chunk);
+            file.release(chunk.begin, chunk.end);
+        }
+    }
+    CPU_ZONE_END(scan_zone);
+    if (!vertex || !face) {
+        throw parse_error(path, "missing vertex or face element");
+    }
+    if (vertex->stride == 0) {
+        throw parse_error(path, "list properties on vertices aren't supported");
+    }
+    const PlyVertexLayout layout = ply_vertex_layout(*vertex, path);
+
+    const uint64_t num_vertex_chunks =
+        (vertex->count + BINARY_CHUNK_ITEMS - 1) / BINARY_CHUNK_ITEMS;
+    std::vector<Bounds> chunk_bounds(num_vertex_chunks);
+    CPU_ZONE_BEGIN(bounds_zone, "bounds_ply");
+    parallel_for(num_vertex_chunks, load.num_threads, [&](uint64_t c) {
+        const uint64_t begin = c * BINARY_CHUNK_ITEMS;
+        const uint64_t end = std::min(begin + BINARY_CHUNK_ITEMS, vertex->count);
+        for (uint64_t i = begin; i < end; ++i) {
+            const char *v = vertex_data + i * vertex->stride;
+            chunk_bounds[c].add(read_ply_position(v, layout, swap));
+        }
+    });
+    CPU_ZONE_END(bounds_zone);
+    for (const auto &b : chunk_bounds) {
+        load.bounds.merge(b);
+    }
+
+    create_mesh_buffers(load, vertex->count, num_triangles, layout.has_normals);
+    const MeshOutput &out = load.out;
+
+    // The vertex chunks come first, then the face chunks
+    CPU_ZONE_BEGIN(parse_zone, "parse_ply");
+    const uint64_t num_chunks = num_vertex_chunks + face_chunks.size();
+    parallel_for(num_chunks, load.num_threads, [&](uint64_t c) {
+        if (c < num_vertex_chunks) {
+            const uint64_t begin = c * BINARY_CHUNK_ITEMS;
+            const uint64_t end = std::min(begin + BINARY_CHUNK_ITEMS, vertex->count);
+            for (uint64_t i = begin; i < end; ++i) {
+                const char *v = vertex_data + i * vertex->stride;
+                glm::vec3 color;
+                glm::vec3 normal;
+                read_ply_attributes(v, layout, swap, color, normal);
+                out.write_vertex(i, read_ply_position(v, layout, swap), color, normal);
+            }
+            file.release(vertex_data + begin * vertex->stride,
+                         vertex_data + end * vertex->stride);
+            return;
+        }
+
+        const PlyFaceChunk &chunk = face_chunks[c - num_vertex_chunks];
+        FanWriter fan;
+        fan.out = out.indices + chunk.triangle_base * 3;
+        const char *f = chunk.begin;
+        for (uint64_t i = 0; i < chunk.num_faces; ++i) {
+            for (size_t j = 0; j < face->properties.size(); ++j) {
+                const PlyProperty &prop = face->properties[j];
+                const uint32_t size = ply_type_size(prop.type);
+                uint64_t count = 1;
+                if (prop.count_type != PlyType::INVALID) {
+                    count = static_cast<uint64_t>(read_ply_value(f, prop.count_type, swap));
+                    f += ply_type_size(prop.count_type);
+                }
+                if (int(j) != index_prop) {
+                    f += count * size;
+                    continue;
+                }
+                fan.count = 0;
+                for (uint64_t k = 0; k < count; ++k, f += size) {
+                    const double index = read_ply_value(f, prop.type, swap);
+                    if (index < 0 || index >= out.mesh.num_vertices) {
+                        throw parse_error(path, "face index out of range");
+                    }
+                    fan.add(static_cast<uint32_t>(index));
+                }
+            }
+        }
+        file.release(chunk.begin, chunk.end);
+    });
+    CPU_ZONE_END(parse_zone);
+}
+
+// Parse the values of all properties of an ASCII vertex
+void parse_ply_vertex_line(const char *p,
+                           const char *le,
+                           std::vector<float> &values,
+                           const std::string &path)
+{
+    for (auto &v : values) {
+        skip_space(p, le);
+        if (!parse_float(p, le, v)) {
+            throw parse_error(path, "invalid vertex");
+        }
+    }
+}
+
+void load_ascii_ply(MeshLoad &load, const PlyHeader &header)
+{
+    const MappedFile &file = *load.file;
+    const std::string &path = load.path;
+    // Each item is a line, so each element covers a range of lines
+    uint64_t line = 0;
+    uint64_t vertex_first_line = 0;
+    uint64_t face_first_line = 0;
+    const PlyElement *vertex = nullptr;
+    const PlyElement *face = nullptr;
+    for (const auto &e : header.elements) {
+        if (e.name == "vertex") {
+            vertex = &e;
+            vertex_first_line = line;
+        } else if (e.name == "face") {
+            face = &e;
+            face_first_line = line;
+        }
+        line += e.count;
+    }
+    if (!vertex || !face) {
+        throw parse_error(path, "missing vertex or face element");
+    }
+    const PlyVertexLayout layout = ply_vertex_layout(*vertex, path);
+    const int index_prop = ply_face_indices(*face);
+    if (index_prop < 0) {
+        throw parse_error(path, "faces have no vertex_indices");
+    }
+    const uint64_t vertex_end_line = vertex_first_line + vertex->count;
+    const uint64_t face_end_line = face_first_line + face->count;
+
+    std::vector<TextChunk> chunks =
+        make_text_chunks(file.begin() + header.data_offset, file.end());
+
+    // Count the lines in each chunk to find which element's lines it holds, then
+    // count the triangles in its faces and find the bounds of its vertices
+    CPU_ZONE_BEGIN(count_zone, "count_ply");
+    parallel_for(chunks.size(), load.num_threads, [&](uint64_t i) {
+        for (const char *p = chunks[i].begin; p < chunks[i].end;
+             p = line_end(p, chunks[i].end) + 1) {
+            ++chunks[i].num_lines;
+        }
+    });
+    for (size_t i = 1; i < chunks.size(); ++i) {
+        chunks[i].first_line = chunks[i - 1].first_line + chunks[i - 1].num_lines;
+    }
+    parallel_for(chunks.size(), load.num_threads, [&](uint64_t i) {
+        TextChunk &chunk = chunks[i];
+        std::vector<float> values(vertex->properties.size());
+        uint64_t l = chunk.first_line;
+        for (const char *p = chunk.begin; p < chunk.end; ++l) {
+            const char *le = line_end(p, chunk.end);
+            if (l >= vertex_first_line && l < vertex_end_line) {
+                parse_ply_vertex_line(p, le, values, path);
+                chunk.bounds.add(glm::vec3(values[layout.props[0]],
+                                           values[layout.props[1]],
+                                           values[layout.props[2]]));
+                ++chunk.num_vertices;
+            } else if (l >= face_first_line && l < face_end_line) {
+                // Skip the properties before the index list
+                for (int j = 0; j < index_prop; ++j) {
+                    skip_space(p, le);
+                    skip_token(p, le);
+                }
+                skip_space(p, le);
+                int64_t count = 0;
+                if (parse_int(p, le, count) && count >= 3) {
+                    chunk.num_triangles += count - 2;
+                }
+            }
+            p = le + 1;
+        }
+        file.release(chunk.begin, chunk.end);
+    });
+    CPU_ZONE_END(count_zone);
+    uint64_t num_vertices = 0;
+    uint64_t num_triangles = 0;
+    prefix_sum_chunks(chunks, num_vertices, num_triangles);
+    if (num_vertices != vertex->count) {
+        throw parse_error(path, "truncated vertices");
+    }
+    for (const auto &c : chunks) {
+        load.bounds.merge(c.bounds);
+    }
+
+    create_mesh_buffers(load, num_vertices, num_triangles, layout.has_normals);
+    const MeshOutput &out = load.out;
+    CPU_ZONE_BEGIN(parse_zone, "parse_ply");
+    parallel_for(chunks.size(), load.num_threads, [&](uint64_t i) {
+        const TextChunk &chunk = chunks[i];
+        std::vector<float> values(vertex->properties.size());
+        uint64_t vertex_index = chunk.vertex_base;
+        FanWriter fan;
+        fan.out = out.indices + chunk.triangle_base * 3;
+        uint64_t l = chunk.first_line;
+        for (const char *p = chunk.begin; p < chunk.end; ++l) {
+            const char *le = line_end(p, chunk.end);
+            if (l >= vertex_first_line && l < vertex_end_line) {
+                parse_ply_vertex_line(p, le, values, path);
+                glm::vec3 position;
+                glm::vec3 color(1.f);
+                glm::vec3 normal(0.f, 0.f, 1.f);
+                for (int j = 0; j < 3; ++j) {
+                    position[j] = values[layout.props[j]];
+                    if (layout.has_color) {
+                        color[j] =
+                            values[layout.props[3 + j]] / ply_color_scale(layout.types[3 + j]);
+                    }
+                    if (layout.has_normals) {
+                        normal[j] = values[layout.props[6 + j]];
+                    }
+                }
+                out.write_vertex(vertex_index++, position, color, unit_normal(normal));
+            } else if (l >= face_first_line && l < face_end_line) {
+                for (int j = 0; j < index_prop; ++j) {
+                    skip_space(p, le);
+                    skip_token(p, le);
+                }
+                skip_space(p, le);
+                int64_t count = 0;
+                parse_int(p, le, count);
+                fan.count = 0;
+                for (int64_t k = 0; k < count; ++k) {
+                    skip_space(p, le);
+                    int64_t index = 0;
+                    if (!parse_int(p, le, index) || index < 0 ||
+                        index >= out.mesh.num_vertices) {
+                        throw parse_error(path, "face index out of range");
+                    }
+                    fan.add(static_cast<uint32_t>(index));
+                }
+            }
+            p = le + 1;
+        }
+        file.release(chunk.begin, chunk.end);
+    });
+    CPU_ZONE_END(parse_zone);
+}
+
+void load_ply(MeshLoad &load)
+{
+    const PlyHeader header = parse_ply_header(*load.file, load.path);
+    if (header.format == PlyFormat::ASCII) {
+        load_ascii_ply(load, header);
+    } else {
+        load_binary_ply(load, header);
+    }
+}
+
+// glTF --------------------------------------------------------------------------
+
+// A parsed JSON value, only used for glTF's small JSON chunk
+struct Json {
+    enum class Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    Type type = Type::NUL;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<Json> array;
+    std::vector<std::pair<std::string, Json>> object;
+
+    // Get the member with the key, or null if there's none
+    const Json *get(const char *key) const
+    {
+        for (const auto &m : object) {
+            if (m.first == key) {
+                return &m.second;
+            }
+        }
+        return nullptr;
+    }
+
+    // Get the member with the key as a number, or the default if it's missing
+    double get_number(const char *key, const double default_value) const
+    {
+        const Json *j = get(key);
+        return j && j->type == Type::NUMBER ? j->number : default_value;
+    }
+};
+
+class JsonParser {
+    const char *p;
+    const char *end;
+    const std::string &path;
+
+public:
+    JsonParser(const char *begin, const char *end, const std::string &path)
+        : p(begin), end(end), path(path)
+    {
+    }
+
+    Json parse()
+    {
+        Json value = parse_value(0);
+        skip_whitespace();
+        if (p != end && *p != '\0') {
+            throw parse_error(path, "trailing data after JSON");
+        }
+        return value;
+    }
+
+private:
+    void skip_whitespace()
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+            ++p;
+        }
+    }
+
+    void expect(const char c)
+    {
+        skip_whitespace();
+        if (p == end || *p != c) {
+            throw parse_error(path, std::string("expected '") + c + "' in JSON");
+        }
+        ++p;
+    }
+
+    bool consume(const char *literal)
+    {
+        const size_t len = std::strlen(literal);
+        if (size_t(end - p) >= len && std::memcmp(p, literal, len) == 0) {
+            p += len;
+            return true;
+        }
+        return false;
+    }
+
+    std::string parse_string()
+    {
+        expect('"');
+        std::string s;
+        while (p < end && *p != '"') {
+            if (*p != '\\') {
+                s += *p++;
+                continue;
+            }
+            if (++p == end) {
+                break;
+            }
+            const char c = *p++;
+            switch (c) {
+            case 'b':
+                s += '\b';
+                break;
+            case 'f':
+                s += '\f';
+                break;
+            case 'n':
+                s += '\n';
+                break;
+            case 'r':
+                s += '\r';
+                break;
+            case 't':
+                s += '\t';
+                break;
+            case 'u': {
+                if (end - p < 4) {
+                    throw parse_error(path, "invalid JSON escape");
+                }
+                const uint32_t code = std::strtoul(std::string(p, p + 4).c_str(), nullptr, 16);
+                p += 4;
+                // Encode as UTF-8, surrogate pairs aren't combined as glTF keys
+                // and the URIs we use are ASCII
+                if (code < 0x80) {
+                    s += char(code);
+                } else if (code < 0x800) {
+                    s += char(0xc0 | (code >> 6));
+                    s += char(0x80 | (code & 0x3f));
+                } else {
+                    s += char(0xe0 | (code >> 12));
+                    s += char(0x80 | ((code >> 6) & 0x3f));
+                    s += char(0x80 | (code & 0x3f));
+                }
+                break;
+            }
+            default:
+                s += c;
+                break;
+            }
+        }
+        if (p == end) {
+            throw parse_error(path, "unterminated JSON string");
+        }
+        ++p;
+        return s;
+    }
+
+    Json parse_value(const int depth)
+    {
+        if (depth > 64) {
+            throw parse_error(path, "JSON nested too deeply");
+        }
+        skip_whitespace();
+        if (p == end) {
+            throw parse_error(path, "unexpected end of JSON");
+        }
+        Json value;
+        if (*p == '{') {
+            value.type = Json::Type::OBJECT;
+            ++p;
+            skip_whitespace();
+            if (p < end && *p == '}') {
+                ++p;
+                return value;
+            }
+            while (true) {
+                std::string key = parse_string();
+                expect(':');
+                value.object.emplace_back(std::move(key), parse_value(depth + 1));
+                skip_whitespace();
+                if (p == end || *p != ',') {
+                    break;
+                }
+                ++p;
+            }
+            expect('}');
+        } else if (*p == '[') {
+            value.type = Json::Type::ARRAY;
+            ++p;
+            skip_whitespace();
+            if (p < end && *p == ']') {
+                ++p;
+                return value;
+            }
+            while (true) {
+                value.array.push_back(parse_value(depth + 1));
+                skip_whitespace();
+                if (p == end || *p != ',') {
+                    break;
+                }
+                ++p;
+            }
+            expect(']');
+        } else if (*p == '"') {
+            value.type = Json::Type::STRING;
+            value.string = parse_string();
+        } else if (consume("true")) {
+            value.type = Json::Type::BOOLEAN;
+            value.boolean = true;
+        } else if (consume("false")) {
+            value.type = Json::Type::BOOLEAN;
+        } else if (consume("null")) {
+            value.type = Json::Type::NUL;
+        } else {
+            float number = 0.f;
+            int64_t integer = 0;
+            const char *start = p;
+            // Parse integers exactly, glTF offsets and counts may not fit in a float
+            const bool is_integer = parse_int(p, end, integer) &&
+                                    (p == end || (*p != '.' && *p != 'e' && *p != 'E'));
+            if (is_integer) {
+                value.number = double(integer);
+            } else {
+                p = start;
+                if (!parse_float(p, end, number)) {
+                    throw parse_error(path, "invalid JSON value");
+                }
+                value.number = number;
+            }
+            value.type = Json::Type::NUMBER;
+        }
+        return value;
+    }
+};
+
+const uint32_t GLTF_BYTE = 5120;
+const uint32_t GLTF_UNSIGNED_BYTE = 5121;
+const uint32_t GLTF_SHORT = 5122;
+const uint32_t GLTF_UNSIGNED_SHORT = 5123;
+const uint32_t GLTF_UNSIGNED_INT = 5125;
+const uint32_t GLTF_FLOAT = 5126;
+const uint32_t GLTF_TRIANGLES = 4;
+
+uint32_t gltf_component_size(const uint32_t component_type)
+{
+    switch (component_type) {
+    case GLTF_BYTE:
+    case GLTF_UNSIGNED_BYTE:
+        return 1;
+    case GLTF_SHORT:
+    case GLTF_UNSIGNED_SHORT:
+        return 2;
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+uint32_t gltf_num_components(const std::string &type)
+{
+    if (type == "SCALAR") {
+        return 1;
+    }
+    if (type == "VEC2") {
+        return 2;
+    }
+    if (type == "VEC3") {
+        return 3;
+    }
+    if (type == "VEC4") {
+        return 4;
+    }
+    return 0;
+}
+
+// An accessor's elements in a mapped buffer
+struct GltfAccessor {
+    const char *data = nullptr;
+    uint64_t count = 0;
+    uint64_t stride = 0;
+    uint32_t component_type = 0;
+    uint32_t num_components = 0;
+    bool normalized = false;
+
+    float read_float(const uint64_t i, const uint32_t component) const
+    {
+        const char *p = data + i * stride + component * gltf_component_size(component_type);
+        switch (component_type) {
+        case GLTF_FLOAT:
+            return load_value<float>(p, false);
+        case GLTF_UNSIGNED_BYTE:
+            return load_value<uint8_t>(p, false) / (normalized ? 255.f : 1.f);
+        case GLTF_UNSIGNED_SHORT:
+            return load_value<uint16_t>(p, false) / (normalized ? 65535.f : 1.f);
+        case GLTF_BYTE:
+            return normalized ? std::max(load_value<int8_t>(p, false) / 127.f, -1.f)
+                              : load_value<int8_t>(p, false);
+        case GLTF_SHORT:
+            return normalized ? std::max(load_value<int16_t>(p, false) / 32767.f, -1.f)
+                              : load_value<int16_t>(p, false);
+        case GLTF_UNSIGNED_INT:
+            return static_cast<float>(load_value<uint32_t>(p, false));
+        default:
+            return 0.f;
+        }
+    }
+
+    uint32_t read_index(const uint64_t i) const
+    {
+        const char *p = data + i * stride;
+        switch (component_type) {
+        case GLTF_UNSIGNED_BYTE:
+            return load_value<uint8_t>(p, false);
+        case GLTF_UNSIGNED_SHORT:
+            return load_value<uint16_t>(p, false);
+        default:
+            return load_value<uint32_t>(p, false);
+        }
+    }
+};
+
+struct GltfPrimitive {
+    GltfAccessor positions;
+    GltfAccessor colors;
+    GltfAccessor normals;
+    GltfAccessor indices;
+    bool has_colors = false;
+    bool has_normals = false;
+    bool has_indices = false;
+    uint64_t vertex_base = 0;
+    uint64_t index_base = 0;
+    uint64_t num_indices = 0;
+};
+
+// A range of a primitive's vertices or indices to write
+struct GltfJob {
+    size_t primitive = 0;
+    bool vertices = true;
+    uint64_t begin = 0;
+    uint64_t end = 0;
+};
+
+std::string decode_uri(const std::string &uri)
+{
+    std::string s;
+    for (size_t i = 0; i < uri.size(); ++i) {
+        if (uri[i] == '%' && i + 2 < uri.size()) {
+            s += char(std::strtoul(uri.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        } else {
+            s += uri[i];
+        }
+    }
+    return s;
+}
+
+GltfAccessor gltf_accessor(const Json &gltf,
+                           const std::vector<std::pair<const char *, uint64_t>> &buffers,
+                           const uint64_t index,
+                           const std::string &path)
+{
+    const Json *accessors = gltf.get("accessors");
+    const Json *views = gltf.get("bufferViews");
+    if (!accessors || index >= accessors->array.size() || !views) {
+        throw parse_error(path, "invalid accessor");
+    }
+    const Json &accessor = accessors->array[index];
+    const Json *type = accessor.get("type");
+    if (!accessor.get("bufferView") || accessor.get("sparse") || !type) {
+        throw parse_error(path, "sparse or empty accessors aren't supported");
+    }
+    const uint64_t view_index = accessor.get_number("bufferView", 0);
+    if (view_index >= views->array.size()) {
+        throw parse_error(path, "invalid buffer view");
+    }
+    const Json &view = views->array[view_index];
+    const uint64_t buffer_index = view.get_number("buffer", 0);
+    if (buffer_index >= buffers.size()) {
+        throw parse_error(path, "invalid buffer");
+    }
+
+    GltfAccessor a;
+    a.count = accessor.get_number("count", 0);
+    a.component_type = accessor.get_number("componentType", 0);
+    a.num_components = gltf_num_components(type->string);
+    const Json *normalized = accessor.get("normalized");
+    a.normalized = normalized && normalized->boolean;
+    const uint64_t element_size = gltf_component_size(a.component_type) * a.num_components;
+    a.stride = view.get_number("byteStride", element_size);
+    if (element_size == 0) {
+        throw parse_error(path, "invalid accessor type");
+    }
+
+    const uint64_t view_offset = view.get_number("byteOffset", 0);
+    const uint64_t view_length = view.get_number("byteLength", 0);
+    const uint64_t offset = accessor.get_number("byteOffset", 0);
+    // The elements must lie within the view, and the view within the buffer
+    if (view_offset + view_length > buffers[buffer_index].second ||
+        (a.count > 0 && offset + a.stride * (a.count - 1) + element_size > view_length)) {
+        throw parse_error(path, "accessor out of bounds");
+    }
+    a.data = buffers[buffer_index].first + view_offset + offset;
+    return a;
+}
+
+void load_gltf(MeshLoad &load)
+{
+    const MappedFile &file = *load.file;
+    const std::string &path = load.path;
+    // A .glb holds the JSON and the first buffer in chunks, a .gltf is only JSON
+    const char *json_begin = file.begin();
+    const char *json_end = file.end();
+    std::pair<const char *, uint64_t> glb_buffer(nullptr, 0);
+    if (file.size() >= 12 && std::memcmp(file.begin(), "glTF", 4) == 0) {
+        const char *p = file.begin() + 12;
+        while (file.end() - p >= 8) {
+            const uint32_t chunk_length = load_value<uint32_t>(p, false);
+            const uint32_t chunk_type = load_value<uint32_t>(p + 4, false);
+            p += 8;
+            if (uint64_t(file.end() - p) < chunk_length) {
+                throw parse_error(path, "truncated GLB chunk");
+            }
+            if (chunk_type == 0x4e4f534a) {
+                json_begin = p;
+                json_end = p + chunk_length;
+            } else if (chunk_type == 0x004e4942) {
+                glb_buffer = std::make_pair(p, uint64_t(chunk_length));
+            }
+            p += chunk_length;
+        }
+    }
+    const Json gltf = JsonParser(json_begin, json_end, path).parse();
+
+    // Map the external buffers next to the file
+    const size_t slash = path.find_last_of("/\\");
+    const std::string dir = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+    std::vector<std::unique_ptr<MappedFile>> buffer_files;
+    std::vector<std::pair<const char *, uint64_t>> buffers;
+    if (const Json *bufs = gltf.get("buffers")) {
+        for (const auto &b : bufs->array) {
+            const Json *uri = b.get("uri");
+            if (!uri) {
+                buffers.push_back(glb_buffer);
+                continue;
+            }
+            if (uri->string.compare(0, 5, "data:") == 0) {
+                throw parse_error(path, "embedded data URI buffers aren't supported");
+            }
+            buffer_files.emplace_back(new MappedFile(dir + decode_uri(uri->string)));
+            buffers.emplace_back(buffer_files.back()->begin(), buffer_files.back()->size());
+            load.file_bytes += buffer_files.back()->size();
+        }
+    }
+
+    std::vector<GltfPrimitive> primitives;
+    uint64_t num_vertices = 0;
+    uint64_t num_indices = 0;
+    // The merged mesh has normals if any primitive does, the others get +z
+    bool has_normals = false;
+    if (const Json *meshes = gltf.get("meshes")) {
+        for (const auto &m : meshes->array) {
+            const Json *prims = m.get("primitives");
+            if (!prims) {
+                continue;
+            }
+            for (const auto &prim : prims->array) {
+                const Json *attributes = prim.get("attributes");
+                if (prim.get_number("mode", GLTF_TRIANGLES) != GLTF_TRIANGLES || !attributes ||
+                    !attributes->get("POSITION")) {
+                    continue;
+                }
+                GltfPrimitive p;
+                p.positions = gltf_accessor(
+                    gltf, buffers, attributes->get_number("POSITION", 0), path);
+                if (p.positions.component_type != GLTF_FLOAT ||
+                    p.positions.num_components != 3) {
+                    throw parse_error(path, "positions must be float3");
+                }
+                if (attributes->get("COLOR_0")) {
+                    p.colors = gltf_accessor(
+                        gltf, buffers, attributes->get_number("COLOR_0", 0), path);
+                    p.has_colors = p.colors.num_components >= 3 &&
+                                   p.colors.count == p.positions.count;
+                }
+                if (attributes->get("NORMAL")) {
+                    p.normals = gltf_accessor(
+                        gltf, buffers, attributes->get_number("NORMAL", 0), path);
+                    p.has_normals = p.normals.num_components == 3 &&
+                                    p.normals.count == p.positions.count;
+                    has_normals = has_normals || p.has_normals;
+                }
+                p.num_indices = p.positions.count;
+                if (prim.get("indices")) {
+                    p.indices =
+                        gltf_accessor(gltf, buffers, prim.get_number("indices", 0), path);
+                    p.has_indices = true;
+                    p.num_indices = p.indices.count;
+                }
+                p.num_indices -= p.num_indices % 3;
+                p.vertex_base = num_vertices;
+                p.index_base = num_indices;
+                num_vertices += p.positions.count;
+                num_indices += p.num_indices;
+                primitives.push_back(p);
+            }
+        }
+    }
+
+    std::vector<GltfJob> jobs;
+    for (size_t i = 0; i < primitives.size(); ++i) {
+        for (uint64_t j = 0; j < primitives[i].positions.count; j += BINARY_CHUNK_ITEMS) {
+            GltfJob job;
+            job.primitive = i;
+            job.begin = j;
+            job.end = std::min(j + BINARY_CHUNK_ITEMS, primitives[i].positions.count);
+            jobs.push_back(job);
+        }
+        for (uint64_t j = 0; j < primitives[i].num_indices; j += BINARY_CHUNK_ITEMS) {
+            GltfJob job;
+            job.primitive = i;
+            job.vertices = false;
+            job.begin = j;
+            job.end = std::min(j + BINARY_CHUNK_ITEMS, primitives[i].num_indices);
+            jobs.push_back(job);
+        }
+    }
+
+    auto read_vec3 = [](const GltfAccessor &a, const uint64_t i) {
+        return glm::vec3(a.read_float(i, 0), a.read_float(i, 1), a.read_float(i, 2));
+    };
+
+    // The accessors' min and max are optional and may be stale, so find the bounds
+    // from the positions
+    std::vector<Bounds> job_bounds(jobs.size());
+    CPU_ZONE_BEGIN(bounds_zone, "bounds_gltf");
+    parallel_for(jobs.size(), load.num_threads, [&](uint64_t j) {
+        const GltfJob &job = jobs[j];
+        if (job.vertices) {
+            for (uint64_t i = job.begin; i < job.end; ++i) {
+                job_bounds[j].add(read_vec3(primitives[job.primitive].positions, i));
+            }
+        }
+    });
+    CPU_ZONE_END(bounds_zone);
+    for (const auto &b : job_bounds) {
+        load.bounds.merge(b);
+    }
+
+    create_mesh_buffers(load, num_vertices, num_indices / 3, has_normals);
+    const MeshOutput &out = load.out;
+
+    CPU_ZONE_BEGIN(parse_zone, "parse_gltf");
+    parallel_for(jobs.size(), load.num_threads, [&](uint64_t j) {
+        const GltfJob &job = jobs[j];
+        const GltfPrimitive &p = primitives[job.primitive];
+        if (job.vertices) {
+            for (uint64_t i = job.begin; i < job.end; ++i) {
+                const glm::vec3 color = p.has_colors ? read_vec3(p.colors, i) : glm::vec3(1.f);
+                const glm::vec3 normal = p.has_normals ? unit_normal(read_vec3(p.normals, i))
+                                                       : glm::vec3(0.f, 0.f, 1.f);
+                out.write_vertex(p.vertex_base + i, read_vec3(p.positions, i), color, normal);
+            }
+            return;
+        }
+        uint32_t *indices = out.indices + p.index_base;
+        for (uint64_t i = job.begin; i < job.end; ++i) {
+            const uint64_t index = p.has_indices ? p.indices.read_index(i) : i;
+            if (index >= p.positions.count) {
+                throw parse_error(path, "index out of range");
+            }
+            indices[i] = static_cast<uint32_t>(p.vertex_base + index);
+        }
+    });
+    CPU_ZONE_END(parse_zone);
+}
+
+/* Optimize the mapped mesh in place, then move the vertices to a smaller buffer
+ * if any were merged or unused. Returns the time the move took, in ms
+ */
+double optimize_mesh_output(MeshLoad &load, MeshOptimizeStats *stats)
+{
+    MeshOutput &out = load.out;
+    const uint32_t stride = out.mesh.format.stride;
+    const uint32_t num_vertices = optimize_mesh(
+        out.vertices, out.mesh.num_vertices, stride, out.indices, out.mesh.num_indices, stats);
+    if (num_vertices == out.mesh.num_vertices) {
+        return 0.0;
+    }
+    CPU_ZONE("shrink_mesh_vertices");
+    const auto shrink_start = std::chrono::steady_clock::now();
+    wgpu::BufferDescriptor buffer_desc;
+    buffer_desc.mappedAtCreation = true;
+    buffer_desc.size = uint64_t(num_vertices) * stride;
+    buffer_desc.usage = wgpu::BufferUsage::Vertex;
+    wgpu::Buffer vertex_buf =
+        gpu_memory_create_buffer(load.device, buffer_desc, "mesh_vertices");
+    void *vertices = vertex_buf.GetMappedRange();
+    if (!vertices) {
+        gpu_memory_release(vertex_buf);
+        throw std::runtime_error("Failed to allocate the buffers for " + load.path);
+    }
+    std::memcpy(vertices, out.vertices, buffer_desc.size);
+    gpu_memory_release(out.mesh.vertex_buf);
+    out.mesh.vertex_buf = vertex_buf;
+    out.vertices = static_cast<char *>(vertices);
+    out.mesh.num_vertices = num_vertices;
+    const auto shrink_time = std::chrono::steady_clock::now() - shrink_start;
+    return std::chrono::duration<double, std::milli>(shrink_time).count();
+}
+
+// Split the mapped mesh into meshlets and upload them to a storage buffer
+void build_mesh_meshlets(MeshLoad &load)
+{
+    MeshOutput &out = load.out;
+    const std::vector<Meshlet> meshlets = build_meshlets(out.vertices,
+                                                         out.mesh.format,
+                                                         out.mesh.num_vertices,
+                                                         out.indices,
+                                                         out.mesh.num_indices);
+    if (meshlets.empty()) {
+        return;
+    }
+    wgpu::BufferDescriptor buffer_desc;
+    buffer_desc.mappedAtCreation = true;
+    buffer_desc.size = meshlets.size() * sizeof(Meshlet);
+    buffer_desc.usage = wgpu::BufferUsage::Storage;
+    out.mesh.meshlet_buf = gpu_memory_create_buffer(load.device, buffer_desc, "mesh_meshlets");
+    void *mapped = out.mesh.meshlet_buf.GetMappedRange();
+    if (!mapped) {
+        throw std::runtime_error("Failed to allocate the meshlet buffer for " + load.path);
+    }
+    std::memcpy(mapped, meshlets.data(), buffer_desc.size);
+    out.mesh.meshlet_buf.Unmap();
+    out.mesh.num_meshlets = meshlets.size();
+}
+
+std::string lowercase_extension(const std::string &path)
+{
+    const size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) {
+        return "";
+    }
+    std::string ext = path.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) {
+        return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
+    });
+    return ext;
+}
+
+}
+
+double MeshLoadStats::throughput_mb_s() const
+{
+    return load_ms > 0.0 ? (file_bytes / (1024.0 * 1024.0)) / (load_ms / 1000.0) : 0.0;
+}
+
+void MeshLoadStats::print(std::ostream &os) const
+{
+    os << "Mesh load: " << num_vertices << " vertices, " << num_triangles << " triangles from "
+       << file_bytes / (1024.0 * 1024.0) << "MB in " << load_ms << "ms on " << num_threads
+       << " threads (" << throughput_mb_s() << "MB/s)\n";
+    os << "Mesh vertex format: " << vertex_format << ", "
+       << double(UNQUANTIZED_VERTEX_SIZE) / std::max(vertex_stride, 1u)
+       << "x smaller than unquantized, " << num_vertices * vertex_stride / (1024.0 * 1024.0)
+       << "MB of vertices\n";
+    if (optimized) {
+        optimize.print(os);
+        if (shrink_ms > 0.0) {
+            os << "Mesh vertex shrink: " << shrink_ms << "ms\n";
+        }
+    }
+    if (num_meshlets > 0) {
+        os << "Mesh meshlets: " << num_meshlets << " in " << meshlet_ms << "ms, "
+           << double(num_triangles) / num_meshlets << " triangles per meshlet\n";
+    }
+    if (peak_rss_bytes > 0) {
+        os << "Mesh load peak resident memory: " << peak_rss_bytes / (1024.0 * 1024.0)
+           << "MB, loading added " << peak_rss_growth_bytes / (1024.0 * 1024.0) << "MB ("
+           << (file_bytes > 0 ? double(peak_rss_growth_bytes) / file_bytes : 0.0)
+           << "x the file size)\n";
+    }
+}
+
+Mesh load_mesh(const wgpu::Device &device,
+               const std::string &path,
+               const MeshLoadOptions &options,
+               MeshLoadStats *stats)
+{
+    CPU_ZONE("load_mesh");
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t start_peak_rss = peak_resident_bytes();
+    uint32_t num_threads = options.num_threads;
+    if (num_threads == 0) {
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    const std::string ext = lowercase_extension(path);
+    if (ext != ".obj" && ext != ".ply" && ext != ".gltf" && ext != ".glb") {
+        throw std::runtime_error("Unsupported mesh format " + path +
+                                 ", expected .obj, .ply, .gltf or .glb");
+    }
+    MappedFile file(path);
+    MeshLoad load;
+    load.device = device;
+    load.file = &file;
+    load.path = path;
+    load.num_threads = num_threads;
+    load.file_bytes = file.size();
+    load.error_bounds = options.error_bounds;
+    MeshOptimizeStats optimize_stats;
+    // The whole optimize step, including measuring the vertex cache and shrinking
+    // the vertex buffer, so none of it counts towards the load time
+    double optimize_ms = 0.0;
+    double shrink_ms = 0.0;
+    double meshlet_ms = 0.0;
+    try {
+        if (ext == ".obj") {
+            load_obj(load);
+        } else if (ext == ".ply") {
+            load_ply(load);
+        } else {
+            load_gltf(load);
+        }
+        if (options.optimize) {
+            // Measuring the vertex cache takes extra passes, only do it if asked for
+            const auto optimize_start = std::chrono::steady_clock::now();
+            shrink_ms = optimize_mesh_output(load, stats ? &optimize_stats : nullptr);
+            optimize_ms = std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - optimize_start)
+                              .count();
+        }
+        if (options.build_meshlets) {
+            const auto meshlet_start = std::chrono::steady_clock::now();
+            build_mesh_meshlets(load);
+            meshlet_ms = std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - meshlet_start)
+                             .count();
+        }
+    } catch (...) {
+        release_mesh(load.out.mesh);
+        throw;
+    }
+    MeshOutput &out = load.out;
+    out.mesh.vertex_buf.Unmap();
+    out.mesh.index_buf.Unmap();
+    out.mesh.bounds_min = load.bounds.min;
+    out.mesh.bounds_max = load.bounds.max;
+
+    if (stats) {
+        stats->file_bytes = load.file_bytes;
+        stats->num_vertices = out.mesh.num_vertices;
+        stats->num_triangles = out.mesh.num_indices / 3;
+        stats->num_threads = num_threads;
+        stats->vertex_format = out.mesh.format.name();
+        stats->vertex_stride = out.mesh.format.stride;
+        stats->optimized = options.optimize;
+        stats->optimize = optimize_stats;
+        stats->shrink_ms = shrink_ms;
+        stats->num_meshlets = out.mesh.num_meshlets;
+        stats->meshlet_ms = meshlet_ms;
+        stats->load_ms = std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - start)
+                             .count() -
+                         optimize_ms - meshlet_ms;
+        stats->peak_rss_bytes = peak_resident_bytes();
+        stats->peak_rss_growth_bytes = stats->peak_rss_bytes - start_peak_rss;
+    }
+    return out.mesh;
+}
+
+Mesh create_triangle_mesh(const wgpu::Device &device, const VertexErrorBounds &error_bounds)
+{
+    const glm::vec3 positions[] = {
+        glm::vec3(1.f, -1.f, 0.f), glm::vec3(-1.f, -1.f, 0.f), glm::vec3(0.f, 1.f, 0.f)};
+    const glm::vec3 colors[] = {
+        glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f), glm::vec3(0.f, 0.f, 1.f)};
+    Mesh mesh;
+    mesh.bounds_min = glm::vec3(-1.f, -1.f, 0.f);
+    mesh.bounds_max = glm::vec3(1.f, 1.f, 0.f);
+    mesh.format = choose_vertex_format(mesh.bounds_min, mesh.bounds_max, false, error_bounds);
+
+    wgpu::BufferDescriptor buffer_desc;
+    buffer_desc.mappedAtCreation = true;
+    buffer_desc.size = 3 * mesh.format.stride;
+    buffer_desc.usage = wgpu::BufferUsage::Vertex;
+    mesh.vertex_buf = gpu_memory_create_buffer(device, buffer_desc, "scene_vertices");
+    char *vertices = static_cast<char *>(mesh.vertex_buf.GetMappedRange());
+    for (uint32_t i = 0; i < 3; ++i) {
+        encode_vertex(mesh.format,
+                      positions[i],
+                      colors[i],
+                      glm::vec3(0.f, 0.f, 1.f),
+                      vertices + i * mesh.format.stride);
+    }
+    mesh.vertex_buf.Unmap();
+    mesh.num_vertices = 3;
+
+    // Indexed like loaded meshes, so the GPU driven draws can draw it indirectly
+    const uint32_t indices[] = {0, 1, 2};
+    buffer_desc.size = sizeof(indices);
+    buffer_desc.usage = wgpu::BufferUsage::Index;
+    mesh.index_buf = gpu_memory_create_buffer(device, buffer_desc, "scene_indices");
+    std::memcpy(mesh.index_buf.GetMappedRange(), indices, sizeof(indices));
+    mesh.index_buf.Unmap();
+    mesh.num_indices = 3;
+    return mesh;
+}
+
+void release_mesh(Mesh &mesh)
+{
+    gpu_memory_release(mesh.vertex_buf);
+    gpu_memory_release(mesh.index_buf);
+    gpu_memory_release(mesh.meshlet_buf);
+    mesh = Mesh();
+}
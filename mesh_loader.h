@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <glm/glm.hpp>
+#include "mesh_optimizer.h"
+#include "meshlet_builder.h"
+#include "vertex_format.h"
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+/* A triangle mesh in GPU buffers. The vertices are interleaved in the mesh's
+ * format, which the renderer builds the vertex layout from. Meshes with an index
+ * buffer are drawn indexed with 32-bit indices, otherwise num_vertices vertices
+ * are drawn as a triangle list.
+ */
+struct Mesh {
+    wgpu::Buffer vertex_buf;
+    wgpu::Buffer index_buf;
+    VertexFormat format;
+    uint32_t num_vertices = 0;
+    uint32_t num_indices = 0;
+    // The mesh's Meshlets in a storage buffer, for indexed meshes split into them
+    wgpu::Buffer meshlet_buf;
+    uint32_t num_meshlets = 0;
+    // The bounds of the vertex positions
+    glm::vec3 bounds_min = glm::vec3(0.f);
+    glm::vec3 bounds_max = glm::vec3(0.f);
+};
+
+struct MeshLoadOptions {
+    // The threads parsing the file, 0 uses one per core
+    uint32_t num_threads = 0;
+    VertexErrorBounds error_bounds;
+    // Deduplicate the vertices and reorder the triangles and vertices for the
+    // vertex cache and fetch, see optimize_mesh
+    bool optimize = true;
+    // Split the triangles into meshlets for cluster culling, see build_meshlets
+    bool build_meshlets = true;
+};
+
+struct MeshLoadStats {
+    uint64_t file_bytes = 0;
+    uint64_t num_vertices = 0;
+    uint64_t num_triangles = 0;
+    uint32_t num_threads = 0;
+    // The name and size of the vertex format chosen for the mesh
+    std::string vertex_format;
+    uint32_t vertex_stride = 0;
+    // From opening the file to the buffers being unmapped, excluding optimizing and
+    // building meshlets, so it only covers mapping, parsing and streaming the file
+    double load_ms = 0.0;
+    // Set if the mesh was optimized, num_vertices is then the number after
+    bool optimized = false;
+    MeshOptimizeStats optimize;
+    // The time taken moving the optimized vertices to a smaller buffer, 0 if none
+    // were merged or unused
+    double shrink_ms = 0.0;
+    // The meshlets the mesh was split into and the time it took
+    uint32_t num_meshlets = 0;
+    double meshlet_ms = 0.0;
+    // The process' peak resident memory after loading, and how much loading raised
+    // it, 0 if the platform doesn't report it
+    uint64_t peak_rss_bytes = 0;
+    uint64_t peak_rss_growth_bytes = 0;
+
+    // Get the file bytes parsed per second, in MB/s
+    double throughput_mb_s() const;
+
+    void print(std::ostream &os) const;
+};
+
+/* Load a mesh from an OBJ, PLY (ASCII or binary) or glTF (.gltf with external
+ * buffers or .glb) file, picked by the file's extension. The file is memory
+ * mapped and parsed in parallel chunks on the options' threads, writing the
+ * vertices and indices directly into the mapped ranges of the new buffers. Text
+ * formats are first scanned to count each chunk's vertices and triangles, so
+ * each chunk knows where its output goes before it's parsed.
+ *
+ * The bounds are found before the buffers are created, so the vertices are
+ * quantized into the most compact format within the error bounds as they're
+ * written, see choose_vertex_format. If optimizing, the mapped vertices and
+ * indices are then processed in place before unmapping them, and the vertex
+ * buffer is shrunk if vertices were merged. Last, the triangles are split into
+ * meshlets, whose bounds go into the mesh's meshlet buffer.
+ *
+ * Polygons are split into triangle fans. Vertices without colors are white.
+ * Normals are read from PLY and glTF, OBJ normals are indexed per face corner and
+ * aren't loaded. For glTF, the triangle primitives of all meshes are merged and
+ * node transforms aren't applied. Throws std::runtime_error if the file can't be
+ * read, isn't supported or the mesh exceeds the device's buffer size limit.
+ */
+Mesh load_mesh(const wgpu::Device &device,
+               const std::string &path,
+               const MeshLoadOptions &options = MeshLoadOptions(),
+               MeshLoadStats *stats = nullptr);
+
+// Create the mesh of a single indexed triangle covering [-1, 1]
+Mesh create_triangle_mesh(const wgpu::Device &device,
+                          const VertexErrorBounds &error_bounds = VertexErrorBounds());
+
+// Release the mesh's buffers from the GPU memory tracker
+void release_mesh(Mesh &mesh);
@@ -0,0 +1,289 @@
+#include "mesh_optimizer.h"
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include "cpu_profiler.h"
+
+namespace {
+
+const uint32_t NO_VERTEX = 0xffffffff;
+
+uint32_t rotl(const uint32_t x, const int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+// MurmurHash3's 32-bit mixing over the vertex's words, strides are a multiple of 4
+uint32_t hash_vertex(const char *v, const uint32_t stride)
+{
+    uint32_t h = 0;
+    for (uint32_t i = 0; i + 4 <= stride; i += 4) {
+        uint32_t w;
+        std::memcpy(&w, v + i, sizeof(w));
+        w *= 0xcc9e2d51;
+        w = rotl(w, 15);
+        w *= 0x1b873593;
+        h ^= w;
+        h = rotl(h, 13);
+        h = h * 5 + 0xe6546b64;
+    }
+    h ^= stride;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+double elapsed_ms(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+}
+
+VertexCacheStats analyze_vertex_cache(const uint32_t *indices,
+                                      const uint64_t num_indices,
+                                      const uint32_t num_vertices,
+                                      const uint32_t cache_size)
+{
+    // A vertex is in the FIFO if it was inserted within the last cache_size misses.
+    // Times start past cache_size so a time of 0 means the vertex was never seen
+    std::vector<uint64_t> insert_time(num_vertices, 0);
+    uint64_t time = cache_size + 1;
+    uint64_t num_misses = 0;
+    uint64_t num_referenced = 0;
+    for (uint64_t i = 0; i < num_indices; ++i) {
+        const uint32_t v = indices[i];
+        if (time - insert_time[v] > cache_size) {
+            num_referenced += insert_time[v] == 0 ? 1 : 0;
+            insert_time[v] = time++;
+            ++num_misses;
+        }
+    }
+    VertexCacheStats stats;
+    const uint64_t num_triangles = num_indices / 3;
+    stats.acmr = num_triangles > 0 ? double(num_misses) / num_triangles : 0.0;
+    stats.atvr = num_referenced > 0 ? double(num_misses) / num_referenced : 0.0;
+    return stats;
+}
+
+uint32_t deduplicate_vertices(char *vertices,
+                              const uint32_t num_vertices,
+                              const uint32_t stride,
+                              uint32_t *indices,
+                              const uint64_t num_indices)
+{
+    CPU_ZONE("deduplicate_vertices");
+    // Open addressing with linear probing, kept under half full. The table holds
+    // the new index of each unique vertex, which has already been moved there
+    uint64_t table_size = 16;
+    while (table_size < uint64_t(num_vertices) * 2) {
+        table_size *= 2;
+    }
+    const uint64_t mask = table_size - 1;
+    std::vector<uint32_t> table(table_size, NO_VERTEX);
+    std::vector<uint32_t> remap(num_vertices);
+    uint32_t num_unique = 0;
+    for (uint32_t v = 0; v < num_vertices; ++v) {
+        const char *vertex = vertices + uint64_t(v) * stride;
+        uint64_t slot = hash_vertex(vertex, stride) & mask;
+        while (table[slot] != NO_VERTEX &&
+               std::memcmp(vertices + uint64_t(table[slot]) * stride, vertex, stride) != 0) {
+            slot = (slot + 1) & mask;
+        }
+        if (table[slot] != NO_VERTEX) {
+            remap[v] = table[slot];
+            continue;
+        }
+        // The unique vertices so far all lie before v, so the copy can't overlap
+        if (num_unique != v) {
+            std::memcpy(vertices + uint64_t(num_unique) * stride, vertex, stride);
+        }
+        table[slot] = num_unique;
+        remap[v] = num_unique++;
+    }
+    for (uint64_t i = 0; i < num_indices; ++i) {
+        indices[i] = remap[indices[i]];
+    }
+    return num_unique;
+}
+
+void optimize_vertex_cache(uint32_t *indices,
+                           const uint64_t num_indices,
+                           const uint32_t num_vertices,
+                           const uint32_t cache_size)
+{
+    CPU_ZONE("optimize_vertex_cache");
+    const uint64_t num_triangles = num_indices / 3;
+
+    // The triangles using each vertex, and how many of them are still to be emitted
+    std::vector<uint32_t> live(num_vertices, 0);
+    for (uint64_t i = 0; i < num_triangles * 3; ++i) {
+        ++live[indices[i]];
+    }
+    std::vector<uint32_t> offsets(uint64_t(num_vertices) + 1, 0);
+    for (uint32_t v = 0; v < num_vertices; ++v) {
+        offsets[v + 1] = offsets[v] + live[v];
+    }
+    std::vector<uint32_t> adjacency(num_triangles * 3);
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (uint64_t i = 0; i < num_triangles * 3; ++i) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<uint64_t> cache_time(num_vertices, 0);
+    std::vector<uint8_t> emitted(num_triangles, 0);
+    std::vector<uint32_t> dead_end;
+    dead_end.reserve(num_triangles * 3);
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> out(num_triangles * 3);
+    uint64_t num_out = 0;
+    uint64_t time = cache_size + 1;
+    uint32_t cursor = 0;
+
+    // Fan out from the current vertex, emitting all its remaining triangles, then
+    // move to the candidate that will stay in the cache longest
+    int64_t fan_vertex = num_vertices > 0 ? 0 : -1;
+    while (fan_vertex >= 0) {
+        candidates.clear();
+        const uint32_t f = static_cast<uint32_t>(fan_vertex);
+        for (uint32_t a = offsets[f]; a < offsets[f + 1]; ++a) {
+            const uint32_t t = adjacency[a];
+            if (emitted[t]) {
+                continue;
+            }
+            emitted[t] = 1;
+            for (uint32_t j = 0; j < 3; ++j) {
+                const uint32_t v = indices[uint64_t(t) * 3 + j];
+                out[num_out++] = v;
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - cache_time[v] > cache_size) {
+                    cache_time[v] = time++;
+                }
+            }
+        }
+
+        fan_vertex = -1;
+        int64_t best_priority = -1;
+        for (const uint32_t v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+            // Prefer the oldest vertex that will still be cached after its fan
+            int64_t priority = 0;
+            if (time - cache_time[v] + 2 * uint64_t(live[v]) <= cache_size) {
+                priority = time - cache_time[v];
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                fan_vertex = v;
+            }
+        }
+        // Otherwise back up to a recently used vertex, then to the next one in
+        // input order with triangles left
+        while (fan_vertex < 0 && !dead_end.empty()) {
+            const uint32_t v = dead_end.back();
+            dead_end.pop_back();
+            if (live[v] > 0) {
+                fan_vertex = v;
+            }
+        }
+        for (; fan_vertex < 0 && cursor < num_vertices; ++cursor) {
+            if (live[cursor] > 0) {
+                fan_vertex = cursor;
+            }
+        }
+    }
+    std::memcpy(indices, out.data(), num_out * sizeof(uint32_t));
+}
+
+uint32_t optimize_vertex_fetch(char *vertices,
+                               const uint32_t num_vertices,
+                               const uint32_t stride,
+                               uint32_t *indices,
+                               const uint64_t num_indices)
+{
+    CPU_ZONE("optimize_vertex_fetch");
+    std::vector<uint32_t> remap(num_vertices, NO_VERTEX);
+    uint32_t num_used = 0;
+    for (uint64_t i = 0; i < num_indices; ++i) {
+        uint32_t &r = remap[indices[i]];
+        if (r == NO_VERTEX) {
+            r = num_used++;
+        }
+        indices[i] = r;
+    }
+    std::vector<char> sorted(uint64_t(num_used) * stride);
+    for (uint32_t v = 0; v < num_vertices; ++v) {
+        if (remap[v] != NO_VERTEX) {
+            std::memcpy(sorted.data() + uint64_t(remap[v]) * stride,
+                        vertices + uint64_t(v) * stride,
+                        stride);
+        }
+    }
+    std::memcpy(vertices, sorted.data(), sorted.size());
+    return num_used;
+}
+
+double MeshOptimizeStats::total_ms() const
+{
+    return dedup_ms + cache_ms + fetch_ms;
+}
+
+double MeshOptimizeStats::throughput_mtris_s() const
+{
+    return total_ms() > 0.0 ? (num_triangles / 1e6) / (total_ms() / 1000.0) : 0.0;
+}
+
+void MeshOptimizeStats::print(std::ostream &os) const
+{
+    os << "Mesh optimize: " << num_triangles << " triangles, " << vertices_before << " -> "
+       << vertices_after << " vertices in " << total_ms() << "ms (dedup " << dedup_ms
+       << "ms, vertex cache " << cache_ms << "ms, vertex fetch " << fetch_ms << "ms, "
+       << throughput_mtris_s() << "M triangles/s)\n"
+       << "Mesh vertex cache (FIFO " << VERTEX_CACHE_SIZE << "): ACMR " << cache_before.acmr
+       << " -> " << cache_after.acmr << ", ATVR " << cache_before.atvr << " -> "
+       << cache_after.atvr << "\n";
+}
+
+uint32_t optimize_mesh(char *vertices,
+                       const uint32_t num_vertices,
+                       const uint32_t stride,
+                       uint32_t *indices,
+                       const uint64_t num_indices,
+                       MeshOptimizeStats *stats)
+{
+    CPU_ZONE("optimize_mesh");
+    MeshOptimizeStats s;
+    s.num_triangles = num_indices / 3;
+    s.vertices_before = num_vertices;
+    if (stats) {
+        s.cache_before = analyze_vertex_cache(indices, num_indices, num_vertices);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint32_t n = deduplicate_vertices(vertices, num_vertices, stride, indices, num_indices);
+    s.dedup_ms = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    optimize_vertex_cache(indices, num_indices, n);
+    s.cache_ms = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    n = optimize_vertex_fetch(vertices, n, stride, indices, num_indices);
+    s.fetch_ms = elapsed_ms(start);
+
+    s.vertices_after = n;
+    if (stats) {
+        s.cache_after = analyze_vertex_cache(indices, num_indices, n);
+        *stats = s;
+    }
+    return n;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+/* CPU processing of indexed triangle meshes to cut the vertex work the GPU does
+ * per triangle. The vertices are opaque interleaved blobs of stride bytes, so
+ * vertices are only considered equal if they're identical after quantization.
+ * All functions work in place on the vertex and 32-bit index arrays.
+ */
+
+// The FIFO post-transform cache size the triangle order is optimized for and
+// the statistics are measured with
+const uint32_t VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+    // Average cache miss ratio, vertices transformed per triangle: 0.5 is ideal
+    // for large regular meshes, 3 is the worst case
+    double acmr = 0.0;
+    // Average transform to vertex ratio, vertices transformed per referenced
+    // vertex: 1 is ideal
+    double atvr = 0.0;
+};
+
+/* Simulate a FIFO post-transform cache of cache_size entries over the triangles
+ * in index order
+ */
+VertexCacheStats analyze_vertex_cache(const uint32_t *indices,
+                                      const uint64_t num_indices,
+                                      const uint32_t num_vertices,
+                                      const uint32_t cache_size = VERTEX_CACHE_SIZE);
+
+/* Merge vertices with identical bytes, keeping the first of each in place and
+ * compacting the rest to the front in their original order. Indices are
+ * rewritten to the merged vertices. The stride must be a multiple of 4, as
+ * vertex strides are. Returns the new number of vertices.
+ */
+uint32_t deduplicate_vertices(char *vertices,
+                              const uint32_t num_vertices,
+                              const uint32_t stride,
+                              uint32_t *indices,
+                              const uint64_t num_indices);
+
+/* Reorder the triangles for the post-transform cache using Tipsify (Sander,
+ * Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced
+ * Overdraw", 2007), which runs in linear time. Each triangle's winding is kept.
+ */
+void optimize_vertex_cache(uint32_t *indices,
+                           const uint64_t num_indices,
+                           const uint32_t num_vertices,
+                           const uint32_t cache_size = VERTEX_CACHE_SIZE);
+
+/* Reorder the vertices in the order the triangles first use them, so the vertex
+ * fetch reads the vertex buffer mostly sequentially. Vertices no triangle uses
+ * are dropped. Returns the new number of vertices.
+ */
+uint32_t optimize_vertex_fetch(char *vertices,
+                               const uint32_t num_vertices,
+                               const uint32_t stride,
+                               uint32_t *indices,
+                               const uint64_t num_indices);
+
+struct MeshOptimizeStats {
+    uint64_t num_triangles = 0;
+    uint64_t vertices_before = 0;
+    uint64_t vertices_after = 0;
+    VertexCacheStats cache_before;
+    VertexCacheStats cache_after;
+    // The time each stage took, the analysis isn't included
+    double dedup_ms = 0.0;
+    double cache_ms = 0.0;
+    double fetch_ms = 0.0;
+
+    double total_ms() const;
+
+    // Get the triangles processed per second by all stages, in millions
+    double throughput_mtris_s() const;
+
+    void print(std::ostream &os) const;
+};
+
+/* Run the stages in order: deduplicate, optimize the vertex cache then the
+ * vertex fetch, measuring the cache before and after. Returns the new number
+ * of vertices.
+ */
+uint32_t optimize_mesh(char *vertices,
+                       const uint32_t num_vertices,
+                       const uint32_t stride,
+                       uint32_t *indices,
+                       const uint64_t num_indices,
+                       MeshOptimizeStats *stats = nullptr);
@@ -0,0 +1,113 @@
+#include "meshlet_builder.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "cpu_profiler.h"
+
+namespace {
+
+const uint32_t NO_MESHLET = 0xffffffff;
+
+// Fit the bounding sphere and normal cone of the meshlet's triangles
+void compute_meshlet_bounds(const char *vertices,
+                            const VertexFormat &format,
+                            const uint32_t *indices,
+                            Meshlet &meshlet)
+{
+    const uint32_t *tri_indices = indices + meshlet.first_index;
+    std::vector<glm::vec3> positions(meshlet.num_indices);
+    glm::vec3 bounds_min(std::numeric_limits<float>::max());
+    glm::vec3 bounds_max(-std::numeric_limits<float>::max());
+    for (uint32_t i = 0; i < meshlet.num_indices; ++i) {
+        positions[i] =
+            decode_position(format, vertices + uint64_t(tri_indices[i]) * format.stride);
+        bounds_min = glm::min(bounds_min, positions[i]);
+        bounds_max = glm::max(bounds_max, positions[i]);
+    }
+
+    // Centering on the box is within a factor of sqrt(3) of the smallest sphere
+    meshlet.center = 0.5f * (bounds_min + bounds_max);
+    meshlet.radius = 0.f;
+    for (const auto &p : positions) {
+        meshlet.radius = std::max(meshlet.radius, glm::length(p - meshlet.center));
+    }
+
+    // Degenerate triangles don't produce any fragments, so they don't widen the cone
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.num_indices / 3);
+    glm::vec3 normal_sum(0.f);
+    for (uint32_t i = 0; i + 2 < meshlet.num_indices; i += 3) {
+        const glm::vec3 n = glm::cross(positions[i + 1] - positions[i],
+                                       positions[i + 2] - positions[i]);
+        const float len = glm::length(n);
+        if (len > 0.f) {
+            normals.push_back(n / len);
+            normal_sum += normals.back();
+        }
+    }
+    meshlet.cone_axis = glm::vec3(0.f, 0.f, 1.f);
+    meshlet.cone_cutoff = 1.f;
+    const float sum_len = glm::length(normal_sum);
+    if (normals.empty() || sum_len == 0.f) {
+        return;
+    }
+    const glm::vec3 axis = normal_sum / sum_len;
+    float min_dot = 1.f;
+    for (const auto &n : normals) {
+        min_dot = std::min(min_dot, glm::dot(axis, n));
+    }
+    if (min_dot > 0.f) {
+        meshlet.cone_axis = axis;
+        meshlet.cone_cutoff = std::sqrt(1.f - min_dot * min_dot);
+    }
+}
+
+}
+
+std::vector<Meshlet> build_meshlets(const char *vertices,
+                                    const VertexFormat &format,
+                                    const uint32_t num_vertices,
+                                    const uint32_t *indices,
+                                    const uint64_t num_indices,
+                                    const uint32_t max_vertices,
+                                    const uint32_t max_triangles)
+{
+    CPU_ZONE("build_meshlets");
+    std::vector<Meshlet> meshlets;
+    // The last meshlet each vertex was added to, so each meshlet counts its unique
+    // vertices without clearing a set between meshlets
+    std::vector<uint32_t> vertex_meshlet(num_vertices, NO_MESHLET);
+    Meshlet meshlet;
+    uint32_t id = 0;
+    for (uint64_t i = 0; i + 2 < num_indices; i += 3) {
+        const uint32_t a = indices[i];
+        const uint32_t b = indices[i + 1];
+        const uint32_t c = indices[i + 2];
+        const uint32_t new_vertices = (vertex_meshlet[a] != id ? 1 : 0) +
+                                      (vertex_meshlet[b] != id && b != a ? 1 : 0) +
+                                      (vertex_meshlet[c] != id && c != a && c != b ? 1 : 0);
+        if (meshlet.num_vertices + new_vertices > max_vertices ||
+            meshlet.num_indices / 3 >= max_triangles) {
+            meshlets.push_back(meshlet);
+            meshlet = Meshlet();
+            meshlet.first_index = static_cast<uint32_t>(i);
+            ++id;
+            // Every vertex of the triangle is new to the next meshlet
+            meshlet.num_vertices = 1 + (b != a ? 1 : 0) + (c != a && c != b ? 1 : 0);
+        } else {
+            meshlet.num_vertices += new_vertices;
+        }
+        vertex_meshlet[a] = id;
+        vertex_meshlet[b] = id;
+        vertex_meshlet[c] = id;
+        meshlet.num_indices += 3;
+    }
+    if (meshlet.num_indices > 0) {
+        meshlets.push_back(meshlet);
+    }
+
+    for (auto &m : meshlets) {
+        compute_meshlet_bounds(vertices, format, indices, m);
+    }
+    return meshlets;
+}
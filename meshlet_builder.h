@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "vertex_format.h"
+
+// The most vertices and triangles in a meshlet, the sizes commonly used for mesh
+// shaders, which keep the meshlets small enough to be culled at a fine grain
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+/* A cluster of a mesh's triangles that's culled as a whole. The meshlet's
+ * triangles are a contiguous range of the mesh's index buffer, so a meshlet is
+ * drawn with DrawIndexed over its range. The struct matches the layout of the
+ * Meshlet struct in shaders/cluster_cull.wgsl, the bounds are in the mesh's
+ * dequantized space.
+ */
+struct Meshlet {
+    // The sphere bounding the meshlet's vertices
+    glm::vec3 center = glm::vec3(0.f);
+    float radius = 0.f;
+    /* The cone bounding the meshlet's triangle normals. Every triangle faces away
+     * from a viewer at v when dot(cone_axis, c - v) > cone_cutoff * |c - v| + radius,
+     * for the sphere's center c. The cutoff is the sine of the cone's half angle, or
+     * 1 if the normals span a hemisphere or more and the meshlet is never back facing.
+     */
+    glm::vec3 cone_axis = glm::vec3(0.f, 0.f, 1.f);
+    float cone_cutoff = 1.f;
+    uint32_t first_index = 0;
+    uint32_t num_indices = 0;
+    uint32_t num_vertices = 0;
+    uint32_t padding = 0;
+};
+
+static_assert(sizeof(Meshlet) == 48, "Meshlet must match the WGSL struct's layout");
+
+/* Split the triangles into meshlets of at most max_vertices unique vertices and
+ * max_triangles triangles. Triangles are taken greedily in index order, which
+ * keeps the triangles in place, so the mesh should already be ordered for
+ * locality, e.g. by optimize_vertex_cache, to get compact meshlets. The positions
+ * are decoded from the vertices to compute the bounds.
+ */
+std::vector<Meshlet> build_meshlets(const char *vertices,
+                                    const VertexFormat &format,
+                                    const uint32_t num_vertices,
+                                    const uint32_t *indices,
+                                    const uint64_t num_indices,
+                                    const uint32_t max_vertices = MESHLET_MAX_VERTICES,
+                                    const uint32_t max_triangles = MESHLET_MAX_TRIANGLES);
@@ -39,7 +39,9 @@ Context::Context(SDL_Window *window)
     layer.pixelFormat = MTLPixelFormatBGRA8Unorm;
     layer.framebufferOnly = NO;
 
+    // Match the window's pixel density, the swap chain is sized in pixels
     NSWindow *nswindow = wm_info.info.cocoa.window;
+    layer.contentsScale = nswindow.backingScaleFactor;
     nswindow.contentView.layer = layer;
     nswindow.contentView.wantsLayer = YES;
 }
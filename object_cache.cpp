@@ -0,0 +1,425 @@
+#include "object_cache.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Flattens a descriptor into a key of 64-bit words
+struct KeyWriter {
+    ObjectCache::Key key;
+    // Cleared if the descriptor has a chained struct we don't know how to key
+    bool cacheable = true;
+
+    void add(const uint64_t value)
+    {
+        key.push_back(value);
+    }
+
+    template <typename T>
+    void add_object(const T &object)
+    {
+        add(reinterpret_cast<uintptr_t>(object.Get()));
+    }
+
+    void add_float(const float value)
+    {
+        uint32_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(float));
+        add(bits);
+    }
+
+    void add_double(const double value)
+    {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(double));
+        add(bits);
+    }
+
+    // Strings are keyed by their length followed by their bytes packed into words,
+    // a null string gets a length no real string has
+    void add_string(const char *str)
+    {
+        if (!str) {
+            add(~uint64_t(0));
+            return;
+        }
+        const size_t len = std::strlen(str);
+        add(len);
+        for (size_t i = 0; i < len; i += sizeof(uint64_t)) {
+            uint64_t word = 0;
+            std::memcpy(&word, str + i, std::min(sizeof(uint64_t), len - i));
+            add(word);
+        }
+    }
+
+    // Key the chained structs by their type and members, the end of the chain is
+    // marked by an Invalid sType
+    void add_chain(const wgpu::ChainedStruct *next)
+    {
+        for (; next; next = next->nextInChain) {
+            add(static_cast<uint64_t>(next->sType));
+            switch (next->sType) {
+            case wgpu::SType::PrimitiveDepthClipControl:
+                add(reinterpret_cast<const wgpu::PrimitiveDepthClipControl *>(next)
+                        ->unclippedDepth);
+                break;
+            case wgpu::SType::ExternalTextureBindingLayout:
+                break;
+            default:
+                cacheable = false;
+                break;
+            }
+        }
+        add(static_cast<uint64_t>(wgpu::SType::Invalid));
+    }
+
+    void add_constants(const size_t count, const wgpu::ConstantEntry *constants)
+    {
+        add(count);
+        for (size_t i = 0; i < count; ++i) {
+            add_chain(constants[i].nextInChain);
+            add_string(constants[i].key);
+            add_double(constants[i].value);
+        }
+    }
+
+    void add_stencil_face(const wgpu::StencilFaceState &face)
+    {
+        add(static_cast<uint64_t>(face.compare));
+        add(static_cast<uint64_t>(face.failOp));
+        add(static_cast<uint64_t>(face.depthFailOp));
+        add(static_cast<uint64_t>(face.passOp));
+    }
+
+    void add_blend_component(const wgpu::BlendComponent &blend)
+    {
+        add(static_cast<uint64_t>(blend.operation));
+        add(static_cast<uint64_t>(blend.srcFactor));
+        add(static_cast<uint64_t>(blend.dstFactor));
+    }
+};
+
+template <typename Map, typename Stats, typename CreateFn>
+typename Map::mapped_type lookup(Map &map,
+                                 Stats &stats,
+                                 const KeyWriter &writer,
+                                 const CreateFn &create)
+{
+    if (!writer.cacheable) {
+        ++stats.num_uncached;
+        return create();
+    }
+    auto fnd = map.find(writer.key);
+    if (fnd != map.end()) {
+        ++stats.num_hits;
+        return fnd->second;
+    }
+    ++stats.num_misses;
+    typename Map::mapped_type object = create();
+    map[writer.key] = object;
+    return object;
+}
+
+// Like lookup, but the map holds entries with the pipeline's handle and the objects
+// it references, which are stored with the handle on a miss
+template <typename Map, typename Stats, typename CreateFn>
+PipelineLoader::Handle lookup_pipeline(Map &map,
+                                       Stats &stats,
+                                       const KeyWriter &writer,
+                                       typename Map::mapped_type entry,
+                                       const CreateFn &create)
+{
+    if (!writer.cacheable) {
+        ++stats.num_uncached;
+        return create();
+    }
+    auto fnd = map.find(writer.key);
+    if (fnd != map.end()) {
+        ++stats.num_hits;
+        return fnd->second.handle;
+    }
+    ++stats.num_misses;
+    entry.handle = create();
+    map[writer.key] = entry;
+    return entry.handle;
+}
+
+template <typename Stats>
+void print_cache_stats(std::ostream &os,
+                       const char *name,
+                       const size_t size,
+                       const Stats &stats)
+{
+    os << "  " << name << ": " << size << " cached, " << stats.num_hits << " hits, "
+       << stats.num_misses << " misses";
+    if (stats.num_uncached > 0) {
+        os << ", " << stats.num_uncached << " uncached";
+    }
+    os << "\n";
+}
+
+}
+
+size_t ObjectCache::KeyHash::operator()(const Key &key) const
+{
+    uint64_t hash = key.size();
+    for (const uint64_t v : key) {
+        hash ^= v + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    }
+    return static_cast<size_t>(hash);
+}
+
+ObjectCache::ObjectCache(const wgpu::Device &device) : device(device) {}
+
+wgpu::BindGroupLayout ObjectCache::bind_group_layout(
+    const wgpu::BindGroupLayoutDescriptor &desc)
+{
+    KeyWriter writer;
+    writer.add_chain(desc.nextInChain);
+    writer.add(desc.entryCount);
+    for (size_t i = 0; i < desc.entryCount; ++i) {
+        const wgpu::BindGroupLayoutEntry &e = desc.entries[i];
+        writer.add_chain(e.nextInChain);
+        writer.add(e.binding);
+        writer.add(static_cast<uint64_t>(e.visibility));
+
+        writer.add_chain(e.buffer.nextInChain);
+        writer.add(static_cast<uint64_t>(e.buffer.type));
+        writer.add(e.buffer.hasDynamicOffset);
+        writer.add(e.buffer.minBindingSize);
+
+        writer.add_chain(e.sampler.nextInChain);
+        writer.add(static_cast<uint64_t>(e.sampler.type));
+
+        writer.add_chain(e.texture.nextInChain);
+        writer.add(static_cast<uint64_t>(e.texture.sampleType));
+        writer.add(static_cast<uint64_t>(e.texture.viewDimension));
+        writer.add(e.texture.multisampled);
+
+        writer.add_chain(e.storageTexture.nextInChain);
+        writer.add(static_cast<uint64_t>(e.storageTexture.access));
+        writer.add(static_cast<uint64_t>(e.storageTexture.format));
+        writer.add(static_cast<uint64_t>(e.storageTexture.viewDimension));
+    }
+    return lookup(bind_group_layouts, bind_group_layout_stats, writer, [&]() {
+        return device.CreateBindGroupLayout(&desc);
+    });
+}
+
+wgpu::PipelineLayout ObjectCache::pipeline_layout(const wgpu::PipelineLayoutDescriptor &desc)
+{
+    KeyWriter writer;
+    writer.add_chain(desc.nextInChain);
+    writer.add(desc.bindGroupLayoutCount);
+    for (size_t i = 0; i < desc.bindGroupLayoutCount; ++i) {
+        writer.add_object(desc.bindGroupLayouts[i]);
+    }
+    return lookup(pipeline_layouts, pipeline_layout_stats, writer, [&]() {
+        return device.CreatePipelineLayout(&desc);
+    });
+}
+
+wgpu::BindGroup ObjectCache::bind_group(const wgpu::BindGroupDescriptor &desc)
+{
+    KeyWriter writer;
+    std::vector<uint64_t> resources;
+    writer.add_chain(desc.nextInChain);
+    writer.add_object(desc.layout);
+    writer.add(desc.entryCount);
+    for (size_t i = 0; i < desc.entryCount; ++i) {
+        const wgpu::BindGroupEntry &e = desc.entries[i];
+        writer.add_chain(e.nextInChain);
+        writer.add(e.binding);
+        writer.add_object(e.buffer);
+        writer.add(e.offset);
+        writer.add(e.size);
+        writer.add_object(e.sampler);
+        writer.add_object(e.textureView);
+
+        if (e.buffer) {
+            resources.push_back(reinterpret_cast<uintptr_t>(e.buffer.Get()));
+        }
+        if (e.sampler) {
+            resources.push_back(reinterpret_cast<uintptr_t>(e.sampler.Get()));
+        }
+        if (e.textureView) {
+            resources.push_back(reinterpret_cast<uintptr_t>(e.textureView.Get()));
+        }
+    }
+
+    if (!writer.cacheable) {
+        ++bind_group_stats.num_uncached;
+        return device.CreateBindGroup(&desc);
+    }
+    auto fnd = bind_groups.find(writer.key);
+    if (fnd != bind_groups.end()) {
+        ++bind_group_stats.num_hits;
+        return fnd->second.bind_group;
+    }
+    ++bind_group_stats.num_misses;
+    BindGroupEntry &entry = bind_groups[writer.key];
+    entry.bind_group = device.CreateBindGroup(&desc);
+    entry.resources = resources;
+    return entry.bind_group;
+}
+
+PipelineLoader::Handle ObjectCache::render_pipeline(
+    PipelineLoader &loader,
+    const std::string &name,
+    const wgpu::RenderPipelineDescriptor &desc,
+    PipelineLoader::Handle fallback)
+{
+    KeyWriter writer;
+    writer.add_chain(desc.nextInChain);
+    writer.add_object(desc.layout);
+
+    const wgpu::VertexState &vertex = desc.vertex;
+    writer.add_chain(vertex.nextInChain);
+    writer.add_object(vertex.module);
+    writer.add_string(vertex.entryPoint);
+    writer.add_constants(vertex.constantCount, vertex.constants);
+    writer.add(vertex.bufferCount);
+    for (size_t i = 0; i < vertex.bufferCount; ++i) {
+        const wgpu::VertexBufferLayout &buffer = vertex.buffers[i];
+        writer.add(buffer.arrayStride);
+        writer.add(static_cast<uint64_t>(buffer.stepMode));
+        writer.add(buffer.attributeCount);
+        for (size_t j = 0; j < buffer.attributeCount; ++j) {
+            writer.add(static_cast<uint64_t>(buffer.attributes[j].format));
+            writer.add(buffer.attributes[j].offset);
+            writer.add(buffer.attributes[j].shaderLocation);
+        }
+    }
+
+    const wgpu::PrimitiveState &primitive = desc.primitive;
+    writer.add_chain(primitive.nextInChain);
+    writer.add(static_cast<uint64_t>(primitive.topology));
+    writer.add(static_cast<uint64_t>(primitive.stripIndexFormat));
+    writer.add(static_cast<uint64_t>(primitive.frontFace));
+    writer.add(static_cast<uint64_t>(primitive.cullMode));
+
+    writer.add(desc.depthStencil != nullptr);
+    if (desc.depthStencil) {
+        const wgpu::DepthStencilState &ds = *desc.depthStencil;
+        writer.add_chain(ds.nextInChain);
+        writer.add(static_cast<uint64_t>(ds.format));
+        writer.add(static_cast<uint64_t>(ds.depthWriteEnabled));
+        writer.add(static_cast<uint64_t>(ds.depthCompare));
+        writer.add_stencil_face(ds.stencilFront);
+        writer.add_stencil_face(ds.stencilBack);
+        writer.add(ds.stencilReadMask);
+        writer.add(ds.stencilWriteMask);
+        writer.add(static_cast<uint32_t>(ds.depthBias));
+        writer.add_float(ds.depthBiasSlopeScale);
+        writer.add_float(ds.depthBiasClamp);
+    }
+
+    const wgpu::MultisampleState &multisample = desc.multisample;
+    writer.add_chain(multisample.nextInChain);
+    writer.add(multisample.count);
+    writer.add(multisample.mask);
+    writer.add(multisample.alphaToCoverageEnabled);
+
+    writer.add(desc.fragment != nullptr);
+    if (desc.fragment) {
+        const wgpu::FragmentState &fragment = *desc.fragment;
+        writer.add_chain(fragment.nextInChain);
+        writer.add_object(fragment.module);
+        writer.add_string(fragment.entryPoint);
+        writer.add_constants(fragment.constantCount, fragment.constants);
+        writer.add(fragment.targetCount);
+        for (size_t i = 0; i < fragment.targetCount; ++i) {
+            const wgpu::ColorTargetState &target = fragment.targets[i];
+            writer.add_chain(target.nextInChain);
+            writer.add(static_cast<uint64_t>(target.format));
+            writer.add(static_cast<uint64_t>(target.writeMask));
+            writer.add(target.blend != nullptr);
+            if (target.blend) {
+                writer.add_blend_component(target.blend->color);
+                writer.add_blend_component(target.blend->alpha);
+            }
+        }
+    }
+    PipelineEntry entry;
+    entry.layout = desc.layout;
+    entry.modules.push_back(vertex.module);
+    if (desc.fragment) {
+        entry.modules.push_back(desc.fragment->module);
+    }
+    return lookup_pipeline(render_pipelines, render_pipeline_stats, writer, entry, [&]() {
+        return loader.create_render_pipeline(name, desc, fallback);
+    });
+}
+
+PipelineLoader::Handle ObjectCache::compute_pipeline(
+    PipelineLoader &loader,
+    const std::string &name,
+    const wgpu::ComputePipelineDescriptor &desc,
+    PipelineLoader::Handle fallback)
+{
+    KeyWriter writer;
+    writer.add_chain(desc.nextInChain);
+    writer.add_object(desc.layout);
+    writer.add_chain(desc.compute.nextInChain);
+    writer.add_object(desc.compute.module);
+    writer.add_string(desc.compute.entryPoint);
+    writer.add_constants(desc.compute.constantCount, desc.compute.constants);
+    PipelineEntry entry;
+    entry.layout = desc.layout;
+    entry.modules.push_back(desc.compute.module);
+    return lookup_pipeline(compute_pipelines, compute_pipeline_stats, writer, entry, [&]() {
+        return loader.create_compute_pipeline(name, desc, fallback);
+    });
+}
+
+void ObjectCache::release(const wgpu::Buffer &buffer)
+{
+    evict_bind_groups(reinterpret_cast<uintptr_t>(buffer.Get()));
+}
+
+void ObjectCache::release(const wgpu::TextureView &view)
+{
+    evict_bind_groups(reinterpret_cast<uintptr_t>(view.Get()));
+}
+
+void ObjectCache::release(const wgpu::Sampler &sampler)
+{
+    evict_bind_groups(reinterpret_cast<uintptr_t>(sampler.Get()));
+}
+
+void ObjectCache::clear()
+{
+    bind_group_layouts.clear();
+    pipeline_layouts.clear();
+    bind_groups.clear();
+    render_pipelines.clear();
+    compute_pipelines.clear();
+}
+
+void ObjectCache::print_stats(std::ostream &os) const
+{
+    os << "Object cache: " << num_evicted << " bind groups evicted\n";
+    print_cache_stats(
+        os, "bind group layouts", bind_group_layouts.size(), bind_group_layout_stats);
+    print_cache_stats(os, "pipeline layouts", pipeline_layouts.size(), pipeline_layout_stats);
+    print_cache_stats(os, "bind groups", bind_groups.size(), bind_group_stats);
+    print_cache_stats(os, "render pipelines", render_pipelines.size(), render_pipeline_stats);
+    print_cache_stats(
+        os, "compute pipelines", compute_pipelines.size(), compute_pipeline_stats);
+}
+
+void ObjectCache::evict_bind_groups(const uint64_t resource)
+{
+    if (resource == 0) {
+        return;
+    }
+    for (auto it = bind_groups.begin(); it != bind_groups.end();) {
+        const std::vector<uint64_t> &resources = it->second.resources;
+        if (std::find(resources.begin(), resources.end(), resource) != resources.end()) {
+            it = bind_groups.erase(it);
+            ++num_evicted;
+        } else {
+            ++it;
+        }
+    }
+}
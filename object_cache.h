@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "pipeline_loader.h"
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+/* Deduplicates bind group layouts, pipeline layouts, bind groups and pipelines
+ * created from identical descriptors. Each descriptor is flattened into a key
+ * holding every field that affects the object, following the entry arrays,
+ * nested states and chained structs, and lookups with an equal key return the
+ * existing object. Labels don't affect the object, so they're left out of the
+ * key. Pipelines are created asynchronously through a PipelineLoader and cached
+ * by their handle.
+ *
+ * Objects referenced by a descriptor (shader modules, layouts, buffers, etc.)
+ * are keyed by their handle. The cached layouts and bind groups hold a reference
+ * to each of them, and a pipeline's entry holds references to its layout and
+ * shader modules, since a pending or failed pipeline has no object to hold them.
+ * So a new object can't reuse the address while the entry exists.
+ * Descriptors with chained structs the cache doesn't know how to key are
+ * created without caching.
+ *
+ * A bind group keeps its resources alive, so when an owner is done with a
+ * buffer, texture view or sampler it should call release() to evict the bind
+ * groups that use it, otherwise the cache would keep the resource around.
+ */
+class ObjectCache {
+public:
+    using Key = std::vector<uint64_t>;
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    struct Stats {
+        uint64_t num_hits = 0;
+        uint64_t num_misses = 0;
+        // Objects whose descriptors couldn't be keyed
+        uint64_t num_uncached = 0;
+    };
+
+    struct BindGroupEntry {
+        wgpu::BindGroup bind_group;
+        // The buffers, texture views and samplers the bind group uses
+        std::vector<uint64_t> resources;
+    };
+
+    struct PipelineEntry {
+        PipelineLoader::Handle handle = PipelineLoader::INVALID_PIPELINE;
+        // The objects keyed by their handle, kept alive so their addresses aren't reused
+        wgpu::PipelineLayout layout;
+        std::vector<wgpu::ShaderModule> modules;
+    };
+
+    wgpu::Device device;
+
+    std::unordered_map<Key, wgpu::BindGroupLayout, KeyHash> bind_group_layouts;
+    std::unordered_map<Key, wgpu::PipelineLayout, KeyHash> pipeline_layouts;
+    std::unordered_map<Key, BindGroupEntry, KeyHash> bind_groups;
+    std::unordered_map<Key, PipelineEntry, KeyHash> render_pipelines;
+    std::unordered_map<Key, PipelineEntry, KeyHash> compute_pipelines;
+
+    Stats bind_group_layout_stats;
+    Stats pipeline_layout_stats;
+    Stats bind_group_stats;
+    Stats render_pipeline_stats;
+    Stats compute_pipeline_stats;
+    uint64_t num_evicted = 0;
+
+public:
+    ObjectCache() = default;
+
+    ObjectCache(const wgpu::Device &device);
+
+    wgpu::BindGroupLayout bind_group_layout(const wgpu::BindGroupLayoutDescriptor &desc);
+
+    wgpu::PipelineLayout pipeline_layout(const wgpu::PipelineLayoutDescriptor &desc);
+
+    wgpu::BindGroup bind_group(const wgpu::BindGroupDescriptor &desc);
+
+    /* Get the handle of the loader's pipeline for the descriptor, starting to
+     * create it under the name with the fallback if there's no matching pipeline yet
+     */
+    PipelineLoader::Handle render_pipeline(
+        PipelineLoader &loader,
+        const std::string &name,
+        const wgpu::RenderPipelineDescriptor &desc,
+        PipelineLoader::Handle fallback = PipelineLoader::INVALID_PIPELINE);
+
+    PipelineLoader::Handle compute_pipeline(
+        PipelineLoader &loader,
+        const std::string &name,
+        const wgpu::ComputePipelineDescriptor &desc,
+        PipelineLoader::Handle fallback = PipelineLoader::INVALID_PIPELINE);
+
+    // Evict the bind groups using the resource, call before destroying or dropping it
+    void release(const wgpu::Buffer &buffer);
+
+    void release(const wgpu::TextureView &view);
+
+    void release(const wgpu::Sampler &sampler);
+
+    // Drop all entries, e.g. when the device is recreated
+    void clear();
+
+    void print_stats(std::ostream &os) const;
+
+private:
+    void evict_bind_groups(uint64_t resource);
+};
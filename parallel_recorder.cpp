@@ -0,0 +1,115 @@
+#include "parallel_recorder.h"
+#include <algorithm>
+#include "cpu_profiler.h"
+
+ParallelRecorder::ParallelRecorder(uint32_t num_threads) : next_chunk(0)
+{
+#ifndef __EMSCRIPTEN__
+    for (uint32_t i = 1; i < num_threads; ++i) {
+        workers.emplace_back([this]() { worker_thread(); });
+    }
+#else
+    (void)num_threads;
+#endif
+}
+
+ParallelRecorder::~ParallelRecorder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    work_cv.notify_all();
+    for (auto &w : workers) {
+        w.join();
+    }
+}
+
+uint32_t ParallelRecorder::num_threads() const
+{
+    return workers.size() + 1;
+}
+
+void ParallelRecorder::record(uint32_t num_items,
+                              uint32_t num_chunks,
+                              const RecordFn &fn,
+                              std::vector<wgpu::RenderBundle> &bundles)
+{
+    num_chunks = std::max(std::min(num_chunks, num_items), 1u);
+    std::vector<wgpu::RenderBundle> chunk_bundles(num_chunks);
+    Job new_job;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job.record_fn = &fn;
+        job.num_items = num_items;
+        job.num_chunks = num_chunks;
+        job.results = &chunk_bundles;
+        next_chunk = 0;
+        chunks_done = 0;
+        ++generation;
+        new_job = job;
+    }
+    work_cv.notify_all();
+
+    // The calling thread records chunks too, then waits for the workers to finish theirs.
+    // We also wait for any workers that picked up the job but found no chunks left to
+    // leave, so none of them can touch next_chunk once the next job starts
+    record_chunks(new_job);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock,
+                     [&]() { return chunks_done == num_chunks && active_workers == 0; });
+        job = Job();
+    }
+
+    bundles.insert(bundles.end(), chunk_bundles.begin(), chunk_bundles.end());
+}
+
+void ParallelRecorder::worker_thread()
+{
+    cpu_profiler_set_thread_name("record worker");
+    uint64_t seen_generation = 0;
+    while (true) {
+        Job current_job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_cv.wait(lock, [&]() { return quit || generation != seen_generation; });
+            if (quit) {
+                return;
+            }
+            seen_generation = generation;
+            // The job may have already been finished by the other threads
+            if (!job.record_fn) {
+                continue;
+            }
+            current_job = job;
+            ++active_workers;
+        }
+        record_chunks(current_job);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --active_workers;
+        }
+        done_cv.notify_all();
+    }
+}
+
+void ParallelRecorder::record_chunks(const Job &current_job)
+{
+    const uint32_t items_per_chunk =
+        (current_job.num_items + current_job.num_chunks - 1) / current_job.num_chunks;
+    uint32_t recorded = 0;
+    for (uint32_t chunk = next_chunk++; chunk < current_job.num_chunks; chunk = next_chunk++) {
+        const uint32_t begin = std::min(chunk * items_per_chunk, current_job.num_items);
+        const uint32_t end = std::min(begin + items_per_chunk, current_job.num_items);
+        CPU_ZONE("record_chunk");
+        (*current_job.results)[chunk] = (*current_job.record_fn)(chunk, begin, end);
+        ++recorded;
+    }
+
+    if (recorded > 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        chunks_done += recorded;
+    }
+    done_cv.notify_all();
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+/* Records render bundles in parallel on a persistent pool of worker threads.
+ * The work is split into contiguous chunks, each recorded into its own render
+ * bundle, and the bundles are returned in chunk order so they can be executed
+ * in a single render pass in a deterministic order regardless of which thread
+ * recorded them. The target is then only loaded and stored once, rather than
+ * once per chunk as separate render passes would. On Emscripten there are no
+ * worker threads and chunks are recorded serially on the calling thread.
+ *
+ * Note that Dawn only allows a device to be used from multiple threads when it's
+ * created with the ImplicitDeviceSynchronization feature.
+ */
+class ParallelRecorder {
+public:
+    /* Record the render bundle for the chunk covering items [begin, end).
+     * Called concurrently from multiple threads.
+     */
+    using RecordFn =
+        std::function<wgpu::RenderBundle(uint32_t chunk, uint32_t begin, uint32_t end)>;
+
+private:
+    struct Job {
+        const RecordFn *record_fn = nullptr;
+        uint32_t num_items = 0;
+        uint32_t num_chunks = 0;
+        std::vector<wgpu::RenderBundle> *results = nullptr;
+    };
+
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    bool quit = false;
+    uint64_t generation = 0;
+
+    // The job currently being recorded, record_fn is null when there's no job
+    Job job;
+    std::atomic<uint32_t> next_chunk;
+    uint32_t chunks_done = 0;
+    // The number of workers currently recording chunks for the job
+    uint32_t active_workers = 0;
+
+public:
+    // Create a recorder using num_threads threads, including the calling thread
+    ParallelRecorder(uint32_t num_threads = 1);
+    ~ParallelRecorder();
+
+    ParallelRecorder(const ParallelRecorder &) = delete;
+    ParallelRecorder &operator=(const ParallelRecorder &) = delete;
+
+    // Get the number of threads used for recording, including the calling thread
+    uint32_t num_threads() const;
+
+    /* Split num_items into num_chunks contiguous chunks and record them in
+     * parallel, appending the render bundles to bundles in chunk order
+     */
+    void record(uint32_t num_items,
+                uint32_t num_chunks,
+                const RecordFn &fn,
+                std::vector<wgpu::RenderBundle> &bundles);
+
+private:
+    void worker_thread();
+
+    // Record chunks from the job until none are left
+    void record_chunks(const Job &current_job);
+};
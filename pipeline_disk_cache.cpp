@@ -0,0 +1,212 @@
+#include "pipeline_disk_cache.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+const char *PREWARM_LIST_FILE = "prewarm_pipelines.txt";
+
+bool make_directory(const std::string &path)
+{
+#ifdef _WIN32
+    return _mkdir(path.c_str()) == 0 || errno == EEXIST;
+#else
+    return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+uint64_t fnv1a(const void *data, const size_t size)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+}
+
+PipelineDiskCache::PipelineDiskCache(const std::string &directory) : directory(directory)
+{
+    make_directory(directory);
+    std::ifstream fin((directory + "/" + PREWARM_LIST_FILE).c_str());
+    warm = fin.good();
+}
+
+bool PipelineDiskCache::is_warm() const
+{
+    return warm;
+}
+
+std::vector<std::string> PipelineDiskCache::load_prewarm_list() const
+{
+    std::vector<std::string> names;
+    std::ifstream fin((directory + "/" + PREWARM_LIST_FILE).c_str());
+    std::string line;
+    while (std::getline(fin, line)) {
+        if (!line.empty()) {
+            names.push_back(line);
+        }
+    }
+    return names;
+}
+
+bool PipelineDiskCache::save_prewarm_list(const std::vector<std::string> &names) const
+{
+    std::ofstream fout((directory + "/" + PREWARM_LIST_FILE).c_str());
+    for (const auto &n : names) {
+        fout << n << "\n";
+    }
+    return fout.good();
+}
+
+PipelineDiskCache::Stats PipelineDiskCache::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+double PipelineDiskCache::hit_rate() const
+{
+    const Stats s = get_stats();
+    const uint64_t lookups = s.num_hits + s.num_misses;
+    return lookups > 0 ? static_cast<double>(s.num_hits) / lookups : 0.0;
+}
+
+void PipelineDiskCache::print_stats(std::ostream &os) const
+{
+    const Stats s = get_stats();
+    const double kb = 1.0 / 1024.0;
+    os << "Pipeline disk cache (" << (warm ? "warm" : "cold") << ", " << directory
+       << "): " << s.num_hits << " hits, " << s.num_misses << " misses, "
+       << hit_rate() * 100.0 << "% hit rate, " << s.bytes_loaded * kb << "KB loaded, "
+       << s.num_stores << " stores, " << s.bytes_stored * kb << "KB stored\n";
+}
+
+dawn::platform::CachingInterface *PipelineDiskCache::GetCachingInterface()
+{
+    return this;
+}
+
+size_t PipelineDiskCache::LoadData(const void *key,
+                                   size_t key_size,
+                                   void *value,
+                                   size_t value_size)
+{
+    const std::string path = blob_path(key, key_size);
+
+    // Dawn first asks for the blob's size, then loads it into a buffer of that size.
+    // The blob is read once for the size query and held until it's loaded
+    if (!value) {
+        std::vector<char> blob;
+        const bool found = read_blob(path, key, key_size, blob);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!found) {
+            ++stats.num_misses;
+            return 0;
+        }
+        ++stats.num_hits;
+        stats.bytes_loaded += blob.size();
+        const size_t size = blob.size();
+        pending_loads[path].swap(blob);
+        return size;
+    }
+
+    std::vector<char> blob;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto fnd = pending_loads.find(path);
+        if (fnd != pending_loads.end()) {
+            blob.swap(fnd->second);
+            pending_loads.erase(fnd);
+        }
+    }
+    if (blob.empty() && !read_blob(path, key, key_size, blob)) {
+        return 0;
+    }
+    const size_t size = std::min(value_size, blob.size());
+    std::memcpy(value, blob.data(), size);
+    return size;
+}
+
+void PipelineDiskCache::StoreData(const void *key,
+                                  size_t key_size,
+                                  const void *value,
+                                  size_t value_size)
+{
+    // Write to a temporary file and move it into place, so a crash or another
+    // instance loading the blob never sees a partially written file
+    const std::string path = blob_path(key, key_size);
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream fout(tmp_path.c_str(), std::ios::binary);
+        const uint64_t stored_key_size = key_size;
+        fout.write(reinterpret_cast<const char *>(&stored_key_size), sizeof(uint64_t));
+        fout.write(reinterpret_cast<const char *>(key), key_size);
+        fout.write(reinterpret_cast<const char *>(value), value_size);
+        if (!fout) {
+            std::remove(tmp_path.c_str());
+            return;
+        }
+    }
+    std::remove(path.c_str());
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ++stats.num_stores;
+    stats.bytes_stored += value_size;
+}
+
+std::string PipelineDiskCache::blob_path(const void *key, size_t key_size) const
+{
+    std::stringstream ss;
+    ss << directory << "/" << std::hex << std::setw(16) << std::setfill('0')
+       << fnv1a(key, key_size) << ".bin";
+    return ss.str();
+}
+
+bool PipelineDiskCache::read_blob(const std::string &path,
+                                  const void *key,
+                                  size_t key_size,
+                                  std::vector<char> &blob) const
+{
+    std::ifstream fin(path.c_str(), std::ios::binary | std::ios::ate);
+    if (!fin) {
+        return false;
+    }
+    const uint64_t file_size = fin.tellg();
+    fin.seekg(0);
+
+    // The file starts with the full key, so a hash collision reads as a miss
+    uint64_t stored_key_size = 0;
+    fin.read(reinterpret_cast<char *>(&stored_key_size), sizeof(uint64_t));
+    if (!fin || stored_key_size != key_size ||
+        file_size < sizeof(uint64_t) + stored_key_size) {
+        return false;
+    }
+    std::vector<char> stored_key(key_size);
+    fin.read(stored_key.data(), key_size);
+    if (!fin || std::memcmp(stored_key.data(), key, key_size) != 0) {
+        return false;
+    }
+
+    blob.resize(file_size - sizeof(uint64_t) - key_size);
+    fin.read(blob.data(), blob.size());
+    return static_cast<bool>(fin) && !blob.empty();
+}
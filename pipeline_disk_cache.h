@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <dawn/platform/DawnPlatform.h>
+
+/* A persistent cache of Dawn's compiled shader and pipeline blobs, stored as one
+ * file per blob in a directory, so later runs can skip recompiling them. Dawn
+ * queries it through the platform's caching interface, so the cache must be set
+ * as the platform of the Dawn instance (see DawnInstanceDescriptor) and outlive it.
+ * Dawn may load and store blobs from its worker threads while creating pipelines
+ * asynchronously.
+ *
+ * The cache also keeps the pre-warm list, the names of the pipelines used in the
+ * last session, so startup can begin creating them before they're needed. The
+ * cache counts as warm if a previous session saved its pre-warm list.
+ */
+class PipelineDiskCache : public dawn::platform::Platform,
+                          public dawn::platform::CachingInterface {
+public:
+    struct Stats {
+        uint64_t num_hits = 0;
+        uint64_t num_misses = 0;
+        uint64_t num_stores = 0;
+        uint64_t bytes_loaded = 0;
+        uint64_t bytes_stored = 0;
+    };
+
+private:
+    std::string directory;
+    bool warm = false;
+
+    mutable std::mutex mutex;
+    Stats stats;
+    // Blobs read when Dawn queried their size, held until Dawn loads them
+    std::unordered_map<std::string, std::vector<char>> pending_loads;
+
+public:
+    // Open the cache in the directory, creating it if needed
+    PipelineDiskCache(const std::string &directory);
+
+    // Check if a previous session populated the cache
+    bool is_warm() const;
+
+    // Get the names of the pipelines used in the last session
+    std::vector<std::string> load_prewarm_list() const;
+
+    // Replace the pre-warm list with the pipelines used this session
+    bool save_prewarm_list(const std::vector<std::string> &names) const;
+
+    Stats get_stats() const;
+
+    // Get the fraction of blob lookups that were found in the cache
+    double hit_rate() const;
+
+    void print_stats(std::ostream &os) const;
+
+    dawn::platform::CachingInterface *GetCachingInterface() override;
+
+    size_t LoadData(const void *key, size_t key_size, void *value, size_t value_size) override;
+
+    void StoreData(const void *key,
+                   size_t key_size,
+                   const void *value,
+                   size_t value_size) override;
+
+private:
+    // Get the file storing the blob for the key
+    std::string blob_path(const void *key, size_t key_size) const;
+
+    // Read the blob for the key, returns false if there's none or it's for another key
+    bool read_blob(const std::string &path,
+                   const void *key,
+                   size_t key_size,
+                   std::vector<char> &blob) const;
+};
@@ -0,0 +1,164 @@
+#include "pipeline_loader.h"
+#include <algorithm>
+#include <iostream>
+
+PipelineLoader::PipelineLoader(const wgpu::Device &device) : device(device) {}
+
+PipelineLoader::Handle PipelineLoader::create_render_pipeline(
+    const std::string &name, const wgpu::RenderPipelineDescriptor &desc, Handle fallback)
+{
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+    entry->name = name;
+    entry->fallback = fallback;
+    entry->start_time = Clock::now();
+    entries.push_back(entry);
+
+    // The callback owns a reference to the entry until it's called
+    device.CreateRenderPipelineAsync(
+        &desc, render_callback, new std::shared_ptr<Entry>(entry));
+    return entries.size() - 1;
+}
+
+PipelineLoader::Handle PipelineLoader::create_compute_pipeline(
+    const std::string &name, const wgpu::ComputePipelineDescriptor &desc, Handle fallback)
+{
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+    entry->name = name;
+    entry->fallback = fallback;
+    entry->start_time = Clock::now();
+    entries.push_back(entry);
+
+    device.CreateComputePipelineAsync(
+        &desc, compute_callback, new std::shared_ptr<Entry>(entry));
+    return entries.size() - 1;
+}
+
+PipelineLoader::Status PipelineLoader::status(Handle pipeline) const
+{
+    if (pipeline >= entries.size()) {
+        return Status::FAILED;
+    }
+    return entries[pipeline]->status;
+}
+
+bool PipelineLoader::is_ready(Handle pipeline) const
+{
+    return status(pipeline) == Status::READY;
+}
+
+const wgpu::RenderPipeline *PipelineLoader::render_pipeline(Handle pipeline) const
+{
+    const Entry *entry = ready_entry(pipeline);
+    return entry && entry->render_pipeline ? &entry->render_pipeline : nullptr;
+}
+
+const wgpu::ComputePipeline *PipelineLoader::compute_pipeline(Handle pipeline) const
+{
+    const Entry *entry = ready_entry(pipeline);
+    return entry && entry->compute_pipeline ? &entry->compute_pipeline : nullptr;
+}
+
+uint32_t PipelineLoader::num_pending() const
+{
+    uint32_t pending = 0;
+    for (const auto &e : entries) {
+        if (e->status == Status::PENDING) {
+            ++pending;
+        }
+    }
+    return pending;
+}
+
+std::vector<std::string> PipelineLoader::ready_names() const
+{
+    std::vector<std::string> names;
+    for (const auto &e : entries) {
+        // Rebuilt pipelines have an entry for each version
+        if (e->status == Status::READY &&
+            std::find(names.begin(), names.end(), e->name) == names.end()) {
+            names.push_back(e->name);
+        }
+    }
+    return names;
+}
+
+void PipelineLoader::print_stats(std::ostream &os) const
+{
+    os << "Pipelines: " << entries.size() << " created, " << num_pending() << " pending\n";
+    for (const auto &e : entries) {
+        os << "  " << e->name << ": ";
+        switch (e->status) {
+        case Status::PENDING:
+            os << "pending\n";
+            break;
+        case Status::READY:
+            os << "ready in " << e->create_ms << "ms\n";
+            break;
+        case Status::FAILED:
+            os << "failed after " << e->create_ms << "ms\n";
+            break;
+        }
+    }
+}
+
+const PipelineLoader::Entry *PipelineLoader::ready_entry(Handle pipeline) const
+{
+    if (pipeline >= entries.size()) {
+        return nullptr;
+    }
+    // Follow the fallbacks until one is ready, e.g. a pipeline rebuilt several
+    // times falls back to the last version that compiled. Fallbacks are always
+    // created before the pipelines using them, so the chain can't loop
+    const Entry *entry = entries[pipeline].get();
+    while (entry->status != Status::READY) {
+        if (entry->fallback >= entries.size()) {
+            return nullptr;
+        }
+        entry = entries[entry->fallback].get();
+    }
+    return entry;
+}
+
+void PipelineLoader::render_callback(WGPUCreatePipelineAsyncStatus status,
+                                     WGPURenderPipeline pipeline,
+                                     const char *message,
+                                     void *user_data)
+{
+    std::unique_ptr<std::shared_ptr<Entry>> entry(
+        reinterpret_cast<std::shared_ptr<Entry> *>(user_data));
+    // Take ownership even on failure, where we may be given an error pipeline
+    wgpu::RenderPipeline result = wgpu::RenderPipeline::Acquire(pipeline);
+    if (finish(entry->get(), status, message)) {
+        (*entry)->render_pipeline = result;
+    }
+}
+
+void PipelineLoader::compute_callback(WGPUCreatePipelineAsyncStatus status,
+                                      WGPUComputePipeline pipeline,
+                                      const char *message,
+                                      void *user_data)
+{
+    std::unique_ptr<std::shared_ptr<Entry>> entry(
+        reinterpret_cast<std::shared_ptr<Entry> *>(user_data));
+    // Take ownership even on failure, where we may be given an error pipeline
+    wgpu::ComputePipeline result = wgpu::ComputePipeline::Acquire(pipeline);
+    if (finish(entry->get(), status, message)) {
+        (*entry)->compute_pipeline = result;
+    }
+}
+
+bool PipelineLoader::finish(Entry *entry,
+                            WGPUCreatePipelineAsyncStatus status,
+                            const char *message)
+{
+    entry->create_ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - entry->start_time).count();
+    if (status != WGPUCreatePipelineAsyncStatus_Success) {
+        std::cout << "Failed to create pipeline " << entry->name << ": "
+                  << (message ? message : "unknown error") << "\n";
+        entry->status = Status::FAILED;
+        return false;
+    }
+    entry->status = Status::READY;
+    return true;
+}
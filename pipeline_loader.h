@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+/* Creates render and compute pipelines asynchronously with
+ * Device::Create{Render,Compute}PipelineAsync, so compiling them doesn't hold up
+ * startup or the first frame. Pipelines are referred to by handle, and until a
+ * pipeline is ready users can either skip the work that needs it or draw with a
+ * fallback pipeline given when it was created. The callbacks run during
+ * Instance::ProcessEvents on native and from the browser's event loop on
+ * Emscripten, so the loader is only used from the main thread.
+ */
+class PipelineLoader {
+public:
+    using Handle = uint32_t;
+
+    static const Handle INVALID_PIPELINE = ~0u;
+
+    enum class Status { PENDING, READY, FAILED };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string name;
+        Status status = Status::PENDING;
+        wgpu::RenderPipeline render_pipeline;
+        wgpu::ComputePipeline compute_pipeline;
+        Handle fallback = INVALID_PIPELINE;
+        Clock::time_point start_time;
+        // Time from requesting the pipeline to its callback
+        double create_ms = 0.0;
+    };
+
+    wgpu::Device device;
+    // Entries are shared with the pending callbacks, which may outlive the loader
+    std::vector<std::shared_ptr<Entry>> entries;
+
+public:
+    PipelineLoader() = default;
+
+    PipelineLoader(const wgpu::Device &device);
+
+    /* Start creating a render pipeline. While it's pending or if it fails,
+     * render_pipeline returns the fallback instead, or the fallback's fallback if
+     * that's not ready either, and so on.
+     */
+    Handle create_render_pipeline(const std::string &name,
+                                  const wgpu::RenderPipelineDescriptor &desc,
+                                  Handle fallback = INVALID_PIPELINE);
+
+    Handle create_compute_pipeline(const std::string &name,
+                                   const wgpu::ComputePipelineDescriptor &desc,
+                                   Handle fallback = INVALID_PIPELINE);
+
+    Status status(Handle pipeline) const;
+
+    bool is_ready(Handle pipeline) const;
+
+    /* Get the pipeline if it's ready, otherwise the first ready one along its
+     * fallbacks. Returns null if none is, in which case the work should be skipped.
+     */
+    const wgpu::RenderPipeline *render_pipeline(Handle pipeline) const;
+
+    const wgpu::ComputePipeline *compute_pipeline(Handle pipeline) const;
+
+    // Get the number of pipelines still being created
+    uint32_t num_pending() const;
+
+    // Get the names of the pipelines created successfully so far
+    std::vector<std::string> ready_names() const;
+
+    // Print the status and creation time of each pipeline
+    void print_stats(std::ostream &os) const;
+
+private:
+    const Entry *ready_entry(Handle pipeline) const;
+
+    static void render_callback(WGPUCreatePipelineAsyncStatus status,
+                                WGPURenderPipeline pipeline,
+                                const char *message,
+                                void *user_data);
+
+    static void compute_callback(WGPUCreatePipelineAsyncStatus status,
+                                 WGPUComputePipeline pipeline,
+                                 const char *message,
+                                 void *user_data);
+
+    // Record the result of creating the entry's pipeline, returns false if it failed
+    static bool finish(Entry *entry,
+                       WGPUCreatePipelineAsyncStatus status,
+                       const char *message);
+};
@@ -0,0 +1,125 @@
+#include "readback_ring.h"
+#include <algorithm>
+#include <iterator>
+#include "gpu_memory_tracker.h"
+
+ReadbackRing::ReadbackRing(const wgpu::Instance &instance,
+                           const wgpu::Device &device,
+                           uint64_t size,
+                           uint32_t num_buffers,
+                           const std::string &label)
+    : instance(instance)
+{
+    wgpu::BufferDescriptor buffer_desc;
+    buffer_desc.size = size;
+    buffer_desc.usage = wgpu::BufferUsage::MapRead | wgpu::BufferUsage::CopyDst;
+    for (uint32_t i = 0; i < std::max(num_buffers, 1u); ++i) {
+        std::unique_ptr<Readback> r(new Readback);
+        r->buffer = gpu_memory_create_buffer(device, buffer_desc, label.c_str());
+        readbacks.push_back(std::move(r));
+    }
+}
+
+bool ReadbackRing::begin_frame()
+{
+    current = nullptr;
+    auto fnd = std::find_if(readbacks.begin(),
+                            readbacks.end(),
+                            [](const std::unique_ptr<Readback> &r) { return !r->in_flight; });
+    if (fnd != readbacks.end()) {
+        current = fnd->get();
+        current->frame = frame_index;
+        current_index = std::distance(readbacks.begin(), fnd);
+    }
+    ++frame_index;
+    return current != nullptr;
+}
+
+uint32_t ReadbackRing::index() const
+{
+    return current_index;
+}
+
+wgpu::Buffer ReadbackRing::buffer() const
+{
+    return current ? current->buffer : wgpu::Buffer();
+}
+
+void ReadbackRing::end_frame(uint64_t size)
+{
+    if (!current) {
+        return;
+    }
+    Readback *r = current;
+    current = nullptr;
+    r->size = size;
+    r->in_flight = true;
+    r->mapped = false;
+
+#ifdef __EMSCRIPTEN__
+    r->buffer.MapAsync(
+        wgpu::MapMode::Read,
+        0,
+        size,
+        [](WGPUBufferMapAsyncStatus status, void *user_data) {
+            Readback *readback = reinterpret_cast<Readback *>(user_data);
+            // If the map failed the frame's results are dropped
+            readback->mapped = status == WGPUBufferMapAsyncStatus_Success;
+            readback->in_flight = readback->mapped;
+        },
+        r);
+#else
+    wgpu::BufferMapCallbackInfo callback_info;
+    callback_info.mode = wgpu::CallbackMode::WaitAnyOnly;
+    callback_info.callback = [](WGPUBufferMapAsyncStatus status, void *user_data) {
+        Readback *readback = reinterpret_cast<Readback *>(user_data);
+        // If the map failed the frame's results are dropped
+        readback->mapped = status == WGPUBufferMapAsyncStatus_Success;
+        readback->in_flight = readback->mapped;
+    };
+    callback_info.userdata = r;
+    r->future = r->buffer.MapAsyncF(wgpu::MapMode::Read, 0, size, callback_info);
+#endif
+}
+
+void ReadbackRing::collect(const CollectFn &fn)
+{
+#ifndef __EMSCRIPTEN__
+    // Poll the pending readbacks without blocking, the callbacks are only invoked
+    // from within WaitAny since they use CallbackMode::WaitAnyOnly
+    for (auto &r : readbacks) {
+        if (r->in_flight && !r->mapped) {
+            wgpu::FutureWaitInfo wait_info;
+            wait_info.future = r->future;
+            instance.WaitAny(1, &wait_info, 0);
+        }
+    }
+#endif
+
+    // Readbacks can complete together, so process them oldest first to leave the
+    // most recent frame's results last
+    std::vector<uint32_t> completed;
+    for (uint32_t i = 0; i < readbacks.size(); ++i) {
+        if (readbacks[i]->mapped) {
+            completed.push_back(i);
+        }
+    }
+    std::sort(completed.begin(), completed.end(), [&](const uint32_t a, const uint32_t b) {
+        return readbacks[a]->frame < readbacks[b]->frame;
+    });
+
+    for (const uint32_t i : completed) {
+        Readback *r = readbacks[i].get();
+        fn(i, r->frame, r->buffer.GetConstMappedRange(0, r->size));
+        r->buffer.Unmap();
+        r->mapped = false;
+        r->in_flight = false;
+    }
+}
+
+void ReadbackRing::release()
+{
+    for (auto &r : readbacks) {
+        gpu_memory_release(r->buffer);
+    }
+}
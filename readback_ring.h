@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+/* A small ring of MapRead buffers for reading back per-frame results from the GPU
+ * without waiting on it. begin_frame() picks a free buffer for the frame, the
+ * frame's commands copy the results into buffer(), and end_frame() maps it
+ * asynchronously after Queue::Submit. collect() polls the pending maps without
+ * blocking and passes each completed frame's data to a callback, oldest first,
+ * before unmapping the buffer for reuse. If every buffer is still pending the
+ * frame isn't read back.
+ */
+class ReadbackRing {
+public:
+    /* Called with the index of the frame's buffer in the ring, the frame number,
+     * and the mapped data, which is only valid during the call
+     */
+    using CollectFn =
+        std::function<void(uint32_t index, uint64_t frame, const void *data)>;
+
+private:
+    struct Readback {
+        wgpu::Buffer buffer;
+        uint64_t frame = 0;
+        uint64_t size = 0;
+        // Set while the readback is pending, and once it's mapped
+        bool in_flight = false;
+        bool mapped = false;
+#ifndef __EMSCRIPTEN__
+        wgpu::Future future;
+#endif
+    };
+
+    wgpu::Instance instance;
+    // Readbacks are heap allocated so the pointers passed to the callbacks stay valid
+    std::vector<std::unique_ptr<Readback>> readbacks;
+    Readback *current = nullptr;
+    uint32_t current_index = 0;
+    uint64_t frame_index = 0;
+
+public:
+    ReadbackRing() = default;
+
+    // Create num_buffers readback buffers of size bytes, labeled for the memory tracker
+    ReadbackRing(const wgpu::Instance &instance,
+                 const wgpu::Device &device,
+                 uint64_t size,
+                 uint32_t num_buffers,
+                 const std::string &label);
+
+    /* Pick a free buffer for the next frame, returns false if they're all still
+     * pending, in which case the frame isn't read back
+     */
+    bool begin_frame();
+
+    // Get the index in the ring of the frame's buffer, only valid if it has one
+    uint32_t index() const;
+
+    // Get the buffer to copy the frame's results into, null if the frame has none
+    wgpu::Buffer buffer() const;
+
+    // Start mapping the first size bytes of the frame's buffer, call after Queue::Submit
+    void end_frame(uint64_t size);
+
+    // Pass the data of each readback that has completed to the callback, oldest first
+    void collect(const CollectFn &fn);
+
+    // Release the buffers from the GPU memory tracker
+    void release();
+};
@@ -0,0 +1,53 @@
+#include "render_bundle_cache.h"
+
+RenderBundleCache::RenderBundleCache(const wgpu::Device &device,
+                                     wgpu::TextureFormat color_format,
+                                     wgpu::TextureFormat depth_format)
+    : device(device), color_format(color_format), depth_format(depth_format)
+{
+}
+
+const wgpu::RenderBundle &RenderBundleCache::get(const std::string &name,
+                                                 const std::vector<uint64_t> &dependencies,
+                                                 const RecordFn &record)
+{
+    auto fnd = entries.find(name);
+    if (fnd != entries.end() && fnd->second.dependencies == dependencies) {
+        ++num_hits;
+        return fnd->second.bundle;
+    }
+    ++num_misses;
+
+    wgpu::RenderBundleEncoderDescriptor bundle_desc;
+    bundle_desc.label = name.c_str();
+    bundle_desc.colorFormatCount = 1;
+    bundle_desc.colorFormats = &color_format;
+    bundle_desc.depthStencilFormat = depth_format;
+
+    wgpu::RenderBundleEncoder bundle_enc = device.CreateRenderBundleEncoder(&bundle_desc);
+    record(bundle_enc);
+
+    wgpu::RenderBundleDescriptor finish_desc;
+    finish_desc.label = name.c_str();
+
+    Entry &entry = entries[name];
+    entry.dependencies = dependencies;
+    entry.bundle = bundle_enc.Finish(&finish_desc);
+    return entry.bundle;
+}
+
+void RenderBundleCache::invalidate(const std::string &name)
+{
+    entries.erase(name);
+}
+
+void RenderBundleCache::clear()
+{
+    entries.clear();
+}
+
+void RenderBundleCache::print_stats(std::ostream &os) const
+{
+    os << "Render bundle cache: " << entries.size() << " bundles, " << num_hits
+       << " hits, " << num_misses << " misses\n";
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+// Get a key identifying a WebGPU object to use as a render bundle dependency
+template <typename T>
+uint64_t bundle_dependency(const T &object)
+{
+    return reinterpret_cast<uintptr_t>(object.Get());
+}
+
+/* Caches render bundles for static draw sequences so they're recorded once and
+ * then replayed with RenderPassEncoder::ExecuteBundles. Each entry stores the list of
+ * dependencies it was recorded with (the pipelines, buffers and bind groups it uses,
+ * along with any other values baked into the commands, e.g. the draw count), and is
+ * only re-recorded when these change.
+ *
+ * Objects are identified by their handle, which is safe against a new object
+ * reusing a destroyed object's address since the cached bundle holds a reference
+ * to each object it uses, keeping them alive until the entry is re-recorded.
+ */
+class RenderBundleCache {
+public:
+    using RecordFn = std::function<void(const wgpu::RenderBundleEncoder &)>;
+
+private:
+    struct Entry {
+        std::vector<uint64_t> dependencies;
+        wgpu::RenderBundle bundle;
+    };
+
+    wgpu::Device device;
+    wgpu::TextureFormat color_format = wgpu::TextureFormat::Undefined;
+    wgpu::TextureFormat depth_format = wgpu::TextureFormat::Undefined;
+    std::unordered_map<std::string, Entry> entries;
+
+    uint64_t num_hits = 0;
+    uint64_t num_misses = 0;
+
+public:
+    RenderBundleCache() = default;
+
+    /* Create a cache for bundles executed in render passes with the color and
+     * optional depth attachment formats
+     */
+    RenderBundleCache(const wgpu::Device &device,
+                      wgpu::TextureFormat color_format,
+                      wgpu::TextureFormat depth_format = wgpu::TextureFormat::Undefined);
+
+    /* Get the bundle for the name, recording it with record if there's no entry
+     * for the name yet or the dependencies have changed since it was recorded
+     */
+    const wgpu::RenderBundle &get(const std::string &name,
+                                  const std::vector<uint64_t> &dependencies,
+                                  const RecordFn &record);
+
+    // Drop the entry for the name so it's recorded again on the next get
+    void invalidate(const std::string &name);
+
+    // Drop all entries, e.g. when the attachment formats change
+    void clear();
+
+    void print_stats(std::ostream &os) const;
+};
@@ -0,0 +1,409 @@
+#include "render_graph.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include "gpu_memory_tracker.h"
+
+// Pooled textures not used for this many frames are released
+static const uint64_t POOL_EVICT_FRAMES = 8;
+
+static bool same_texture(const RenderGraphTextureDesc &a,
+                         wgpu::TextureUsage a_usage,
+                         const RenderGraphTextureDesc &b,
+                         wgpu::TextureUsage b_usage)
+{
+    return a.format == b.format && a.width == b.width && a.height == b.height &&
+           a_usage == b_usage;
+}
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph *graph, size_t pass)
+    : graph(graph), pass(pass)
+{
+}
+
+void RenderGraph::PassBuilder::read(RenderGraphResource resource)
+{
+    graph->passes[pass].reads.push_back(resource);
+    // Buffers are only tracked for dependencies, their usage is up to their owner
+    Resource &r = graph->resources[resource];
+    if (!r.is_buffer) {
+        r.usage |= wgpu::TextureUsage::TextureBinding;
+    }
+}
+
+void RenderGraph::PassBuilder::write(RenderGraphResource resource)
+{
+    graph->passes[pass].writes.push_back(resource);
+    Resource &r = graph->resources[resource];
+    if (!r.is_buffer) {
+        r.usage |= wgpu::TextureUsage::StorageBinding;
+    }
+}
+
+void RenderGraph::PassBuilder::write_color(RenderGraphResource texture)
+{
+    wgpu::Color clear_color;
+    clear_color.r = 0.0;
+    clear_color.g = 0.0;
+    clear_color.b = 0.0;
+    clear_color.a = 1.0;
+    write_color(texture, clear_color);
+}
+
+void RenderGraph::PassBuilder::write_color(RenderGraphResource texture,
+                                           const wgpu::Color &clear_color)
+{
+    Attachment attachment;
+    attachment.resource = texture;
+    attachment.clear_color = clear_color;
+    graph->passes[pass].color_attachments.push_back(attachment);
+    graph->resources[texture].usage |= wgpu::TextureUsage::RenderAttachment;
+}
+
+void RenderGraph::PassBuilder::write_depth(RenderGraphResource texture, float clear_depth)
+{
+    Pass &p = graph->passes[pass];
+    p.has_depth = true;
+    p.depth_attachment.resource = texture;
+    p.depth_attachment.clear_depth = clear_depth;
+    graph->resources[texture].usage |= wgpu::TextureUsage::RenderAttachment;
+}
+
+void RenderGraph::PassBuilder::side_effect()
+{
+    graph->passes[pass].side_effect = true;
+}
+
+RenderGraph::RenderGraph(const wgpu::Device &device) : device(device) {}
+
+void RenderGraph::reset()
+{
+    resources.clear();
+    passes.clear();
+    compiled = false;
+    ++frame;
+
+    // Release textures that haven't been needed in a while, e.g. after a resize
+    auto evicted =
+        std::stable_partition(pool.begin(), pool.end(), [&](const PooledTexture &t) {
+            return frame - t.last_used_frame <= POOL_EVICT_FRAMES;
+        });
+    for (auto it = evicted; it != pool.end(); ++it) {
+        gpu_memory_release(it->texture);
+    }
+    pool.erase(evicted, pool.end());
+}
+
+RenderGraphResource RenderGraph::import_texture(const std::string &name,
+                                                const wgpu::TextureView &view,
+                                                bool output,
+                                                bool clear)
+{
+    Resource r;
+    r.name = name;
+    r.imported = true;
+    r.output = output;
+    r.clear = clear;
+    r.view = view;
+    return add_resource(r);
+}
+
+RenderGraphResource RenderGraph::import_buffer(const std::string &name, bool output)
+{
+    Resource r;
+    r.name = name;
+    r.imported = true;
+    r.is_buffer = true;
+    r.output = output;
+    return add_resource(r);
+}
+
+RenderGraphResource RenderGraph::create_texture(const std::string &name,
+                                                const RenderGraphTextureDesc &desc)
+{
+    Resource r;
+    r.name = name;
+    r.desc = desc;
+    r.usage = desc.usage;
+    return add_resource(r);
+}
+
+void RenderGraph::add_render_pass(const std::string &name,
+                                  const SetupFn &setup,
+                                  const RenderFn &execute)
+{
+    Pass p;
+    p.name = name;
+    p.render = execute;
+    passes.push_back(p);
+
+    PassBuilder builder(this, passes.size() - 1);
+    setup(builder);
+}
+
+void RenderGraph::add_compute_pass(const std::string &name,
+                                   const SetupFn &setup,
+                                   const ComputeFn &execute)
+{
+    Pass p;
+    p.name = name;
+    p.is_compute = true;
+    p.compute = execute;
+    passes.push_back(p);
+
+    PassBuilder builder(this, passes.size() - 1);
+    setup(builder);
+}
+
+void RenderGraph::compile()
+{
+    cull_passes();
+
+    // Find the lifetime of each resource over the passes that will run
+    for (size_t i = 0; i < passes.size(); ++i) {
+        Pass &p = passes[i];
+        if (p.culled) {
+            continue;
+        }
+        std::vector<RenderGraphResource> used = p.reads;
+        used.insert(used.end(), p.writes.begin(), p.writes.end());
+        for (const auto &a : p.color_attachments) {
+            used.push_back(a.resource);
+        }
+        if (p.has_depth) {
+            used.push_back(p.depth_attachment.resource);
+        }
+        for (const auto &u : used) {
+            Resource &r = resources[u];
+            if (!r.used) {
+                r.used = true;
+                r.first_pass = i;
+            }
+            r.last_pass = i;
+        }
+    }
+
+    // The first writer of an attachment clears it and all later ones load it, except
+    // imported textures keep their contents unless the importer asked for a clear.
+    // We only store the result if a later pass uses it or it lives outside of the graph
+    for (size_t i = 0; i < passes.size(); ++i) {
+        Pass &p = passes[i];
+        if (p.culled) {
+            continue;
+        }
+        std::vector<Attachment *> attachments;
+        for (auto &a : p.color_attachments) {
+            attachments.push_back(&a);
+        }
+        if (p.has_depth) {
+            attachments.push_back(&p.depth_attachment);
+        }
+        for (auto *a : attachments) {
+            const Resource &r = resources[a->resource];
+            const bool clear = r.first_pass == i && (!r.imported || r.clear);
+            a->load_op = clear ? wgpu::LoadOp::Clear : wgpu::LoadOp::Load;
+            a->store_op = r.last_pass > i || r.imported ? wgpu::StoreOp::Store
+                                                        : wgpu::StoreOp::Discard;
+        }
+    }
+
+    assign_textures();
+    compiled = true;
+}
+
+void RenderGraph::execute(const wgpu::CommandEncoder &encoder)
+{
+    if (!compiled) {
+        throw std::runtime_error("RenderGraph must be compiled before execution");
+    }
+
+    for (const auto &p : passes) {
+        if (p.culled) {
+            continue;
+        }
+
+        if (p.is_compute) {
+            wgpu::ComputePassDescriptor pass_desc;
+            pass_desc.label = p.name.c_str();
+            wgpu::ComputePassEncoder pass_enc = encoder.BeginComputePass(&pass_desc);
+            p.compute(*this, pass_enc);
+            pass_enc.End();
+            continue;
+        }
+
+        std::vector<wgpu::RenderPassColorAttachment> color_attachments;
+        for (const auto &a : p.color_attachments) {
+            wgpu::RenderPassColorAttachment color_attachment;
+            color_attachment.view = texture_view(a.resource);
+            color_attachment.clearValue = a.clear_color;
+            color_attachment.loadOp = a.load_op;
+            color_attachment.storeOp = a.store_op;
+            color_attachments.push_back(color_attachment);
+        }
+
+        wgpu::RenderPassDepthStencilAttachment depth_attachment;
+        if (p.has_depth) {
+            const Attachment &a = p.depth_attachment;
+            depth_attachment.view = texture_view(a.resource);
+            depth_attachment.depthClearValue = a.clear_depth;
+            depth_attachment.depthLoadOp = a.load_op;
+            depth_attachment.depthStoreOp = a.store_op;
+        }
+
+        wgpu::RenderPassDescriptor pass_desc;
+        pass_desc.label = p.name.c_str();
+        pass_desc.colorAttachmentCount = color_attachments.size();
+        pass_desc.colorAttachments = color_attachments.data();
+        if (p.has_depth) {
+            pass_desc.depthStencilAttachment = &depth_attachment;
+        }
+
+        wgpu::RenderPassEncoder pass_enc = encoder.BeginRenderPass(&pass_desc);
+        p.render(*this, pass_enc);
+        pass_enc.End();
+    }
+}
+
+const wgpu::TextureView &RenderGraph::texture_view(RenderGraphResource texture) const
+{
+    const Resource &r = resources[texture];
+    if (r.imported) {
+        return r.view;
+    }
+    if (r.pooled < 0) {
+        throw std::runtime_error("RenderGraph texture " + r.name + " was not allocated");
+    }
+    return pool[r.pooled].view;
+}
+
+void RenderGraph::print_stats(std::ostream &os) const
+{
+    os << "Render graph: " << pool.size() << " pooled textures, " << num_textures_created
+       << " textures created, " << num_culled << " passes culled in the last frame\n";
+}
+
+RenderGraphResource RenderGraph::add_resource(const Resource &resource)
+{
+    resources.push_back(resource);
+    return resources.size() - 1;
+}
+
+void RenderGraph::cull_passes()
+{
+    // Walk the passes back to front, a pass is needed if it writes something
+    // needed by a later pass or the graph's outputs. Anything a needed pass
+    // uses is then needed by the passes before it, including the attachments
+    // it writes since it loads their previous contents.
+    std::vector<bool> needed(resources.size(), false);
+    for (size_t i = 0; i < resources.size(); ++i) {
+        needed[i] = resources[i].output;
+    }
+
+    num_culled = 0;
+    for (auto p = passes.rbegin(); p != passes.rend(); ++p) {
+        std::vector<RenderGraphResource> written = p->writes;
+        for (const auto &a : p->color_attachments) {
+            written.push_back(a.resource);
+        }
+        if (p->has_depth) {
+            written.push_back(p->depth_attachment.resource);
+        }
+
+        p->culled = !p->side_effect;
+        for (const auto &w : written) {
+            if (needed[w]) {
+                p->culled = false;
+                break;
+            }
+        }
+        if (p->culled) {
+            ++num_culled;
+            continue;
+        }
+
+        for (const auto &r : p->reads) {
+            needed[r] = true;
+        }
+        for (const auto &w : written) {
+            needed[w] = true;
+        }
+    }
+}
+
+void RenderGraph::assign_textures()
+{
+    for (auto &t : pool) {
+        t.busy_until = -1;
+    }
+
+    // Assign textures in order of first use so each pooled texture can be handed
+    // to the next resource once the previous one's last pass has run
+    std::vector<RenderGraphResource> transients;
+    for (size_t i = 0; i < resources.size(); ++i) {
+        if (!resources[i].imported && resources[i].used) {
+            transients.push_back(i);
+        }
+    }
+    std::sort(transients.begin(),
+              transients.end(),
+              [&](const RenderGraphResource &a, const RenderGraphResource &b) {
+                  return resources[a].first_pass < resources[b].first_pass;
+              });
+
+    // Pooled textures that no resource in this frame can use, e.g. ones sized for
+    // the window before a resize. Their slots are reused when we need to create a
+    // texture, so the pool doesn't grow while the window is being resized
+    std::vector<bool> stale(pool.size(), true);
+    for (size_t i = 0; i < pool.size(); ++i) {
+        for (const auto &id : transients) {
+            const Resource &r = resources[id];
+            if (same_texture(pool[i].desc, pool[i].usage, r.desc, r.usage)) {
+                stale[i] = false;
+                break;
+            }
+        }
+    }
+
+    for (const auto &id : transients) {
+        Resource &r = resources[id];
+        for (size_t i = 0; i < pool.size(); ++i) {
+            PooledTexture &t = pool[i];
+            if (t.busy_until < int64_t(r.first_pass) &&
+                same_texture(t.desc, t.usage, r.desc, r.usage)) {
+                r.pooled = i;
+                break;
+            }
+        }
+
+        if (r.pooled < 0) {
+            PooledTexture t;
+            t.desc = r.desc;
+            t.usage = r.usage;
+
+            wgpu::TextureDescriptor texture_desc;
+            texture_desc.label = r.name.c_str();
+            texture_desc.format = r.desc.format;
+            texture_desc.size.width = r.desc.width;
+            texture_desc.size.height = r.desc.height;
+            texture_desc.usage = r.usage;
+            t.texture = gpu_memory_create_texture(device, texture_desc, r.name.c_str());
+            t.view = t.texture.CreateView();
+
+            ++num_textures_created;
+            auto fnd = std::find(stale.begin(), stale.end(), true);
+            if (fnd != stale.end()) {
+                *fnd = false;
+                r.pooled = std::distance(stale.begin(), fnd);
+                gpu_memory_release(pool[r.pooled].texture);
+                pool[r.pooled] = t;
+            } else {
+                pool.push_back(t);
+                r.pooled = pool.size() - 1;
+            }
+        }
+
+        PooledTexture &t = pool[r.pooled];
+        t.busy_until = r.last_pass;
+        t.last_used_frame = frame;
+    }
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+using RenderGraphResource = uint32_t;
+
+struct RenderGraphTextureDesc {
+    wgpu::TextureFormat format = wgpu::TextureFormat::Undefined;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Usages needed beyond those implied by how the passes use the texture
+    wgpu::TextureUsage usage = wgpu::TextureUsage::None;
+};
+
+/* A per-frame graph of render and compute passes. Passes declare the resources
+ * they read and write when they're added, and compile() then works out which
+ * passes contribute to the graph's outputs and culls the rest. It also derives the
+ * attachment load/store ops, so an attachment is only cleared by its first writer and
+ * only stored if a later pass uses it, and assigns the transient textures to
+ * textures from a pool that persists across frames. WebGPU doesn't expose memory
+ * aliasing directly, so transient textures with the same description whose
+ * lifetimes don't overlap share the same pooled texture instead.
+ *
+ * Usage each frame is reset(), declare resources and add passes, compile(), then
+ * execute() to record the passes into a command encoder.
+ */
+class RenderGraph {
+public:
+    class PassBuilder {
+        RenderGraph *graph = nullptr;
+        size_t pass = 0;
+
+    public:
+        PassBuilder(RenderGraph *graph, size_t pass);
+
+        // The pass samples or otherwise reads the resource
+        void read(RenderGraphResource resource);
+
+        // The pass writes the resource outside of a render attachment, e.g. as storage
+        void write(RenderGraphResource resource);
+
+        /* The pass renders to the texture as a color attachment, it's cleared to
+         * clear_color if this is the first pass writing it (opaque black by default),
+         * unless it's an imported texture that wasn't imported to be cleared
+         */
+        void write_color(RenderGraphResource texture);
+        void write_color(RenderGraphResource texture, const wgpu::Color &clear_color);
+
+        // The pass renders to the texture as its depth attachment
+        void write_depth(RenderGraphResource texture, float clear_depth = 1.f);
+
+        // Mark the pass as having effects outside the graph so it's never culled
+        void side_effect();
+    };
+
+    using SetupFn = std::function<void(PassBuilder &)>;
+    using RenderFn = std::function<void(const RenderGraph &, const wgpu::RenderPassEncoder &)>;
+    using ComputeFn =
+        std::function<void(const RenderGraph &, const wgpu::ComputePassEncoder &)>;
+
+private:
+    struct Resource {
+        std::string name;
+        bool imported = false;
+        bool is_buffer = false;
+        bool output = false;
+        // Set if the first pass writing an imported texture should clear it
+        bool clear = false;
+        RenderGraphTextureDesc desc;
+        wgpu::TextureUsage usage = wgpu::TextureUsage::None;
+        wgpu::TextureView view;
+        bool used = false;
+        size_t first_pass = 0;
+        size_t last_pass = 0;
+        int32_t pooled = -1;
+    };
+
+    struct Attachment {
+        RenderGraphResource resource = 0;
+        wgpu::Color clear_color;
+        float clear_depth = 1.f;
+        wgpu::LoadOp load_op = wgpu::LoadOp::Clear;
+        wgpu::StoreOp store_op = wgpu::StoreOp::Store;
+    };
+
+    struct Pass {
+        std::string name;
+        bool is_compute = false;
+        RenderFn render;
+        ComputeFn compute;
+        std::vector<RenderGraphResource> reads;
+        std::vector<RenderGraphResource> writes;
+        std::vector<Attachment> color_attachments;
+        bool has_depth = false;
+        Attachment depth_attachment;
+        bool side_effect = false;
+        bool culled = false;
+    };
+
+    struct PooledTexture {
+        RenderGraphTextureDesc desc;
+        wgpu::TextureUsage usage = wgpu::TextureUsage::None;
+        wgpu::Texture texture;
+        wgpu::TextureView view;
+        uint64_t last_used_frame = 0;
+        // The last pass using the texture in the frame being compiled
+        int64_t busy_until = -1;
+    };
+
+    wgpu::Device device;
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<PooledTexture> pool;
+    uint64_t frame = 0;
+    bool compiled = false;
+
+    uint32_t num_culled = 0;
+    uint64_t num_textures_created = 0;
+
+public:
+    RenderGraph() = default;
+
+    RenderGraph(const wgpu::Device &device);
+
+    // Clear the passes and resources for a new frame, pooled textures are kept
+    void reset();
+
+    /* Import an externally owned texture, e.g. the swap chain image. Outputs are
+     * the roots that passes must contribute to in order not to be culled. The
+     * first pass writing it loads its contents, or clears it if clear is set.
+     */
+    RenderGraphResource import_texture(const std::string &name,
+                                       const wgpu::TextureView &view,
+                                       bool output,
+                                       bool clear = false);
+
+    /* Import an externally owned buffer, this is only used to track dependencies
+     * between passes reading and writing it
+     */
+    RenderGraphResource import_buffer(const std::string &name, bool output);
+
+    // Declare a transient texture that only lives for the frame
+    RenderGraphResource create_texture(const std::string &name,
+                                       const RenderGraphTextureDesc &desc);
+
+    void add_render_pass(const std::string &name, const SetupFn &setup, const RenderFn &execute);
+
+    void add_compute_pass(const std::string &name,
+                          const SetupFn &setup,
+                          const ComputeFn &execute);
+
+    // Cull unused passes, derive load/store ops and assign pooled textures
+    void compile();
+
+    // Record the passes remaining after culling into the encoder
+    void execute(const wgpu::CommandEncoder &encoder);
+
+    // Get the view of a texture resource, valid once the graph is compiled
+    const wgpu::TextureView &texture_view(RenderGraphResource texture) const;
+
+    void print_stats(std::ostream &os) const;
+
+private:
+    RenderGraphResource add_resource(const Resource &resource);
+
+    void cull_passes();
+
+    void assign_textures();
+};
@@ -0,0 +1,1022 @@
+#include "renderer.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "cpu_profiler.h"
+#include "embedded_shaders.h"
+#include "gpu_memory_tracker.h"
+#include <glm/ext.hpp>
+
+namespace {
+
+const char *SCENE_SHADER_FILE = "scene.wgsl";
+const char *CLUSTER_CULL_SHADER_FILE = "cluster_cull.wgsl";
+const char *CLUSTER_CULL_PIPELINE = "cluster_cull";
+const char *RESET_DRAWS_PIPELINE = "cull_reset_draws";
+const char *CULL_COMPACT_PIPELINE = "cull_compact";
+
+// Read the shader file from the renderer's shader directory, or use the embedded
+// copy if there's no directory or the file can't be read
+std::string load_shader_source(const Renderer *renderer,
+                               const std::string &file,
+                               const char *embedded)
+{
+    if (!renderer->shader_dir.empty()) {
+        std::ifstream fin((renderer->shader_dir + "/" + file).c_str());
+        std::stringstream source;
+        source << fin.rdbuf();
+        if (fin && !source.str().empty()) {
+            return source.str();
+        }
+        std::cout << "Failed to read " << renderer->shader_dir << "/" << file
+                  << ", using the embedded copy\n";
+    }
+    return embedded;
+}
+
+wgpu::ShaderModule create_shader_module(Renderer *renderer,
+                                        const std::string &source,
+                                        const std::string &file)
+{
+    CPU_ZONE("create_shader_module");
+    renderer->errors.push_scope("create_shader_module " + file);
+    wgpu::ShaderModuleWGSLDescriptor shader_module_wgsl;
+    shader_module_wgsl.code = source.c_str();
+
+    wgpu::ShaderModuleDescriptor shader_module_desc;
+    shader_module_desc.nextInChain = &shader_module_wgsl;
+    shader_module_desc.label = file.c_str();
+    wgpu::ShaderModule module = renderer->device.CreateShaderModule(&shader_module_desc);
+    renderer->errors.pop_scope();
+    return module;
+}
+
+// How the scene's draws are issued, see choose_scene_draws
+enum class DrawMode {
+    // Draw the whole mesh for each object
+    PER_OBJECT,
+    // Draw each object's meshlets with the indirect arguments the cluster culling wrote
+    PER_CLUSTER,
+    // Draw the visible objects the culling compacted with an instanced indirect draw
+    // per meshlet
+    COMPACTED
+};
+
+struct SceneDraws {
+    DrawMode mode = DrawMode::PER_OBJECT;
+    // The culler and the pipelines culling the frame, unless drawing per object
+    ClusterCuller *culler = nullptr;
+    const wgpu::ComputePipeline *cull_pipeline = nullptr;
+    const wgpu::ComputePipeline *reset_pipeline = nullptr;
+};
+
+// Get the number of draw calls the scene is drawn with
+uint64_t count_draw_calls(const SceneDraws &draws, const uint64_t num_objects)
+{
+    switch (draws.mode) {
+    case DrawMode::PER_CLUSTER:
+        return num_objects * draws.culler->meshlet_count();
+    case DrawMode::COMPACTED:
+        return draws.culler->meshlet_count();
+    default:
+        return num_objects;
+    }
+}
+
+// Record the culling of the scene's draws into the compute pass
+void dispatch_culling(const SceneDraws &draws, const wgpu::ComputePassEncoder &pass_enc)
+{
+    if (draws.mode == DrawMode::COMPACTED) {
+        draws.culler->dispatch_compacted(
+            pass_enc, *draws.reset_pipeline, *draws.cull_pipeline);
+    } else {
+        draws.culler->dispatch(pass_enc, *draws.cull_pipeline);
+    }
+}
+
+// Draw each object with the indirect arguments of its meshlets written by the
+// cluster culling when drawing per cluster, otherwise draw the whole mesh
+template <typename Encoder>
+void record_draws(const Renderer *renderer,
+                  const wgpu::RenderPipeline &pipeline,
+                  const Encoder &enc,
+                  const std::vector<uint32_t> &draw_offsets,
+                  const uint32_t begin,
+                  const uint32_t end,
+                  const SceneDraws &draws)
+{
+    const Mesh &mesh = renderer->mesh;
+    enc.SetPipeline(pipeline);
+    enc.SetVertexBuffer(0, mesh.vertex_buf);
+    if (mesh.index_buf) {
+        enc.SetIndexBuffer(mesh.index_buf, wgpu::IndexFormat::Uint32);
+    }
+    enc.SetBindGroup(0, renderer->bind_group);
+    for (uint32_t i = begin; i < end; ++i) {
+        enc.SetBindGroup(1, renderer->draw_params.bind_group(), 1, &draw_offsets[i]);
+        if (draws.mode == DrawMode::PER_CLUSTER) {
+            const uint64_t num_meshlets = draws.culler->meshlet_count();
+            const uint64_t first_draw = i * num_meshlets;
+            for (uint64_t m = 0; m < num_meshlets; ++m) {
+                enc.DrawIndexedIndirect(draws.culler->draw_args(),
+                                        (first_draw + m) * ClusterCuller::DRAW_ARGS_STRIDE);
+            }
+        } else if (mesh.index_buf) {
+            enc.DrawIndexed(mesh.num_indices);
+        } else {
+            enc.Draw(mesh.num_vertices);
+        }
+    }
+}
+
+// Draw the visible objects the culling compacted, with an instanced indirect draw
+// per meshlet reading the meshlet's list of objects
+template <typename Encoder>
+void record_compacted_draws(const Renderer *renderer,
+                            const wgpu::RenderPipeline &pipeline,
+                            const Encoder &enc,
+                            const ClusterCuller &culler)
+{
+    const Mesh &mesh = renderer->mesh;
+    enc.SetPipeline(pipeline);
+    enc.SetVertexBuffer(0, mesh.vertex_buf);
+    enc.SetIndexBuffer(mesh.index_buf, wgpu::IndexFormat::Uint32);
+    enc.SetBindGroup(0, renderer->bind_group);
+    for (uint32_t m = 0; m < culler.meshlet_count(); ++m) {
+        const uint32_t offset = culler.instance_offset(m);
+        enc.SetBindGroup(1, culler.draw_bind_group(), 1, &offset);
+        enc.DrawIndexedIndirect(culler.compacted_draws(), m * ClusterCuller::DRAW_ARGS_STRIDE);
+    }
+}
+
+void record_scene(Renderer *renderer,
+                  const wgpu::RenderPassEncoder &render_pass_enc,
+                  const std::vector<uint32_t> &draw_offsets,
+                  const uint32_t begin,
+                  const uint32_t end,
+                  const SceneDraws &draws)
+{
+    // Skip the draws until the pipeline is ready, the pass still clears the target
+    const bool compacted = draws.mode == DrawMode::COMPACTED;
+    const wgpu::RenderPipeline *pipeline = renderer->pipelines.render_pipeline(
+        compacted ? renderer->scene_instanced_pipeline : renderer->scene_pipeline);
+    if (!pipeline) {
+        return;
+    }
+
+    if (renderer->use_bundles && begin == 0 && end == draw_offsets.size()) {
+        // The draws only change if the pipeline, buffers, bind groups or number of
+        // objects change, so we can record them once and replay them each frame.
+        // The culled draws read their arguments from the GPU, so they can be too
+        const std::vector<uint64_t> dependencies = {
+            bundle_dependency(*pipeline),
+            bundle_dependency(renderer->mesh.vertex_buf),
+            bundle_dependency(renderer->mesh.index_buf),
+            bundle_dependency(renderer->bind_group),
+            bundle_dependency(renderer->draw_params.bind_group()),
+            bundle_dependency(draws.culler ? draws.culler->draw_args() : wgpu::Buffer()),
+            bundle_dependency(draws.culler ? draws.culler->compacted_draws() : wgpu::Buffer()),
+            draw_offsets.size(),
+            static_cast<uint64_t>(draws.mode)};
+        const wgpu::RenderBundle &bundle = renderer->bundle_cache.get(
+            "scene", dependencies, [&](const wgpu::RenderBundleEncoder &bundle_enc) {
+                if (compacted) {
+                    record_compacted_draws(renderer, *pipeline, bundle_enc, *draws.culler);
+                } else {
+                    record_draws(
+                        renderer, *pipeline, bundle_enc, draw_offsets, begin, end, draws);
+                }
+            });
+        render_pass_enc.ExecuteBundles(1, &bundle);
+    } else if (compacted) {
+        record_compacted_draws(renderer, *pipeline, render_pass_enc, *draws.culler);
+    } else {
+        record_draws(renderer, *pipeline, render_pass_enc, draw_offsets, begin, end, draws);
+    }
+}
+
+// Encode a render pass clearing the target and executing the bundles in order
+void encode_draw_pass(const wgpu::CommandEncoder &encoder,
+                      const wgpu::TextureView &target,
+                      const std::vector<wgpu::RenderBundle> &bundles)
+{
+    wgpu::RenderPassColorAttachment color_attachment;
+    color_attachment.view = target;
+    color_attachment.clearValue.r = 0.f;
+    color_attachment.clearValue.g = 0.f;
+    color_attachment.clearValue.b = 0.f;
+    color_attachment.clearValue.a = 1.f;
+    color_attachment.loadOp = wgpu::LoadOp::Clear;
+    color_attachment.storeOp = wgpu::StoreOp::Store;
+
+    wgpu::RenderPassDescriptor pass_desc;
+    pass_desc.colorAttachmentCount = 1;
+    pass_desc.colorAttachments = &color_attachment;
+
+    wgpu::RenderPassEncoder render_pass_enc = encoder.BeginRenderPass(&pass_desc);
+    if (!bundles.empty()) {
+        render_pass_enc.ExecuteBundles(bundles.size(), bundles.data());
+    }
+    render_pass_enc.End();
+}
+
+void record_draws_parallel(Renderer *renderer,
+                           const wgpu::CommandEncoder &encoder,
+                           const wgpu::TextureView &target,
+                           const std::vector<uint32_t> &draw_offsets,
+                           const SceneDraws &draws)
+{
+    // Each thread records its chunk of the draws into a render bundle, which are
+    // executed in chunk order in one render pass. Skip the draws until the
+    // pipeline is ready, the pass still clears the target
+    std::vector<wgpu::RenderBundle> bundles;
+    const wgpu::RenderPipeline *pipeline =
+        renderer->pipelines.render_pipeline(renderer->scene_pipeline);
+    if (pipeline) {
+        const ParallelRecorder::RecordFn record_chunk =
+            [&](uint32_t, uint32_t begin, uint32_t end) -> wgpu::RenderBundle {
+                wgpu::RenderBundleEncoderDescriptor bundle_desc;
+                bundle_desc.colorFormatCount = 1;
+                bundle_desc.colorFormats = &renderer->color_format;
+
+                wgpu::RenderBundleEncoder bundle_enc =
+                    renderer->device.CreateRenderBundleEncoder(&bundle_desc);
+                record_draws(
+                    renderer, *pipeline, bundle_enc, draw_offsets, begin, end, draws);
+                return bundle_enc.Finish();
+            };
+        renderer->recorder->record(
+            draw_offsets.size(), renderer->recorder->num_threads(), record_chunk, bundles);
+    }
+    encode_draw_pass(encoder, target, bundles);
+}
+
+// Start creating the pipeline for the scene shader variant, or get the existing
+// one if the renderer already created it. The instanced pipeline draws the
+// compacted GPU driven draws
+PipelineLoader::Handle create_scene_pipeline(
+    Renderer *renderer,
+    const ShaderVariants::Key variant,
+    const bool instanced,
+    const PipelineLoader::Handle fallback = PipelineLoader::INVALID_PIPELINE)
+{
+    const ShaderVariants &variants =
+        instanced ? renderer->scene_instanced_variants : renderer->scene_variants;
+    const std::vector<wgpu::ConstantEntry> vertex_constants =
+        variants.constants(variant, wgpu::ShaderStage::Vertex);
+    const std::vector<wgpu::ConstantEntry> fragment_constants =
+        variants.constants(variant, wgpu::ShaderStage::Fragment);
+
+    // The layout follows the mesh's vertex format, the vertex fetch unpacks the
+    // quantized attributes to floats for the shader
+    const VertexFormat &format = renderer->mesh.format;
+    const std::vector<wgpu::VertexAttribute> vertex_attributes = format.attributes();
+
+    wgpu::VertexBufferLayout vertex_buf_layout;
+    vertex_buf_layout.arrayStride = format.stride;
+    vertex_buf_layout.attributeCount = vertex_attributes.size();
+    vertex_buf_layout.attributes = vertex_attributes.data();
+
+    wgpu::VertexState vertex_state;
+    vertex_state.module = renderer->shader_module;
+    // Every input the entry point declares must be in the layout
+    if (instanced) {
+        vertex_state.entryPoint =
+            format.has_normals() ? "vertex_main_normals_instanced" : "vertex_main_instanced";
+    } else {
+        vertex_state.entryPoint = format.has_normals() ? "vertex_main_normals" : "vertex_main";
+    }
+    vertex_state.constantCount = vertex_constants.size();
+    vertex_state.constants = vertex_constants.data();
+    vertex_state.bufferCount = 1;
+    vertex_state.buffers = &vertex_buf_layout;
+
+    wgpu::ColorTargetState render_target_state;
+    render_target_state.format = renderer->color_format;
+
+    wgpu::FragmentState fragment_state;
+    fragment_state.module = renderer->shader_module;
+    fragment_state.entryPoint = "fragment_main";
+    fragment_state.constantCount = fragment_constants.size();
+    fragment_state.constants = fragment_constants.data();
+    fragment_state.targetCount = 1;
+    fragment_state.targets = &render_target_state;
+
+    wgpu::RenderPipelineDescriptor render_pipeline_desc;
+    render_pipeline_desc.vertex = vertex_state;
+    render_pipeline_desc.fragment = &fragment_state;
+    render_pipeline_desc.layout = instanced ? renderer->scene_instanced_pipeline_layout
+                                            : renderer->scene_pipeline_layout;
+    // The default primitive state draws the mesh's indexed triangle list. The cone test
+    // culls the meshlets facing away from the camera, so meshes with meshlets cull
+    // back faces too, with or without cluster culling, and look the same either way.
+    // Meshes without meshlets, like the triangle, are drawn from both sides
+    if (renderer->mesh.num_meshlets > 0) {
+        render_pipeline_desc.primitive.frontFace = wgpu::FrontFace::CCW;
+        render_pipeline_desc.primitive.cullMode = wgpu::CullMode::Back;
+    }
+
+    return renderer->object_cache.render_pipeline(
+        renderer->pipelines, variants.name(variant), render_pipeline_desc, fallback);
+}
+
+PipelineLoader::Handle scene_variant_pipeline(Renderer *renderer,
+                                              const ShaderVariants::Key variant,
+                                              const bool instanced)
+{
+    ShaderVariants &variants =
+        instanced ? renderer->scene_instanced_variants : renderer->scene_variants;
+    return variants.pipeline(variant, [&](ShaderVariants::Key key) {
+        return create_scene_pipeline(renderer, key, instanced);
+    });
+}
+
+// Start creating a culling pipeline running the entry point of the culling shader,
+// or get the existing one. Returns INVALID_PIPELINE if the culler it's for is
+// disabled: the cluster culler for CLUSTER_CULL_PIPELINE, otherwise either culler
+PipelineLoader::Handle create_cull_pipeline(
+    Renderer *renderer,
+    const char *name,
+    const PipelineLoader::Handle fallback = PipelineLoader::INVALID_PIPELINE)
+{
+    const bool per_cluster = std::strcmp(name, CLUSTER_CULL_PIPELINE) == 0;
+    const ClusterCuller &culler = (renderer->cluster_culler.is_enabled() || per_cluster)
+                                      ? renderer->cluster_culler
+                                      : renderer->object_culler;
+    if (!culler.is_enabled()) {
+        return PipelineLoader::INVALID_PIPELINE;
+    }
+    // Both cullers' bind group layouts are created from the same entries, so the
+    // pipelines can bind either culler's bind group
+    wgpu::PipelineLayoutDescriptor pipeline_layout_desc = {};
+    pipeline_layout_desc.bindGroupLayoutCount = 1;
+    pipeline_layout_desc.bindGroupLayouts = &culler.bind_group_layout();
+
+    wgpu::ComputePipelineDescriptor compute_pipeline_desc;
+    compute_pipeline_desc.layout =
+        renderer->object_cache.pipeline_layout(pipeline_layout_desc);
+    compute_pipeline_desc.compute.module = renderer->cluster_cull_module;
+    if (per_cluster) {
+        compute_pipeline_desc.compute.entryPoint = "cull_clusters";
+    } else if (std::strcmp(name, RESET_DRAWS_PIPELINE) == 0) {
+        compute_pipeline_desc.compute.entryPoint = "reset_draws";
+    } else {
+        compute_pipeline_desc.compute.entryPoint = "cull_compact";
+    }
+
+    return renderer->object_cache.compute_pipeline(
+        renderer->pipelines, name, compute_pipeline_desc, fallback);
+}
+
+// Start creating the culling pipelines for the renderer's cullers, each falling
+// back to the pipeline it replaces
+void create_cull_pipelines(Renderer *renderer)
+{
+    renderer->cluster_cull_pipeline =
+        create_cull_pipeline(renderer, CLUSTER_CULL_PIPELINE, renderer->cluster_cull_pipeline);
+    renderer->reset_draws_pipeline =
+        create_cull_pipeline(renderer, RESET_DRAWS_PIPELINE, renderer->reset_draws_pipeline);
+    renderer->cull_compact_pipeline =
+        create_cull_pipeline(renderer, CULL_COMPACT_PIPELINE, renderer->cull_compact_pipeline);
+}
+
+// Pick how the frame's scene is drawn. Each object is drawn on its own until the
+// pipelines for the GPU driven draws or the cluster culling are ready
+SceneDraws choose_scene_draws(Renderer *renderer)
+{
+    PipelineLoader &pipelines = renderer->pipelines;
+    SceneDraws draws;
+    if (renderer->gpu_driven) {
+        const bool cull_clusters =
+            renderer->cluster_culling && renderer->cluster_culler.is_enabled();
+        ClusterCuller &culler =
+            cull_clusters ? renderer->cluster_culler : renderer->object_culler;
+        draws.reset_pipeline = pipelines.compute_pipeline(renderer->reset_draws_pipeline);
+        draws.cull_pipeline = pipelines.compute_pipeline(renderer->cull_compact_pipeline);
+        if (culler.is_enabled() && draws.reset_pipeline && draws.cull_pipeline &&
+            pipelines.render_pipeline(renderer->scene_instanced_pipeline)) {
+            draws.mode = DrawMode::COMPACTED;
+            draws.culler = &culler;
+            return draws;
+        }
+    }
+    draws = SceneDraws();
+    if (renderer->cluster_culling && renderer->cluster_culler.is_enabled()) {
+        draws.cull_pipeline = pipelines.compute_pipeline(renderer->cluster_cull_pipeline);
+        if (draws.cull_pipeline) {
+            draws.mode = DrawMode::PER_CLUSTER;
+            draws.culler = &renderer->cluster_culler;
+        }
+    }
+    return draws;
+}
+
+// Start creating the pipeline with the name, returns INVALID_PIPELINE if the
+// renderer doesn't have a pipeline by that name
+PipelineLoader::Handle create_named_pipeline(Renderer *renderer, const std::string &name)
+{
+    ShaderVariants::Key variant = 0;
+    if (renderer->scene_variants.parse_name(name, variant)) {
+        return scene_variant_pipeline(renderer, variant, false);
+    }
+    if (renderer->scene_instanced_variants.parse_name(name, variant)) {
+        return scene_variant_pipeline(renderer, variant, true);
+    }
+    for (const char *cull_pipeline :
+         {CLUSTER_CULL_PIPELINE, RESET_DRAWS_PIPELINE, CULL_COMPACT_PIPELINE}) {
+        if (name == cull_pipeline) {
+            return create_cull_pipeline(renderer, cull_pipeline);
+        }
+    }
+    return PipelineLoader::INVALID_PIPELINE;
+}
+
+}
+
+#ifndef __EMSCRIPTEN__
+dawn::native::Adapter request_adapter(dawn::native::Instance &instance,
+                                      const wgpu::BackendType backend_type,
+                                      const bool cpu_only)
+{
+    // The fallback adapter is only returned if requested, e.g., SwiftShader for Vulkan
+    wgpu::RequestAdapterOptions options;
+    options.backendType = backend_type;
+    options.forceFallbackAdapter = cpu_only;
+    std::vector<dawn::native::Adapter> adapters = instance.EnumerateAdapters(&options);
+    for (const auto &a : adapters) {
+        wgpu::AdapterProperties props;
+        a.GetProperties(&props);
+        std::cerr << "Adapter name: " << props.name
+                  << ", driver desc: " << props.driverDescription << "\n";
+        if (props.backendType == backend_type &&
+            (!cpu_only || props.adapterType == wgpu::AdapterType::CPU)) {
+            return a;
+        }
+    }
+    throw std::runtime_error("No suitable adapter found!");
+}
+
+wgpu::Device create_device(dawn::native::Adapter &adapter, const bool multithreaded)
+{
+    // The procs must be set before making any calls through the C++ API
+    DawnProcTable procs(dawn::native::GetProcs());
+    dawnProcSetProcs(&procs);
+
+    // Dawn only allows using a device from multiple threads when implicit device
+    // synchronization is enabled, so we need it for multi-threaded recording
+    std::vector<wgpu::FeatureName> required_features;
+    wgpu::Adapter wgpu_adapter(adapter.Get());
+    if (multithreaded &&
+        wgpu_adapter.HasFeature(wgpu::FeatureName::ImplicitDeviceSynchronization)) {
+        required_features.push_back(wgpu::FeatureName::ImplicitDeviceSynchronization);
+    }
+
+    // Timestamp queries are used by the GPU profiler when available. Writing
+    // timestamps directly on the command encoder is not part of the standard API,
+    // so Dawn needs unsafe APIs allowed to use it
+    const char *allow_unsafe_apis = "allow_unsafe_apis";
+    wgpu::DawnTogglesDescriptor toggles;
+    if (wgpu_adapter.HasFeature(wgpu::FeatureName::TimestampQuery)) {
+        required_features.push_back(wgpu::FeatureName::TimestampQuery);
+        toggles.enabledToggleCount = 1;
+        toggles.enabledToggles = &allow_unsafe_apis;
+    }
+
+    // Large meshes need buffers past the default 256MB limit, and the cluster
+    // culling binds storage buffers past the default 128MB for many objects, so
+    // ask for as much as the adapter supports
+    wgpu::SupportedLimits adapter_limits;
+    wgpu::RequiredLimits required_limits;
+    if (wgpu_adapter.GetLimits(&adapter_limits)) {
+        required_limits.limits.maxBufferSize = adapter_limits.limits.maxBufferSize;
+        required_limits.limits.maxStorageBufferBindingSize =
+            adapter_limits.limits.maxStorageBufferBindingSize;
+    }
+
+    wgpu::DeviceDescriptor device_desc;
+    device_desc.nextInChain = &toggles;
+    device_desc.requiredFeatureCount = required_features.size();
+    device_desc.requiredFeatures = required_features.data();
+    device_desc.requiredLimits = &required_limits;
+
+    return wgpu::Device::Acquire(adapter.CreateDevice(&device_desc));
+}
+#endif
+
+void create_scene(Renderer *renderer,
+                  const wgpu::TextureFormat color_format,
+                  const uint32_t num_objects)
+{
+    renderer->color_format = color_format;
+    renderer->bundle_cache = RenderBundleCache(renderer->device, color_format);
+
+    {
+        const std::string source =
+            load_shader_source(renderer, SCENE_SHADER_FILE, EMBEDDED_SCENE_WGSL);
+        renderer->shader_module = create_shader_module(renderer, source, SCENE_SHADER_FILE);
+
+        // TODO: Status always seems to be success even when there are errors?
+        // Unimplemented on Emscripten? Did the name change?
+        /*
+        renderer->shader_module.GetCompilationInfo(
+            [](WGPUCompilationInfoRequestStatus status,
+               WGPUCompilationInfo const *info,
+               void *) {
+                if (info->messageCount != 0) {
+                    std::cout << "Shader compilation info:\n";
+                    for (uint32_t i = 0; i < info->messageCount; ++i) {
+                        const auto &m = info->messages[i];
+                        std::cout << m.lineNum << ":" << m.linePos << ": ";
+                        switch (m.type) {
+                        case WGPUCompilationMessageType_Error:
+                            std::cout << "error";
+                            break;
+                        case WGPUCompilationMessageType_Warning:
+                            std::cout << "warning";
+                            break;
+                        case WGPUCompilationMessageType_Info:
+                            std::cout << "info";
+                            break;
+                        case WGPUCompilationMessageType_Force32:
+                            std::cout << "force32";
+                            break;
+                        default:
+                            break;
+                        }
+
+                        std::cout << ": " << m.message << "\n";
+                    }
+                }
+            },
+            nullptr);
+            */
+    }
+
+    // Upload vertex data, unless a mesh was loaded
+    if (!renderer->mesh.vertex_buf) {
+        CPU_ZONE("upload_vertices");
+        renderer->errors.push_scope("upload_vertices");
+        renderer->mesh = create_triangle_mesh(renderer->device, renderer->vertex_error_bounds);
+        renderer->errors.pop_scope();
+    }
+
+    CPU_ZONE_BEGIN(pipeline_zone, "create_pipeline");
+    renderer->errors.push_scope("create_pipeline");
+    // The view params and the mesh's dequantization params
+    std::array<wgpu::BindGroupLayoutEntry, 2> view_params_layout_entries = {};
+    for (uint32_t i = 0; i < view_params_layout_entries.size(); ++i) {
+        view_params_layout_entries[i].binding = i;
+        view_params_layout_entries[i].buffer.hasDynamicOffset = false;
+        view_params_layout_entries[i].buffer.type = wgpu::BufferBindingType::Uniform;
+        view_params_layout_entries[i].visibility = wgpu::ShaderStage::Vertex;
+    }
+
+    wgpu::BindGroupLayoutDescriptor view_params_bg_layout_desc = {};
+    view_params_bg_layout_desc.entryCount = view_params_layout_entries.size();
+    view_params_bg_layout_desc.entries = view_params_layout_entries.data();
+
+    wgpu::BindGroupLayout view_params_bg_layout =
+        renderer->object_cache.bind_group_layout(view_params_bg_layout_desc);
+
+    renderer->draw_params =
+        UniformArena(renderer->device, 16 * sizeof(float), wgpu::ShaderStage::Vertex);
+
+    std::array<wgpu::BindGroupLayout, 2> bg_layouts = {
+        view_params_bg_layout, renderer->draw_params.bind_group_layout()};
+
+    wgpu::PipelineLayoutDescriptor pipeline_layout_desc = {};
+    pipeline_layout_desc.bindGroupLayoutCount = bg_layouts.size();
+    pipeline_layout_desc.bindGroupLayouts = bg_layouts.data();
+
+    renderer->scene_pipeline_layout =
+        renderer->object_cache.pipeline_layout(pipeline_layout_desc);
+
+    // The GPU driven draws read the object transforms and the draw's instances from
+    // storage instead of the draw params, the instances bound at each meshlet's list
+    std::array<wgpu::BindGroupLayoutEntry, 2> instanced_layout_entries = {};
+    for (uint32_t i = 0; i < instanced_layout_entries.size(); ++i) {
+        instanced_layout_entries[i].binding = i + 1;
+        instanced_layout_entries[i].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+        instanced_layout_entries[i].visibility = wgpu::ShaderStage::Vertex;
+    }
+    instanced_layout_entries[1].buffer.hasDynamicOffset = true;
+
+    wgpu::BindGroupLayoutDescriptor instanced_layout_desc = {};
+    instanced_layout_desc.entryCount = instanced_layout_entries.size();
+    instanced_layout_desc.entries = instanced_layout_entries.data();
+    renderer->instanced_draw_layout =
+        renderer->object_cache.bind_group_layout(instanced_layout_desc);
+
+    bg_layouts[1] = renderer->instanced_draw_layout;
+    renderer->scene_instanced_pipeline_layout =
+        renderer->object_cache.pipeline_layout(pipeline_layout_desc);
+
+    // Compiled in the background, the first frames are drawn without the scene
+    // until it's ready
+    renderer->scene_pipeline =
+        scene_variant_pipeline(renderer, renderer->scene_variant, false);
+    renderer->scene_instanced_pipeline =
+        scene_variant_pipeline(renderer, renderer->scene_variant, true);
+    renderer->errors.pop_scope();
+    CPU_ZONE_END(pipeline_zone);
+
+    // Create the UBO for our bind group
+    CPU_ZONE_BEGIN(bind_group_zone, "create_bind_group");
+    renderer->errors.push_scope("create_bind_group");
+    wgpu::BufferDescriptor ubo_buffer_desc;
+    ubo_buffer_desc.mappedAtCreation = false;
+    ubo_buffer_desc.size = 16 * sizeof(float);
+    ubo_buffer_desc.usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::CopyDst;
+    // Recreating the scene replaces the buffer, drop the cached bind group using it
+    if (renderer->view_param_buf) {
+        renderer->object_cache.release(renderer->view_param_buf);
+        gpu_memory_release(renderer->view_param_buf);
+    }
+    renderer->view_param_buf =
+        gpu_memory_create_buffer(renderer->device, ubo_buffer_desc, "view_params");
+
+    // The position_scale and position_bias float4s to dequantize the mesh's positions
+    const VertexFormat &format = renderer->mesh.format;
+    const std::array<float, 8> mesh_params = {format.position_scale.x,
+                                              format.position_scale.y,
+                                              format.position_scale.z,
+                                              0.f,
+                                              format.position_bias.x,
+                                              format.position_bias.y,
+                                              format.position_bias.z,
+                                              0.f};
+    wgpu::BufferDescriptor mesh_params_desc;
+    mesh_params_desc.mappedAtCreation = true;
+    mesh_params_desc.size = sizeof(mesh_params);
+    mesh_params_desc.usage = wgpu::BufferUsage::Uniform;
+    if (renderer->mesh_param_buf) {
+        renderer->object_cache.release(renderer->mesh_param_buf);
+        gpu_memory_release(renderer->mesh_param_buf);
+    }
+    renderer->mesh_param_buf =
+        gpu_memory_create_buffer(renderer->device, mesh_params_desc, "mesh_params");
+    std::memcpy(
+        renderer->mesh_param_buf.GetMappedRange(), mesh_params.data(), sizeof(mesh_params));
+    renderer->mesh_param_buf.Unmap();
+
+    std::array<wgpu::BindGroupEntry, 2> view_params_bg_entries = {};
+    view_params_bg_entries[0].binding = 0;
+    view_params_bg_entries[0].buffer = renderer->view_param_buf;
+    view_params_bg_entries[0].size = ubo_buffer_desc.size;
+
+    view_params_bg_entries[1].binding = 1;
+    view_params_bg_entries[1].buffer = renderer->mesh_param_buf;
+    view_params_bg_entries[1].size = mesh_params_desc.size;
+
+    wgpu::BindGroupDescriptor bind_group_desc = {};
+    bind_group_desc.layout = view_params_bg_layout;
+    bind_group_desc.entryCount = view_params_bg_entries.size();
+    bind_group_desc.entries = view_params_bg_entries.data();
+
+    renderer->bind_group = renderer->object_cache.bind_group(bind_group_desc);
+    renderer->errors.pop_scope();
+    CPU_ZONE_END(bind_group_zone);
+
+    // Lay the objects out on a square grid filling the [-1, 1] region the single
+    // triangle would cover. The mesh is centered and scaled to fit in [-1, 1] first,
+    // which leaves the triangle as is
+    const Mesh &mesh = renderer->mesh;
+    const glm::vec3 extent = mesh.bounds_max - mesh.bounds_min;
+    const float mesh_radius = std::max(0.5f * std::max(extent.x, std::max(extent.y, extent.z)),
+                                       std::numeric_limits<float>::min());
+    const glm::mat4 fit_mesh =
+        glm::translate(glm::scale(glm::mat4(1.f), glm::vec3(1.f / mesh_radius)),
+                       -0.5f * (mesh.bounds_min + mesh.bounds_max));
+
+    const uint32_t grid_dim = std::ceil(std::sqrt(static_cast<float>(num_objects)));
+    const float cell_size = 2.f / grid_dim;
+    renderer->object_transforms.clear();
+    for (uint32_t i = 0; i < num_objects; ++i) {
+        const glm::vec3 pos(-1.f + cell_size * (i % grid_dim + 0.5f),
+                            -1.f + cell_size * (i / grid_dim + 0.5f),
+                            0.f);
+        renderer->object_transforms.push_back(
+            glm::scale(glm::translate(glm::mat4(1.f), pos), glm::vec3(0.5f * cell_size)) *
+            fit_mesh);
+    }
+
+    // The objects don't move, so their transforms are uploaded once for the culling
+    // and the GPU driven draws
+    CPU_ZONE_BEGIN(cull_zone, "create_cullers");
+    renderer->errors.push_scope("create_cullers");
+    wgpu::BufferDescriptor object_buf_desc;
+    object_buf_desc.mappedAtCreation = true;
+    object_buf_desc.size = std::max(num_objects, 1u) * sizeof(glm::mat4);
+    object_buf_desc.usage = wgpu::BufferUsage::Storage;
+    gpu_memory_release(renderer->object_buf);
+    renderer->object_buf =
+        gpu_memory_create_buffer(renderer->device, object_buf_desc, "object_transforms");
+    std::memcpy(renderer->object_buf.GetMappedRange(),
+                renderer->object_transforms.data(),
+                renderer->object_transforms.size() * sizeof(glm::mat4));
+    renderer->object_buf.Unmap();
+
+    // The cullers bound the meshlets, or the whole mesh, of each object's transform,
+    // so they're created once the objects are laid out
+    renderer->cluster_culler.release();
+    renderer->cluster_culler = ClusterCuller(renderer->instance,
+                                             renderer->device,
+                                             mesh,
+                                             renderer->object_buf,
+                                             num_objects,
+                                             renderer->instanced_draw_layout,
+                                             false);
+    renderer->object_culler.release();
+    renderer->object_culler = ClusterCuller(renderer->instance,
+                                            renderer->device,
+                                            mesh,
+                                            renderer->object_buf,
+                                            num_objects,
+                                            renderer->instanced_draw_layout,
+                                            true);
+    if (renderer->cluster_culler.is_enabled() || renderer->object_culler.is_enabled()) {
+        const std::string source = load_shader_source(
+            renderer, CLUSTER_CULL_SHADER_FILE, EMBEDDED_CLUSTER_CULL_WGSL);
+        renderer->cluster_cull_module =
+            create_shader_module(renderer, source, CLUSTER_CULL_SHADER_FILE);
+        create_cull_pipelines(renderer);
+    }
+    if (!renderer->cluster_culler.is_enabled() && mesh.num_meshlets > 0) {
+        std::cout << "Cluster culling disabled, "
+                  << renderer->cluster_culler.why_disabled() << "\n";
+    }
+    if (!renderer->object_culler.is_enabled()) {
+        std::cout << "GPU driven drawing disabled, "
+                  << renderer->object_culler.why_disabled() << "\n";
+    }
+    renderer->errors.pop_scope();
+    CPU_ZONE_END(cull_zone);
+}
+
+ShaderVariants scene_shader_variants(const bool instanced)
+{
+    std::vector<ShaderVariants::Feature> features(3);
+    features[0].name = "VERTEX_COLORS";
+    features[0].stages = wgpu::ShaderStage::Vertex;
+    features[0].default_enabled = true;
+
+    features[1].name = "SRGB_ENCODE";
+    features[1].stages = wgpu::ShaderStage::Fragment;
+    features[1].default_enabled = false;
+
+    features[2].name = "LIGHTING";
+    features[2].stages = wgpu::ShaderStage::Vertex;
+    features[2].default_enabled = false;
+    return ShaderVariants(instanced ? "scene_instanced" : "scene", features);
+}
+
+void set_scene_variant(Renderer *renderer, const ShaderVariants::Key variant)
+{
+    renderer->scene_variant = variant;
+    renderer->scene_pipeline = scene_variant_pipeline(renderer, variant, false);
+    renderer->scene_instanced_pipeline = scene_variant_pipeline(renderer, variant, true);
+}
+
+void precompile_scene_variants(Renderer *renderer)
+{
+    CPU_ZONE("precompile_scene_variants");
+    for (const auto &variant : renderer->scene_variants.all_variants()) {
+        scene_variant_pipeline(renderer, variant, false);
+        scene_variant_pipeline(renderer, variant, true);
+    }
+}
+
+std::vector<std::string> shader_files()
+{
+    return std::vector<std::string>{SCENE_SHADER_FILE, CLUSTER_CULL_SHADER_FILE};
+}
+
+bool reload_shader(Renderer *renderer, const std::string &file, const std::string &source)
+{
+    if (file == CLUSTER_CULL_SHADER_FILE) {
+        CPU_ZONE("reload_shader");
+        renderer->cluster_cull_module = create_shader_module(renderer, source, file);
+        // Falls back to the previous pipelines until the new ones are ready, like the
+        // scene's
+        create_cull_pipelines(renderer);
+        return true;
+    }
+    if (file != SCENE_SHADER_FILE) {
+        return false;
+    }
+    CPU_ZONE("reload_shader");
+    renderer->shader_module = create_shader_module(renderer, source, file);
+
+    // Only the scene's variant pipelines use the module. Each new pipeline falls
+    // back to the previous one, so the scene keeps drawing with the last pipeline
+    // that compiled until the new one is ready, or for good if it fails
+    renderer->scene_variants.rebuild(
+        [&](ShaderVariants::Key key, PipelineLoader::Handle previous) {
+            return create_scene_pipeline(renderer, key, false, previous);
+        });
+    renderer->scene_instanced_variants.rebuild(
+        [&](ShaderVariants::Key key, PipelineLoader::Handle previous) {
+            return create_scene_pipeline(renderer, key, true, previous);
+        });
+    renderer->scene_pipeline =
+        scene_variant_pipeline(renderer, renderer->scene_variant, false);
+    renderer->scene_instanced_pipeline =
+        scene_variant_pipeline(renderer, renderer->scene_variant, true);
+    return true;
+}
+
+void prewarm_pipelines(Renderer *renderer, const std::vector<std::string> &names)
+{
+    CPU_ZONE("prewarm_pipelines");
+    for (const auto &name : names) {
+        if (create_named_pipeline(renderer, name) == PipelineLoader::INVALID_PIPELINE) {
+            std::cout << "Skipping unknown pipeline " << name << " in the pre-warm list\n";
+        }
+    }
+}
+
+void render_frame(Renderer *renderer,
+                  const wgpu::TextureView &target,
+                  const glm::mat4 *view_proj)
+{
+    GpuProfiler &profiler = renderer->gpu_profiler;
+    profiler.begin_frame();
+
+    const SceneDraws draws = choose_scene_draws(renderer);
+    ClusterCuller *culler = draws.culler;
+    renderer->scene_draw_calls = count_draw_calls(draws, renderer->object_transforms.size());
+
+    // Encoding errors are only raised when the encoder is finished, so they're
+    // attributed to frame_encode even if they come from the uploads
+    ErrorReporter &errors = renderer->errors;
+    errors.push_scope("frame_upload");
+    wgpu::CommandEncoder encoder = renderer->device.CreateCommandEncoder();
+    const GpuProfiler::Scope upload_scope = profiler.begin_scope(encoder, "upload");
+    if (view_proj) {
+        CPU_ZONE("camera_update");
+        renderer->staging_ring.upload(encoder,
+                                      renderer->view_param_buf,
+                                      0,
+                                      glm::value_ptr(*view_proj),
+                                      16 * sizeof(float));
+        // Kept up to date even while culling is off, so it can be turned back on
+        renderer->cluster_culler.set_view(renderer->staging_ring, encoder, *view_proj);
+        renderer->object_culler.set_view(renderer->staging_ring, encoder, *view_proj);
+    }
+    if (culler) {
+        culler->begin_frame(encoder);
+    }
+
+    // The compacted draws read the transforms from the object buffer, so there's
+    // nothing to upload per object
+    CPU_ZONE_BEGIN(draw_params_zone, "draw_params_upload");
+    renderer->draw_params.reset();
+    std::vector<uint32_t> draw_offsets;
+    if (draws.mode != DrawMode::COMPACTED) {
+        draw_offsets.reserve(renderer->object_transforms.size());
+        for (const auto &m : renderer->object_transforms) {
+            draw_offsets.push_back(
+                renderer->draw_params.push(glm::value_ptr(m), 16 * sizeof(float)));
+        }
+    }
+    renderer->draw_params.upload(renderer->staging_ring, encoder);
+    profiler.end_scope(encoder, upload_scope);
+    errors.pop_scope();
+    CPU_ZONE_END(draw_params_zone);
+
+    CPU_ZONE_BEGIN(encode_zone, "encode");
+    errors.push_scope("frame_encode");
+    std::vector<wgpu::CommandBuffer> commands;
+    // The scene's time includes the culling, so it's comparable with and without
+    // culling. The compacted draws are too few to be worth splitting between threads
+    const GpuProfiler::Scope scene_scope = profiler.begin_scope(encoder, "scene");
+    if (renderer->recorder->num_threads() > 1 && draws.mode != DrawMode::COMPACTED) {
+        // The workers' bundles are drawn after the culling
+        if (culler) {
+            wgpu::ComputePassDescriptor pass_desc;
+            pass_desc.label = "cull";
+            wgpu::ComputePassEncoder pass_enc = encoder.BeginComputePass(&pass_desc);
+            dispatch_culling(draws, pass_enc);
+            pass_enc.End();
+            culler->resolve(encoder);
+        }
+        record_draws_parallel(renderer, encoder, target, draw_offsets, draws);
+        profiler.end_scope(encoder, scene_scope);
+        profiler.resolve(encoder);
+        commands.push_back(encoder.Finish());
+    } else {
+        RenderGraph &graph = renderer->render_graph;
+        graph.reset();
+        // The scene is drawn from scratch each frame, so the target is cleared
+        const RenderGraphResource backbuffer =
+            graph.import_texture("target", target, true, true);
+        const RenderGraphResource culled_draws = graph.import_buffer("culled_draws", false);
+        if (culler) {
+            graph.add_compute_pass(
+                "cull",
+                [&](RenderGraph::PassBuilder &builder) { builder.write(culled_draws); },
+                [&](const RenderGraph &, const wgpu::ComputePassEncoder &pass_enc) {
+                    dispatch_culling(draws, pass_enc);
+                });
+        }
+        graph.add_render_pass(
+            "scene",
+            [&](RenderGraph::PassBuilder &builder) {
+                builder.write_color(backbuffer);
+                if (culler) {
+                    builder.read(culled_draws);
+                }
+            },
+            [&](const RenderGraph &, const wgpu::RenderPassEncoder &render_pass_enc) {
+                record_scene(
+                    renderer, render_pass_enc, draw_offsets, 0, draw_offsets.size(), draws);
+            });
+        graph.compile();
+        graph.execute(encoder);
+        if (culler) {
+            culler->resolve(encoder);
+        }
+        profiler.end_scope(encoder, scene_scope);
+        profiler.resolve(encoder);
+        commands.push_back(encoder.Finish());
+    }
+    errors.pop_scope();
+    CPU_ZONE_END(encode_zone);
+
+    CPU_ZONE_BEGIN(submit_zone, "submit");
+    errors.push_scope("frame_submit");
+    renderer->staging_ring.finish();
+    // Here the # refers to the number of command buffers being submitted
+    renderer->queue.Submit(commands.size(), commands.data());
+    renderer->staging_ring.recall();
+    profiler.end_frame();
+    if (culler) {
+        culler->end_frame();
+    }
+    errors.pop_scope();
+    CPU_ZONE_END(submit_zone);
+}
+
+#ifndef __EMSCRIPTEN__
+void wait_for_pipelines(Renderer *renderer)
+{
+    CPU_ZONE("wait_for_pipelines");
+    while (renderer->pipelines.num_pending() > 0) {
+        renderer->instance.ProcessEvents();
+        std::this_thread::yield();
+    }
+}
+
+void benchmark_encoding(Renderer *renderer, const uint32_t width, const uint32_t height)
+{
+    const size_t num_iterations = 100;
+
+    // Record into an offscreen target so we don't need to acquire swap chain images
+    wgpu::TextureDescriptor texture_desc;
+    texture_desc.format = renderer->color_format;
+    texture_desc.size.width = width;
+    texture_desc.size.height = height;
+    texture_desc.usage = wgpu::TextureUsage::RenderAttachment;
+    const wgpu::Texture texture =
+        gpu_memory_create_texture(renderer->device, texture_desc, "encode_benchmark_target");
+    const wgpu::TextureView target = texture.CreateView();
+
+    // Measure recording the draws directly, not replaying a cached bundle
+    renderer->use_bundles = false;
+    wait_for_pipelines(renderer);
+
+    renderer->draw_params.reset();
+    std::vector<uint32_t> draw_offsets;
+    for (const auto &m : renderer->object_transforms) {
+        draw_offsets.push_back(
+            renderer->draw_params.push(glm::value_ptr(m), 16 * sizeof(float)));
+    }
+
+    std::cout << "Encoding " << draw_offsets.size() << " draws, " << num_iterations
+              << " iterations\n";
+    const uint32_t max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (uint32_t threads = 1; threads <= max_threads; threads *= 2) {
+        renderer->recorder.reset(new ParallelRecorder(threads));
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < num_iterations; ++i) {
+            wgpu::CommandEncoder encoder = renderer->device.CreateCommandEncoder();
+            record_draws_parallel(renderer, encoder, target, draw_offsets, SceneDraws());
+            encoder.Finish();
+        }
+        const auto end = std::chrono::steady_clock::now();
+        const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        std::cout << "threads: " << threads << ", encode time: " << ms / num_iterations
+                  << "ms/frame\n";
+    }
+}
+#endif
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "cluster_culler.h"
+#include "error_reporter.h"
+#include "frame_pacer.h"
+#include "gpu_profiler.h"
+#include "mesh_loader.h"
+#include "object_cache.h"
+#include "parallel_recorder.h"
+#include "pipeline_loader.h"
+#include "render_bundle_cache.h"
+#include "render_graph.h"
+#include "shader_variants.h"
+#include "staging_ring.h"
+#include "uniform_arena.h"
+#include <glm/glm.hpp>
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/native/DawnNative.h>
+#include <dawn/webgpu_cpp.h>
+#endif
+
+/* Get the feature flags of the scene shader, see shaders/scene.wgsl. The instanced
+ * variants are named apart, as their pipelines use the GPU driven draws' entry
+ * points, but share the same keys.
+ */
+ShaderVariants scene_shader_variants(const bool instanced = false);
+
+/* The GPU state for drawing the scene, a grid of objects sharing the same
+ * geometry and pipeline, and for recording frames of it into a target view.
+ * The windowed app and the headless benchmark share the renderer and only differ
+ * in where the target comes from and how frames are presented.
+ */
+struct Renderer {
+    wgpu::Instance instance;
+    wgpu::Device device;
+    wgpu::Queue queue;
+    wgpu::TextureFormat color_format = wgpu::TextureFormat::Undefined;
+
+    ObjectCache object_cache;
+    PipelineLoader pipelines;
+    // The directory to load the shaders from, if empty or a file can't be read the
+    // copy embedded at build time is used
+    std::string shader_dir;
+    wgpu::ShaderModule shader_module;
+    wgpu::PipelineLayout scene_pipeline_layout;
+    // The scene shader's variants and the one the scene is drawn with, set the
+    // variant before create_scene or change it after with set_scene_variant
+    ShaderVariants scene_variants = scene_shader_variants();
+    ShaderVariants::Key scene_variant = scene_variants.default_key();
+    PipelineLoader::Handle scene_pipeline = PipelineLoader::INVALID_PIPELINE;
+    // The variants drawing the GPU driven draws, which read the objects' transforms
+    // from storage
+    wgpu::PipelineLayout scene_instanced_pipeline_layout;
+    wgpu::BindGroupLayout instanced_draw_layout;
+    ShaderVariants scene_instanced_variants = scene_shader_variants(true);
+    PipelineLoader::Handle scene_instanced_pipeline = PipelineLoader::INVALID_PIPELINE;
+    // The geometry each object is drawn with. Set it with load_mesh before
+    // create_scene, otherwise create_scene makes a single triangle
+    Mesh mesh;
+    // The error allowed quantizing the vertices of the meshes the renderer creates
+    VertexErrorBounds vertex_error_bounds;
+    wgpu::Buffer view_param_buf;
+    // The mesh's position dequantization transform, see VertexFormat
+    wgpu::Buffer mesh_param_buf;
+    wgpu::BindGroup bind_group;
+
+    // Culls the mesh's meshlets before the scene is drawn, if the mesh has them
+    ClusterCuller cluster_culler;
+    // Draw the meshlets culled by cluster_culler, otherwise the whole mesh is drawn
+    bool cluster_culling = true;
+    wgpu::ShaderModule cluster_cull_module;
+    PipelineLoader::Handle cluster_cull_pipeline = PipelineLoader::INVALID_PIPELINE;
+
+    /* Cull the objects on the GPU and draw the visible ones with an instanced
+     * indirect draw per meshlet, or of the whole mesh if the meshlets aren't culled,
+     * so the CPU records the same few draws however many objects there are.
+     * Otherwise each object is drawn with its own draws.
+     */
+    bool gpu_driven = true;
+    // Culls whole objects for the GPU driven draws when the meshlets aren't culled
+    ClusterCuller object_culler;
+    PipelineLoader::Handle reset_draws_pipeline = PipelineLoader::INVALID_PIPELINE;
+    PipelineLoader::Handle cull_compact_pipeline = PipelineLoader::INVALID_PIPELINE;
+    // The draw calls the scene was recorded with last frame, or replayed from a bundle
+    uint64_t scene_draw_calls = 0;
+
+    StagingRing staging_ring;
+    FramePacer frame_pacer;
+    UniformArena draw_params;
+    std::unique_ptr<ParallelRecorder> recorder;
+    RenderBundleCache bundle_cache;
+    bool use_bundles = true;
+    RenderGraph render_graph;
+    GpuProfiler gpu_profiler;
+    ErrorReporter errors;
+
+    // The model transform of each object in the scene, all objects share the same geometry
+    std::vector<glm::mat4> object_transforms;
+    // The object transforms in a storage buffer, for the culling and GPU driven draws
+    wgpu::Buffer object_buf;
+};
+
+#ifndef __EMSCRIPTEN__
+/* Find an adapter for the backend. If cpu_only is set only a software adapter
+ * (e.g., SwiftShader or lavapipe for Vulkan) will be returned. Throws if no
+ * matching adapter is found.
+ */
+dawn::native::Adapter request_adapter(dawn::native::Instance &instance,
+                                      const wgpu::BackendType backend_type,
+                                      const bool cpu_only = false);
+
+/* Create a device with the optional features the renderer uses if the adapter
+ * supports them: implicit device synchronization when multithreaded is set,
+ * needed to record from multiple threads, and timestamp queries for the GPU
+ * profiler. Check the device's features to see which were enabled.
+ */
+wgpu::Device create_device(dawn::native::Adapter &adapter, const bool multithreaded);
+#endif
+
+/* Create the scene's pipeline, buffers and bind groups for rendering to color_format
+ * targets and lay out num_objects objects on a grid. The renderer's device, queue,
+ * staging ring, error reporter, object cache and pipeline loader must already be
+ * set. The scene pipeline is created asynchronously, until it's ready frames are
+ * drawn without the scene. If the mesh has meshlets the cluster culling pipeline
+ * is created too, and until it's ready the whole mesh is drawn. Likewise each
+ * object is drawn on its own until the GPU driven draws' pipelines are ready.
+ */
+void create_scene(Renderer *renderer,
+                  const wgpu::TextureFormat color_format,
+                  const uint32_t num_objects);
+
+// Draw the scene with the shader variant, its pipeline is created if needed
+void set_scene_variant(Renderer *renderer, const ShaderVariants::Key variant);
+
+/* Start creating the pipelines for every variant of the scene shader, so
+ * switching variants doesn't wait on compiling one. Must be called after
+ * create_scene.
+ */
+void precompile_scene_variants(Renderer *renderer);
+
+// Get the shader files the renderer loads from its shader directory
+std::vector<std::string> shader_files();
+
+/* Recompile the shader file with its new source and rebuild only the pipelines
+ * using it. The new pipelines are created asynchronously and swapped in when
+ * ready, until then, or if they fail to compile, the previous pipelines are
+ * used. Returns false if the file isn't one of the renderer's shaders.
+ */
+bool reload_shader(Renderer *renderer, const std::string &file, const std::string &source);
+
+/* Start creating the named pipelines, e.g. those used in the last session, so
+ * they're ready by the time they're needed. Must be called after create_scene.
+ * Pipelines that already exist are reused and unknown names are skipped.
+ */
+void prewarm_pipelines(Renderer *renderer, const std::vector<std::string> &names);
+
+/* Record and submit a frame drawing the scene into the target, uploading the
+ * view_proj matrix first if it's not null. If GPU driven drawing or cluster
+ * culling is on, a compute pass culls the objects or their meshlets before the
+ * render pass draws the survivors. Pacing the frame with the frame pacer and
+ * presenting the target are left to the caller.
+ */
+void render_frame(Renderer *renderer,
+                  const wgpu::TextureView &target,
+                  const glm::mat4 *view_proj);
+
+#ifndef __EMSCRIPTEN__
+// Block until all pipelines being created are ready or have failed
+void wait_for_pipelines(Renderer *renderer);
+
+// Time recording the scene's draws into a width x height target with 1, 2, 4, ... threads
+void benchmark_encoding(Renderer *renderer, const uint32_t width, const uint32_t height);
+#endif
@@ -0,0 +1,125 @@
+#include "shader_variants.h"
+#include <sstream>
+#include <stdexcept>
+
+ShaderVariants::ShaderVariants(const std::string &base_name,
+                               const std::vector<Feature> &features)
+    : base_name(base_name), features(features)
+{
+    if (features.size() > 32) {
+        throw std::runtime_error("Shader " + base_name + " has more than 32 features");
+    }
+}
+
+ShaderVariants::Key ShaderVariants::default_key() const
+{
+    Key key = 0;
+    for (size_t i = 0; i < features.size(); ++i) {
+        if (features[i].default_enabled) {
+            key |= 1u << i;
+        }
+    }
+    return key;
+}
+
+bool ShaderVariants::parse_features(const std::string &list, Key &key) const
+{
+    Key parsed = 0;
+    std::stringstream ss(list);
+    std::string feature;
+    while (std::getline(ss, feature, ',')) {
+        if (feature.empty()) {
+            continue;
+        }
+        size_t i = 0;
+        for (; i < features.size(); ++i) {
+            if (features[i].name == feature) {
+                break;
+            }
+        }
+        if (i == features.size()) {
+            return false;
+        }
+        parsed |= 1u << i;
+    }
+    key = parsed;
+    return true;
+}
+
+std::string ShaderVariants::name(Key key) const
+{
+    std::string n = base_name;
+    for (size_t i = 0; i < features.size(); ++i) {
+        if (key & (1u << i)) {
+            n += "/" + features[i].name;
+        }
+    }
+    return n;
+}
+
+bool ShaderVariants::parse_name(const std::string &name, Key &key) const
+{
+    if (name.compare(0, base_name.size(), base_name) != 0) {
+        return false;
+    }
+    const std::string rest = name.substr(base_name.size());
+    if (!rest.empty() && rest[0] != '/') {
+        return false;
+    }
+    std::string list = rest;
+    for (auto &c : list) {
+        if (c == '/') {
+            c = ',';
+        }
+    }
+    return parse_features(list, key);
+}
+
+std::vector<ShaderVariants::Key> ShaderVariants::all_variants() const
+{
+    std::vector<Key> keys;
+    const uint64_t num_variants = uint64_t(1) << features.size();
+    for (uint64_t k = 0; k < num_variants; ++k) {
+        keys.push_back(static_cast<Key>(k));
+    }
+    return keys;
+}
+
+std::vector<wgpu::ConstantEntry> ShaderVariants::constants(Key key,
+                                                           wgpu::ShaderStage stage) const
+{
+    std::vector<wgpu::ConstantEntry> entries;
+    for (size_t i = 0; i < features.size(); ++i) {
+        if ((features[i].stages & stage) == wgpu::ShaderStage::None) {
+            continue;
+        }
+        wgpu::ConstantEntry entry;
+        entry.key = features[i].name.c_str();
+        entry.value = (key & (1u << i)) ? 1.0 : 0.0;
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+PipelineLoader::Handle ShaderVariants::pipeline(Key key, const CreateFn &create)
+{
+    auto fnd = pipelines.find(key);
+    if (fnd != pipelines.end()) {
+        return fnd->second;
+    }
+    const PipelineLoader::Handle handle = create(key);
+    pipelines[key] = handle;
+    return handle;
+}
+
+void ShaderVariants::rebuild(const RebuildFn &rebuild)
+{
+    for (auto &it : pipelines) {
+        it.second = rebuild(it.first, it.second);
+    }
+}
+
+size_t ShaderVariants::num_created() const
+{
+    return pipelines.size();
+}
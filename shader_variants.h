@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "pipeline_loader.h"
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+/* The variants of a shader specialized by feature flags. The shader declares each
+ * flag as a bool override constant, e.g. `override VERTEX_COLORS: bool = true;`,
+ * and branches on it. A variant's flags are set through the pipeline's constants,
+ * so they're known when the pipeline is compiled and the branches not taken are
+ * compiled out, unlike a uniform the shader would test each invocation.
+ *
+ * A variant is identified by its key, a bitmask of the enabled features, and
+ * named after the base name and its enabled features, e.g. "scene/VERTEX_COLORS".
+ * The names are stable between runs so they can be saved in the pre-warm list.
+ * The variants' pipelines are cached by key, and all variants can be enumerated
+ * to compile them ahead of time.
+ */
+class ShaderVariants {
+public:
+    using Key = uint32_t;
+
+    struct Feature {
+        // The name of the override constant in the shader
+        std::string name;
+        // The stages using the constant, Dawn rejects constants set on a stage
+        // whose entry point doesn't use them
+        wgpu::ShaderStage stages = wgpu::ShaderStage::None;
+        bool default_enabled = false;
+    };
+
+    using CreateFn = std::function<PipelineLoader::Handle(Key key)>;
+
+    using RebuildFn =
+        std::function<PipelineLoader::Handle(Key key, PipelineLoader::Handle previous)>;
+
+private:
+    std::string base_name;
+    std::vector<Feature> features;
+    std::unordered_map<Key, PipelineLoader::Handle> pipelines;
+
+public:
+    ShaderVariants() = default;
+
+    // At most 32 features are supported
+    ShaderVariants(const std::string &base_name, const std::vector<Feature> &features);
+
+    // Get the key with each feature set to its default
+    Key default_key() const;
+
+    /* Parse a comma separated list of the features to enable, the others are
+     * disabled. Returns false if a feature is unknown.
+     */
+    bool parse_features(const std::string &list, Key &key) const;
+
+    // Get the variant's name, the base name followed by its enabled features
+    std::string name(Key key) const;
+
+    // Parse a name returned by name(), returns false if it's not one of our variants
+    bool parse_name(const std::string &name, Key &key) const;
+
+    // Get the keys of every combination of features
+    std::vector<Key> all_variants() const;
+
+    /* Get the override constants specializing the stage for the variant. The
+     * entries' keys point to the feature names, so must not outlive this object.
+     */
+    std::vector<wgpu::ConstantEntry> constants(Key key, wgpu::ShaderStage stage) const;
+
+    // Get the variant's pipeline, calling create to make it the first time
+    PipelineLoader::Handle pipeline(Key key, const CreateFn &create);
+
+    /* Replace the pipeline of each variant created so far with the one returned
+     * by rebuild, e.g. after the shader changed. Variants that haven't been
+     * created aren't compiled.
+     */
+    void rebuild(const RebuildFn &rebuild);
+
+    // Get the number of variants that have had pipelines created
+    size_t num_created() const;
+};
@@ -0,0 +1,147 @@
+#include "shader_watcher.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// How often the watcher thread checks if it should stop, or polls the files when
+// inotify isn't available
+const int POLL_INTERVAL_MS = 100;
+
+}
+
+ShaderWatcher::ShaderWatcher(const std::string &directory,
+                             const std::vector<std::string> &files)
+    : directory(directory), files(files), stop(false)
+{
+#ifdef __linux__
+    thread = std::thread([this]() { watch_inotify(); });
+#else
+    thread = std::thread([this]() { watch_mtimes(); });
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+    stop = true;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+std::vector<ShaderWatcher::Change> ShaderWatcher::poll_changes()
+{
+    std::vector<Change> result;
+    std::lock_guard<std::mutex> lock(mutex);
+    result.swap(changes);
+    return result;
+}
+
+void ShaderWatcher::watch_inotify()
+{
+#ifdef __linux__
+    const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        watch_mtimes();
+        return;
+    }
+    // Watch the directory rather than the files, editors that save by renaming a
+    // new file over the old one would end a watch on the file itself
+    if (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(fd);
+        watch_mtimes();
+        return;
+    }
+
+    alignas(inotify_event) char buf[4096];
+    while (!stop) {
+        pollfd pfd = {};
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, POLL_INTERVAL_MS) <= 0) {
+            continue;
+        }
+        const ssize_t len = read(fd, buf, sizeof(buf));
+        if (len <= 0) {
+            continue;
+        }
+
+        // A save can produce several events for the same file, read each file once
+        std::vector<std::string> changed;
+        for (ssize_t i = 0; i < len;) {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(buf + i);
+            if (event->len > 0) {
+                const std::string file = event->name;
+                if (std::find(files.begin(), files.end(), file) != files.end() &&
+                    std::find(changed.begin(), changed.end(), file) == changed.end()) {
+                    changed.push_back(file);
+                }
+            }
+            i += sizeof(inotify_event) + event->len;
+        }
+        for (const auto &file : changed) {
+            file_changed(file);
+        }
+    }
+    close(fd);
+#else
+    watch_mtimes();
+#endif
+}
+
+void ShaderWatcher::watch_mtimes()
+{
+    std::vector<time_t> mtimes(files.size(), 0);
+    for (size_t i = 0; i < files.size(); ++i) {
+        struct stat st;
+        if (stat((directory + "/" + files[i]).c_str(), &st) == 0) {
+            mtimes[i] = st.st_mtime;
+        }
+    }
+
+    while (!stop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+        for (size_t i = 0; i < files.size(); ++i) {
+            struct stat st;
+            if (stat((directory + "/" + files[i]).c_str(), &st) == 0 &&
+                st.st_mtime != mtimes[i]) {
+                mtimes[i] = st.st_mtime;
+                file_changed(files[i]);
+            }
+        }
+    }
+}
+
+void ShaderWatcher::file_changed(const std::string &file)
+{
+    std::ifstream fin((directory + "/" + file).c_str());
+    std::stringstream source;
+    source << fin.rdbuf();
+    // The file may be caught empty partway through being written, its next write
+    // will be picked up
+    if (!fin || source.str().empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &c : changes) {
+        if (c.file == file) {
+            c.source = source.str();
+            return;
+        }
+    }
+    Change change;
+    change.file = file;
+    change.source = source.str();
+    changes.push_back(change);
+}
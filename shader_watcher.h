@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Watches shader files for changes on a background thread and reads their new
+ * source, so the frame loop only picks up the changed files at a frame boundary
+ * and never waits on the file system. On Linux the files' directory is watched
+ * with inotify, catching both in-place writes and editors that save by renaming
+ * a new file over the old one. Other platforms poll the files' modification
+ * times instead.
+ */
+class ShaderWatcher {
+public:
+    struct Change {
+        // The file name within the watched directory
+        std::string file;
+        std::string source;
+    };
+
+private:
+    std::string directory;
+    std::vector<std::string> files;
+
+    std::mutex mutex;
+    std::vector<Change> changes;
+
+    std::atomic<bool> stop;
+    std::thread thread;
+
+public:
+    // Start watching the files, given by name, in the directory
+    ShaderWatcher(const std::string &directory, const std::vector<std::string> &files);
+
+    ~ShaderWatcher();
+
+    ShaderWatcher(const ShaderWatcher &) = delete;
+    ShaderWatcher &operator=(const ShaderWatcher &) = delete;
+
+    // Take the files that changed since the last call, with their new source
+    std::vector<Change> poll_changes();
+
+private:
+    void watch_inotify();
+
+    void watch_mtimes();
+
+    // Read the file and queue its new source
+    void file_changed(const std::string &file);
+};
@@ -0,0 +1,177 @@
+// Culls each object's meshlets against the view frustum and by their normal
+// cones, writing the DrawIndexedIndirect arguments the scene draws them with, see
+// ClusterCuller in cluster_culler.h. cull_clusters writes the arguments of each
+// object and meshlet, reset_draws and cull_compact compact the visible objects
+// into an instanced draw per meshlet. Native builds reload this file when it
+// changes, and embed it for when it can't be found.
+alias float4 = vec4<f32>;
+alias float3 = vec3<f32>;
+
+// See Meshlet in meshlet_builder.h, the bounds are in the mesh's dequantized space
+struct Meshlet {
+    center_radius: float4,
+    cone_axis_cutoff: float4,
+    first_index: u32,
+    num_indices: u32,
+    num_vertices: u32,
+    padding: u32,
+};
+
+struct CullParams {
+    // World space planes with normals pointing inside the frustum
+    planes: array<float4, 6>,
+    camera_position: float4,
+    num_meshlets: u32,
+    num_objects: u32,
+    dispatch_width: u32,
+    // The distance between the meshlets' lists of visible objects
+    instance_stride: u32,
+};
+
+struct DrawIndexedArgs {
+    index_count: u32,
+    instance_count: u32,
+    first_index: u32,
+    base_vertex: i32,
+    first_instance: u32,
+};
+
+// The compacted draw of a meshlet, each instance is a visible object
+struct CompactedDrawArgs {
+    index_count: u32,
+    instance_count: atomic<u32>,
+    first_index: u32,
+    base_vertex: i32,
+    first_instance: u32,
+};
+
+// The visible triangles can pass 2^32 with enough objects, so they're counted in
+// the low and high words of a 64 bit count
+struct CullCounts {
+    visible_clusters: atomic<u32>,
+    visible_triangles_lo: atomic<u32>,
+    visible_triangles_hi: atomic<u32>,
+};
+
+@group(0) @binding(0)
+var<uniform> cull_params: CullParams;
+
+@group(0) @binding(1)
+var<storage, read> meshlets: array<Meshlet>;
+
+@group(0) @binding(2)
+var<storage, read> object_transforms: array<mat4x4<f32>>;
+
+@group(0) @binding(3)
+var<storage, read_write> draw_args: array<DrawIndexedArgs>;
+
+@group(0) @binding(4)
+var<storage, read_write> cull_counts: CullCounts;
+
+@group(0) @binding(5)
+var<storage, read_write> compacted_draws: array<CompactedDrawArgs>;
+
+// The objects drawn by meshlet m's instances start at m * instance_stride
+@group(0) @binding(6)
+var<storage, read_write> draw_instances: array<u32>;
+
+// Each workgroup sums its counts before adding them to the totals, so there's
+// one global atomic per workgroup instead of one per visible cluster. A mesh's
+// index buffer can't hold enough triangles for a workgroup's sum to overflow
+var<workgroup> group_clusters: atomic<u32>;
+var<workgroup> group_triangles: atomic<u32>;
+
+fn is_visible(meshlet: Meshlet, model: mat4x4<f32>) -> bool {
+    // The model transform scales uniformly, so the sphere stays a sphere
+    let center = (model * float4(meshlet.center_radius.xyz, 1.0)).xyz;
+    let scale = length(model[0].xyz);
+    let radius = meshlet.center_radius.w * scale;
+    for (var i = 0u; i < 6u; i++) {
+        let plane = cull_params.planes[i];
+        if (dot(plane.xyz, center) + plane.w < -radius) {
+            return false;
+        }
+    }
+
+    // Every triangle faces away from the camera if it's within the cone opposite
+    // the normals from anywhere in the sphere, a cutoff of 1 never culls
+    let axis = normalize((model * float4(meshlet.cone_axis_cutoff.xyz, 0.0)).xyz);
+    let to_center = center - cull_params.camera_position.xyz;
+    return dot(axis, to_center) <= meshlet.cone_axis_cutoff.w * length(to_center) + radius;
+}
+
+fn count_visible(meshlet: Meshlet) {
+    atomicAdd(&group_clusters, 1u);
+    atomicAdd(&group_triangles, meshlet.num_indices / 3u);
+}
+
+// Must be called from uniform control flow, after the workgroup's clusters are culled
+fn add_group_counts(local_index: u32) {
+    workgroupBarrier();
+    if (local_index == 0u) {
+        atomicAdd(&cull_counts.visible_clusters, atomicLoad(&group_clusters));
+        // Carry into the high word when the low word wraps
+        let triangles = atomicLoad(&group_triangles);
+        let lo = atomicAdd(&cull_counts.visible_triangles_lo, triangles);
+        if (lo + triangles < lo) {
+            atomicAdd(&cull_counts.visible_triangles_hi, 1u);
+        }
+    }
+}
+
+@compute @workgroup_size(64)
+fn cull_clusters(@builtin(global_invocation_id) global_id: vec3<u32>,
+                 @builtin(local_invocation_index) local_index: u32) {
+    // The clusters are ordered by object then meshlet, like the draws
+    let cluster = global_id.y * cull_params.dispatch_width + global_id.x;
+    if (cluster < cull_params.num_meshlets * cull_params.num_objects) {
+        let object = cluster / cull_params.num_meshlets;
+        let meshlet = meshlets[cluster % cull_params.num_meshlets];
+        let visible = is_visible(meshlet, object_transforms[object]);
+
+        // Culled clusters draw no instances
+        draw_args[cluster].index_count = meshlet.num_indices;
+        draw_args[cluster].instance_count = select(0u, 1u, visible);
+        draw_args[cluster].first_index = meshlet.first_index;
+        draw_args[cluster].base_vertex = 0;
+        draw_args[cluster].first_instance = 0u;
+        if (visible) {
+            count_visible(meshlet);
+        }
+    }
+    add_group_counts(local_index);
+}
+
+// Empty each meshlet's compacted draw, run in a dispatch before cull_compact so
+// its writes are visible to it
+@compute @workgroup_size(64)
+fn reset_draws(@builtin(global_invocation_id) global_id: vec3<u32>) {
+    let m = global_id.x;
+    if (m < cull_params.num_meshlets) {
+        let meshlet = meshlets[m];
+        compacted_draws[m].index_count = meshlet.num_indices;
+        atomicStore(&compacted_draws[m].instance_count, 0u);
+        compacted_draws[m].first_index = meshlet.first_index;
+        compacted_draws[m].base_vertex = 0;
+        compacted_draws[m].first_instance = 0u;
+    }
+}
+
+@compute @workgroup_size(64)
+fn cull_compact(@builtin(global_invocation_id) global_id: vec3<u32>,
+                @builtin(local_invocation_index) local_index: u32) {
+    let cluster = global_id.y * cull_params.dispatch_width + global_id.x;
+    if (cluster < cull_params.num_meshlets * cull_params.num_objects) {
+        let object = cluster / cull_params.num_meshlets;
+        let m = cluster % cull_params.num_meshlets;
+        let meshlet = meshlets[m];
+        if (is_visible(meshlet, object_transforms[object])) {
+            // The order the objects are appended in doesn't matter, each instance
+            // draws the object in its slot
+            let slot = atomicAdd(&compacted_draws[m].instance_count, 1u);
+            draw_instances[m * cull_params.instance_stride + slot] = object;
+            count_visible(meshlet);
+        }
+    }
+    add_group_counts(local_index);
+}
@@ -0,0 +1,140 @@
+// The scene shader, drawing each object with its vertex colors. The features are
+// override constants so each variant's pipeline is compiled with only the
+// branches it takes, see scene_shader_variants in renderer.cpp. Native builds
+// reload this file when it changes, and embed it for when it can't be found.
+alias float4 = vec4<f32>;
+alias float3 = vec3<f32>;
+alias float2 = vec2<f32>;
+
+// Use the vertex colors, otherwise the objects are drawn white
+override VERTEX_COLORS: bool = true;
+// Encode the output color to sRGB, for non-sRGB targets
+override SRGB_ENCODE: bool = false;
+// Shade the objects with a directional light, using the mesh's normals if it has them
+override LIGHTING: bool = false;
+
+// The vertex attributes may be quantized, see VertexFormat in vertex_format.h. The
+// vertex fetch unpacks them to floats, positions are in [-1, 1] relative to the
+// mesh's bounds and normals are octahedral encoded
+struct VertexInput {
+    @location(0) position: float4,
+    @location(1) color: float4,
+};
+
+struct VertexNormalInput {
+    @location(0) position: float4,
+    @location(1) color: float4,
+    @location(2) normal: float2,
+};
+
+struct VertexOutput {
+    @builtin(position) position: float4,
+    @location(0) color: float4,
+};
+
+struct ViewParams {
+    view_proj: mat4x4<f32>,
+};
+
+// Dequantizes the positions to position * position_scale + position_bias
+struct MeshParams {
+    position_scale: float4,
+    position_bias: float4,
+};
+
+struct DrawParams {
+    model: mat4x4<f32>,
+};
+
+@group(0) @binding(0)
+var<uniform> view_params: ViewParams;
+
+@group(0) @binding(1)
+var<uniform> mesh_params: MeshParams;
+
+@group(1) @binding(0)
+var<uniform> draw_params: DrawParams;
+
+// The GPU driven draws read the model transforms from storage instead, each
+// instance drawing the visible object in its slot of the draw's list, see
+// ClusterCuller in cluster_culler.h
+@group(1) @binding(1)
+var<storage, read> object_transforms: array<mat4x4<f32>>;
+
+@group(1) @binding(2)
+var<storage, read> draw_instances: array<u32>;
+
+// The direction towards the light, in world space
+const LIGHT_DIR = float3(0.267, 0.535, 0.802);
+const AMBIENT = 0.2;
+
+// Unfold the octahedron back onto the sphere, the inverse of oct_encode
+fn oct_decode(e: float2) -> float3 {
+    var n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        let sign_xy = select(float2(-1.0), float2(1.0), n.xy >= float2(0.0));
+        n = float3((1.0 - abs(n.yx)) * sign_xy, n.z);
+    }
+    return normalize(n);
+}
+
+fn shade_vertex(position: float4,
+                color: float4,
+                normal: float3,
+                model: mat4x4<f32>) -> VertexOutput {
+    var out: VertexOutput;
+    if (VERTEX_COLORS) {
+        out.color = color;
+    } else {
+        out.color = float4(1.0);
+    }
+    if (LIGHTING) {
+        // The model transform scales uniformly, so it keeps the normals perpendicular.
+        // Meshes without meshlets don't cull back faces, so both sides are lit
+        let n = normalize((model * float4(normal, 0.0)).xyz);
+        let diffuse = abs(dot(n, LIGHT_DIR));
+        out.color = float4(out.color.rgb * (AMBIENT + (1.0 - AMBIENT) * diffuse), out.color.a);
+    }
+    let p = position.xyz * mesh_params.position_scale.xyz + mesh_params.position_bias.xyz;
+    out.position = view_params.view_proj * model * float4(p, 1.0);
+    return out;
+}
+
+// For meshes without normals, which are lit as if facing +z
+@vertex
+fn vertex_main(vert: VertexInput) -> VertexOutput {
+    return shade_vertex(vert.position, vert.color, float3(0.0, 0.0, 1.0), draw_params.model);
+};
+
+@vertex
+fn vertex_main_normals(vert: VertexNormalInput) -> VertexOutput {
+    return shade_vertex(vert.position, vert.color, oct_decode(vert.normal), draw_params.model);
+};
+
+@vertex
+fn vertex_main_instanced(vert: VertexInput,
+                         @builtin(instance_index) instance_id: u32) -> VertexOutput {
+    let model = object_transforms[draw_instances[instance_id]];
+    return shade_vertex(vert.position, vert.color, float3(0.0, 0.0, 1.0), model);
+};
+
+@vertex
+fn vertex_main_normals_instanced(vert: VertexNormalInput,
+                                 @builtin(instance_index) instance_id: u32) -> VertexOutput {
+    let model = object_transforms[draw_instances[instance_id]];
+    return shade_vertex(vert.position, vert.color, oct_decode(vert.normal), model);
+};
+
+fn linear_to_srgb(x: vec3<f32>) -> vec3<f32> {
+    let lo = 12.92 * x;
+    let hi = 1.055 * pow(x, vec3<f32>(1.0 / 2.4)) - 0.055;
+    return select(hi, lo, x <= vec3<f32>(0.0031308));
+}
+
+@fragment
+fn fragment_main(in: VertexOutput) -> @location(0) float4 {
+    if (SRGB_ENCODE) {
+        return float4(linear_to_srgb(in.color.rgb), in.color.a);
+    }
+    return float4(in.color);
+}
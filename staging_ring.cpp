@@ -0,0 +1,130 @@
+#include "staging_ring.h"
+#include <algorithm>
+#include <cstring>
+#include "gpu_memory_tracker.h"
+
+// Buffer to buffer copies require 4 byte aligned offsets and sizes
+static const uint64_t COPY_ALIGNMENT = 4;
+
+static uint64_t align_to(uint64_t val, uint64_t align)
+{
+    return ((val + align - 1) / align) * align;
+}
+
+StagingRing::StagingRing(const wgpu::Device &device, uint64_t chunk_size)
+    : device(device), chunk_size(chunk_size)
+{
+}
+
+StagingAllocation StagingRing::allocate(uint64_t size)
+{
+    size = align_to(size, COPY_ALIGNMENT);
+
+    Chunk *chunk = nullptr;
+    // First try to fit the allocation in one of the chunks we're already writing to
+    // this frame, then in any chunk the GPU has released back to us
+    for (auto &c : chunks) {
+        if (c->in_use && c->offset + size <= c->size) {
+            chunk = c.get();
+            break;
+        }
+    }
+    if (!chunk) {
+        for (auto &c : chunks) {
+            if (!c->in_use && c->mapped && size <= c->size) {
+                chunk = c.get();
+                chunk->in_use = true;
+                chunk->offset = 0;
+                break;
+            }
+        }
+    }
+    if (!chunk) {
+        std::unique_ptr<Chunk> c(new Chunk);
+        c->size = std::max(chunk_size, size);
+
+        wgpu::BufferDescriptor buffer_desc;
+        buffer_desc.mappedAtCreation = true;
+        buffer_desc.size = c->size;
+        buffer_desc.usage = wgpu::BufferUsage::MapWrite | wgpu::BufferUsage::CopySrc;
+        c->buffer = gpu_memory_create_buffer(device, buffer_desc, "staging_ring");
+        c->mapping = reinterpret_cast<uint8_t *>(c->buffer.GetMappedRange());
+        c->mapped = true;
+        c->in_use = true;
+
+        ++num_buffers_created;
+        chunk = c.get();
+        chunks.push_back(std::move(c));
+    }
+
+    StagingAllocation alloc;
+    alloc.buffer = chunk->buffer;
+    alloc.offset = chunk->offset;
+    alloc.data = chunk->mapping + chunk->offset;
+    chunk->offset += size;
+    return alloc;
+}
+
+void StagingRing::upload(const wgpu::CommandEncoder &encoder,
+                         const wgpu::Buffer &dst,
+                         uint64_t dst_offset,
+                         const void *data,
+                         uint64_t size)
+{
+    StagingAllocation alloc = allocate(size);
+    std::memcpy(alloc.data, data, size);
+    encoder.CopyBufferToBuffer(
+        alloc.buffer, alloc.offset, dst, dst_offset, align_to(size, COPY_ALIGNMENT));
+}
+
+void StagingRing::finish()
+{
+    for (auto &c : chunks) {
+        if (c->in_use) {
+            c->buffer.Unmap();
+            c->mapping = nullptr;
+            c->mapped = false;
+        }
+    }
+}
+
+void StagingRing::recall()
+{
+    for (auto &c : chunks) {
+        if (!c->in_use) {
+            continue;
+        }
+        c->in_use = false;
+        c->offset = 0;
+        c->buffer.MapAsync(
+            wgpu::MapMode::Write,
+            0,
+            c->size,
+            [](WGPUBufferMapAsyncStatus status, void *user_data) {
+                // If the map failed (e.g., the device was lost) the chunk is
+                // left unmapped and won't be handed out again
+                if (status != WGPUBufferMapAsyncStatus_Success) {
+                    return;
+                }
+                Chunk *chunk = reinterpret_cast<Chunk *>(user_data);
+                chunk->mapping = reinterpret_cast<uint8_t *>(
+                    chunk->buffer.GetMappedRange(0, chunk->size));
+                chunk->mapped = true;
+            },
+            c.get());
+    }
+}
+
+uint32_t StagingRing::buffers_created() const
+{
+    return num_buffers_created;
+}
+
+uint64_t StagingRing::total_size() const
+{
+    uint64_t total = 0;
+    for (const auto &c : chunks) {
+        total += c->size;
+    }
+    return total;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+/* A region of a staging buffer handed out by the StagingRing. The data pointer
+ * is valid for writing until StagingRing::finish is called for the frame.
+ */
+struct StagingAllocation {
+    wgpu::Buffer buffer;
+    uint64_t offset = 0;
+    void *data = nullptr;
+};
+
+/* A persistent ring of CPU-visible staging buffers that per-frame uploads
+ * sub-allocate from. Each frame's allocations are packed into the chunk(s) at
+ * the head of the ring, which are unmapped before the frame is submitted and
+ * then re-mapped with MapAsync. The map only completes once the GPU is done
+ * reading from the chunk, so a chunk is never handed out again while a previous
+ * frame's copies may still be using it. Once the ring has grown to cover the
+ * frames in flight, uploads don't create any new buffers.
+ */
+class StagingRing {
+    struct Chunk {
+        wgpu::Buffer buffer;
+        uint64_t size = 0;
+        uint64_t offset = 0;
+        uint8_t *mapping = nullptr;
+        // Set by the map callback once the chunk is writable again
+        bool mapped = false;
+        // Set when the chunk has allocations in the current frame
+        bool in_use = false;
+    };
+
+    wgpu::Device device;
+    uint64_t chunk_size = 0;
+    // Chunks are heap allocated so the pointers passed to MapAsync stay valid
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    uint32_t num_buffers_created = 0;
+
+public:
+    StagingRing() = default;
+
+    /* Create a staging ring for the device, new chunks will be chunk_size bytes
+     * or large enough to hold the requested allocation if it's bigger.
+     */
+    StagingRing(const wgpu::Device &device, uint64_t chunk_size = 64 * 1024);
+
+    /* Allocate size bytes of staging memory for the current frame. The offset
+     * returned is aligned to satisfy buffer copy alignment requirements.
+     */
+    StagingAllocation allocate(uint64_t size);
+
+    /* Copy the data into staging memory and record a copy from it into
+     * dst at dst_offset on the encoder
+     */
+    void upload(const wgpu::CommandEncoder &encoder,
+                const wgpu::Buffer &dst,
+                uint64_t dst_offset,
+                const void *data,
+                uint64_t size);
+
+    // Unmap the chunks written this frame, must be called before Queue::Submit
+    void finish();
+
+    /* Start re-mapping the chunks used this frame, must be called after the
+     * frame's commands are submitted. The chunks become available again once
+     * their maps complete.
+     */
+    void recall();
+
+    // Get the number of staging buffers the ring has created
+    uint32_t buffers_created() const;
+
+    // Get the total size of the staging buffers owned by the ring
+    uint64_t total_size() const;
+};
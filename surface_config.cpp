@@ -0,0 +1,224 @@
+#include "surface_config.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+const char *present_mode_name(wgpu::PresentMode mode)
+{
+    switch (mode) {
+    case wgpu::PresentMode::Fifo:
+        return "fifo";
+    case wgpu::PresentMode::Mailbox:
+        return "mailbox";
+    case wgpu::PresentMode::Immediate:
+        return "immediate";
+    default:
+        return "unknown";
+    }
+}
+
+const char *surface_format_name(wgpu::TextureFormat format)
+{
+    switch (format) {
+    case wgpu::TextureFormat::BGRA8Unorm:
+        return "bgra8unorm";
+    case wgpu::TextureFormat::RGBA8Unorm:
+        return "rgba8unorm";
+    case wgpu::TextureFormat::RGBA16Float:
+        return "rgba16float";
+    case wgpu::TextureFormat::Undefined:
+        return "preferred";
+    default:
+        return "other";
+    }
+}
+
+bool parse_present_mode(const std::string &name, wgpu::PresentMode &mode)
+{
+    if (name == "fifo") {
+        mode = wgpu::PresentMode::Fifo;
+    } else if (name == "mailbox") {
+        mode = wgpu::PresentMode::Mailbox;
+    } else if (name == "immediate") {
+        mode = wgpu::PresentMode::Immediate;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parse_surface_format(const std::string &name, wgpu::TextureFormat &format)
+{
+    if (name == "bgra8unorm") {
+        format = wgpu::TextureFormat::BGRA8Unorm;
+    } else if (name == "rgba8unorm") {
+        format = wgpu::TextureFormat::RGBA8Unorm;
+    } else if (name == "rgba16float") {
+        format = wgpu::TextureFormat::RGBA16Float;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parse_surface_usage(const std::string &names, wgpu::TextureUsage &usage)
+{
+    wgpu::TextureUsage parsed = wgpu::TextureUsage::RenderAttachment;
+    std::stringstream ss(names);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        if (name == "render") {
+            parsed |= wgpu::TextureUsage::RenderAttachment;
+        } else if (name == "copy-src") {
+            parsed |= wgpu::TextureUsage::CopySrc;
+        } else if (name == "copy-dst") {
+            parsed |= wgpu::TextureUsage::CopyDst;
+        } else if (name == "texture-binding") {
+            parsed |= wgpu::TextureUsage::TextureBinding;
+        } else if (name == "storage") {
+            parsed |= wgpu::TextureUsage::StorageBinding;
+        } else {
+            return false;
+        }
+    }
+    usage = parsed;
+    return true;
+}
+
+#ifndef __EMSCRIPTEN__
+// How long to wait for a swap chain's error scope before assuming it passed
+static const std::chrono::milliseconds SWAP_CHAIN_SCOPE_TIMEOUT(250);
+
+// Create the swap chain in an error scope, returning null if it failed validation.
+// If the scope hasn't resolved by the timeout the swap chain is assumed to be valid,
+// so a slow or stuck device doesn't hang startup
+static wgpu::SwapChain try_create_swap_chain(const wgpu::Instance &instance,
+                                             const wgpu::Device &device,
+                                             const wgpu::Surface &surface,
+                                             const wgpu::SwapChainDescriptor &desc)
+{
+    struct ScopeResult {
+        bool done = false;
+        bool error = false;
+    };
+    ScopeResult result;
+
+    device.PushErrorScope(wgpu::ErrorFilter::Validation);
+    wgpu::SwapChain swap_chain = device.CreateSwapChain(surface, &desc);
+    device.PopErrorScope(
+        [](WGPUErrorType type, const char *, void *user_data) {
+            ScopeResult *result = reinterpret_cast<ScopeResult *>(user_data);
+            result->error = type != WGPUErrorType_NoError;
+            result->done = true;
+        },
+        &result);
+    const auto deadline = std::chrono::steady_clock::now() + SWAP_CHAIN_SCOPE_TIMEOUT;
+    instance.ProcessEvents();
+    while (!result.done && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        instance.ProcessEvents();
+    }
+    if (!result.done) {
+        std::cout << "Swap chain validation didn't finish in time, assuming it passed\n";
+    }
+    return result.error ? wgpu::SwapChain() : swap_chain;
+}
+#endif
+
+wgpu::SwapChain create_swap_chain(const wgpu::Instance &instance,
+                                  const wgpu::Device &device,
+                                  const wgpu::Surface &surface,
+                                  uint32_t width,
+                                  uint32_t height,
+                                  SurfaceConfig &config)
+{
+    wgpu::SwapChainDescriptor swap_chain_desc;
+    swap_chain_desc.width = width;
+    swap_chain_desc.height = height;
+
+#ifdef __EMSCRIPTEN__
+    (void)instance;
+    // The browser always presents in sync with its compositor, and the adapter
+    // isn't needed to get the preferred canvas format
+    config.present_mode = wgpu::PresentMode::Fifo;
+    if (config.format == wgpu::TextureFormat::Undefined) {
+        config.format = surface.GetPreferredFormat(wgpu::Adapter());
+    }
+    swap_chain_desc.format = config.format;
+    swap_chain_desc.usage = config.usage;
+    swap_chain_desc.presentMode = config.present_mode;
+    return device.CreateSwapChain(surface, &swap_chain_desc);
+#else
+    // The format, usage and present mode were already found on a previous call, so
+    // swap chains recreated on resize don't probe the candidates again
+    if (config.resolved) {
+        swap_chain_desc.format = config.format;
+        swap_chain_desc.usage = config.usage;
+        swap_chain_desc.presentMode = config.present_mode;
+        return device.CreateSwapChain(surface, &swap_chain_desc);
+    }
+
+    const wgpu::TextureUsage supported_usage = device.GetSupportedSurfaceUsage(surface);
+    if ((config.usage & supported_usage) != config.usage) {
+        std::cout << "Surface does not support all requested usages, "
+                  << "dropping the unsupported ones\n";
+    }
+    config.usage = (config.usage & supported_usage) | wgpu::TextureUsage::RenderAttachment;
+
+    std::vector<wgpu::TextureFormat> formats;
+    if (config.format != wgpu::TextureFormat::Undefined) {
+        formats.push_back(config.format);
+    }
+    for (const auto &f : {wgpu::TextureFormat::BGRA8Unorm, wgpu::TextureFormat::RGBA8Unorm}) {
+        if (f != config.format) {
+            formats.push_back(f);
+        }
+    }
+
+    // Mailbox and Immediate both avoid blocking on vsync, so each is the better
+    // fallback for the other. Fifo is the one mode surfaces must support
+    std::vector<wgpu::PresentMode> present_modes = {config.present_mode};
+    if (config.present_mode == wgpu::PresentMode::Mailbox) {
+        present_modes.push_back(wgpu::PresentMode::Immediate);
+    } else if (config.present_mode == wgpu::PresentMode::Immediate) {
+        present_modes.push_back(wgpu::PresentMode::Mailbox);
+    }
+    if (config.present_mode != wgpu::PresentMode::Fifo) {
+        present_modes.push_back(wgpu::PresentMode::Fifo);
+    }
+
+    const SurfaceConfig requested = config;
+    for (const auto &format : formats) {
+        for (const auto &present_mode : present_modes) {
+            swap_chain_desc.format = format;
+            swap_chain_desc.usage = config.usage;
+            swap_chain_desc.presentMode = present_mode;
+            wgpu::SwapChain swap_chain =
+                try_create_swap_chain(instance, device, surface, swap_chain_desc);
+            if (!swap_chain) {
+                continue;
+            }
+
+            config.format = format;
+            config.present_mode = present_mode;
+            config.resolved = true;
+            if (requested.format != wgpu::TextureFormat::Undefined &&
+                requested.format != format) {
+                std::cout << "Surface format " << surface_format_name(requested.format)
+                          << " is not supported, using " << surface_format_name(format)
+                          << "\n";
+            }
+            if (requested.present_mode != present_mode) {
+                std::cout << "Present mode " << present_mode_name(requested.present_mode)
+                          << " is not supported, using " << present_mode_name(present_mode)
+                          << "\n";
+            }
+            return swap_chain;
+        }
+    }
+    std::cout << "Failed to create a swap chain for the surface\n";
+    return wgpu::SwapChain();
+#endif
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+struct SurfaceConfig {
+    wgpu::PresentMode present_mode = wgpu::PresentMode::Fifo;
+    // Undefined picks the surface's preferred format
+    wgpu::TextureFormat format = wgpu::TextureFormat::Undefined;
+    wgpu::TextureUsage usage = wgpu::TextureUsage::RenderAttachment;
+    // Set once create_swap_chain has found a format and present mode the surface
+    // accepts, later swap chains are created with them without probing again
+    bool resolved = false;
+};
+
+const char *present_mode_name(wgpu::PresentMode mode);
+
+const char *surface_format_name(wgpu::TextureFormat format);
+
+// Parse a present mode name: fifo, mailbox or immediate
+bool parse_present_mode(const std::string &name, wgpu::PresentMode &mode);
+
+// Parse a surface format name: bgra8unorm, rgba8unorm or rgba16float
+bool parse_surface_format(const std::string &name, wgpu::TextureFormat &format);
+
+/* Parse a comma separated list of texture usages (render, copy-src, copy-dst,
+ * texture-binding, storage), RenderAttachment is always included
+ */
+bool parse_surface_usage(const std::string &names, wgpu::TextureUsage &usage);
+
+/* Create a swap chain for the surface with the requested config, falling back to
+ * modes and formats the surface supports. The config is updated to what was
+ * actually created.
+ *
+ * This version of the API has no surface capability queries, so on native we
+ * try each candidate in a validation error scope until one is accepted, waiting
+ * a bounded time for each scope. This only happens on the first call, swap
+ * chains recreated on resize reuse the resolved config.
+ * Present modes fall back from Mailbox to Immediate (or vice versa) and then to
+ * Fifo, which is always supported. Formats fall back from the requested one to
+ * BGRA8Unorm and RGBA8Unorm. Usages not supported by the surface are dropped.
+ * On Emscripten the browser presents in Fifo and uses its preferred canvas format.
+ *
+ * Dawn's backends may also replace an unsupported present mode with one the
+ * surface supports without a validation error, so the config's present mode is
+ * the one requested of the accepted swap chain, not necessarily the one in use.
+ */
+wgpu::SwapChain create_swap_chain(const wgpu::Instance &instance,
+                                  const wgpu::Device &device,
+                                  const wgpu::Surface &surface,
+                                  uint32_t width,
+                                  uint32_t height,
+                                  SurfaceConfig &config);
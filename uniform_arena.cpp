@@ -0,0 +1,103 @@
+#include "uniform_arena.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "gpu_memory_tracker.h"
+
+static uint64_t align_to(uint64_t val, uint64_t align)
+{
+    return ((val + align - 1) / align) * align;
+}
+
+UniformArena::UniformArena(const wgpu::Device &device,
+                           uint32_t binding_size,
+                           wgpu::ShaderStage visibility,
+                           uint32_t initial_slices)
+    : device(device), binding_size(binding_size)
+{
+    wgpu::SupportedLimits limits;
+    device.GetLimits(&limits);
+    slice_stride =
+        align_to(binding_size, std::max(limits.limits.minUniformBufferOffsetAlignment, 1u));
+    capacity = uint64_t(slice_stride) * std::max(initial_slices, 1u);
+
+    wgpu::BindGroupLayoutEntry layout_entry = {};
+    layout_entry.binding = 0;
+    layout_entry.buffer.hasDynamicOffset = true;
+    layout_entry.buffer.type = wgpu::BufferBindingType::Uniform;
+    layout_entry.buffer.minBindingSize = binding_size;
+    layout_entry.visibility = visibility;
+
+    wgpu::BindGroupLayoutDescriptor layout_desc = {};
+    layout_desc.entryCount = 1;
+    layout_desc.entries = &layout_entry;
+    layout = device.CreateBindGroupLayout(&layout_desc);
+
+    allocate_buffer();
+}
+
+const wgpu::BindGroupLayout &UniformArena::bind_group_layout() const
+{
+    return layout;
+}
+
+const wgpu::BindGroup &UniformArena::bind_group() const
+{
+    return group;
+}
+
+void UniformArena::reset()
+{
+    cpu_data.clear();
+}
+
+uint32_t UniformArena::push(const void *data, uint32_t size)
+{
+    if (size > binding_size) {
+        throw std::runtime_error("UniformArena slice is larger than the binding size");
+    }
+    const uint64_t offset = cpu_data.size();
+    if (offset + slice_stride > capacity) {
+        while (offset + slice_stride > capacity) {
+            capacity *= 2;
+        }
+        allocate_buffer();
+    }
+    cpu_data.resize(offset + slice_stride, 0);
+    std::memcpy(cpu_data.data() + offset, data, size);
+    return offset;
+}
+
+uint32_t UniformArena::num_slices() const
+{
+    return cpu_data.size() / slice_stride;
+}
+
+void UniformArena::upload(StagingRing &staging_ring, const wgpu::CommandEncoder &encoder)
+{
+    if (cpu_data.empty()) {
+        return;
+    }
+    staging_ring.upload(encoder, buffer, 0, cpu_data.data(), cpu_data.size());
+}
+
+void UniformArena::allocate_buffer()
+{
+    wgpu::BufferDescriptor buffer_desc;
+    buffer_desc.mappedAtCreation = false;
+    buffer_desc.size = capacity;
+    buffer_desc.usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::CopyDst;
+    gpu_memory_release(buffer);
+    buffer = gpu_memory_create_buffer(device, buffer_desc, "uniform_arena");
+
+    wgpu::BindGroupEntry bg_entry = {};
+    bg_entry.binding = 0;
+    bg_entry.buffer = buffer;
+    bg_entry.size = binding_size;
+
+    wgpu::BindGroupDescriptor bind_group_desc = {};
+    bind_group_desc.layout = layout;
+    bind_group_desc.entryCount = 1;
+    bind_group_desc.entries = &bg_entry;
+    group = device.CreateBindGroup(&bind_group_desc);
+}
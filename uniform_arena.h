@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "staging_ring.h"
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+/* A per-frame arena of uniform data for per-draw parameters. All slices live in
+ * one uniform buffer that's bound through a single bind group using a dynamic
+ * offset, so each draw just passes its slice's offset to SetBindGroup. The slices
+ * are packed on the CPU and uploaded with one copy per frame.
+ */
+class UniformArena {
+    wgpu::Device device;
+    wgpu::BindGroupLayout layout;
+    wgpu::BindGroup group;
+    wgpu::Buffer buffer;
+
+    // The size of the uniform binding seen by the shader
+    uint32_t binding_size = 0;
+    // The distance between slices, respecting minUniformBufferOffsetAlignment
+    uint32_t slice_stride = 0;
+    uint64_t capacity = 0;
+
+    std::vector<uint8_t> cpu_data;
+
+public:
+    UniformArena() = default;
+
+    /* Create an arena of uniform slices binding_size bytes large, with initial room
+     * for initial_slices before the buffer must grow
+     */
+    UniformArena(const wgpu::Device &device,
+                 uint32_t binding_size,
+                 wgpu::ShaderStage visibility,
+                 uint32_t initial_slices = 256);
+
+    // Get the bind group layout, which has a single dynamic offset uniform buffer
+    const wgpu::BindGroupLayout &bind_group_layout() const;
+
+    /* Get the bind group to pass to SetBindGroup along with a slice's offset.
+     * The bind group may change when the arena grows, so it should be fetched after
+     * all of the frame's slices are pushed.
+     */
+    const wgpu::BindGroup &bind_group() const;
+
+    // Clear the slices pushed for the previous frame
+    void reset();
+
+    /* Push a slice of data into the arena, returns the dynamic offset to use
+     * when binding it. size must be at most binding_size.
+     */
+    uint32_t push(const void *data, uint32_t size);
+
+    // Get the number of slices pushed this frame
+    uint32_t num_slices() const;
+
+    // Upload the slices pushed this frame with a single copy
+    void upload(StagingRing &staging_ring, const wgpu::CommandEncoder &encoder);
+
+private:
+    // Create the uniform buffer and bind group for the current capacity
+    void allocate_buffer();
+};
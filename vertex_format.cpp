@@ -0,0 +1,296 @@
+#include "vertex_format.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+// The max angle between a normal and its octahedral encoding quantized to 8 and
+// 16 bit snorm, measured over a dense sampling of the sphere
+const float OCT_SNORM8_ERROR_DEGREES = 1.f;
+const float OCT_SNORM16_ERROR_DEGREES = 0.005f;
+
+uint32_t format_size(const wgpu::VertexFormat format)
+{
+    switch (format) {
+    case wgpu::VertexFormat::Snorm8x2:
+        return 2;
+    case wgpu::VertexFormat::Snorm8x4:
+    case wgpu::VertexFormat::Unorm8x4:
+    case wgpu::VertexFormat::Snorm16x2:
+        return 4;
+    case wgpu::VertexFormat::Snorm16x4:
+    case wgpu::VertexFormat::Unorm16x4:
+    case wgpu::VertexFormat::Float32x2:
+        return 8;
+    case wgpu::VertexFormat::Float32x3:
+        return 12;
+    case wgpu::VertexFormat::Float32x4:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+const char *format_name(const wgpu::VertexFormat format)
+{
+    switch (format) {
+    case wgpu::VertexFormat::Snorm8x2:
+        return "snorm8x2";
+    case wgpu::VertexFormat::Snorm8x4:
+        return "snorm8x4";
+    case wgpu::VertexFormat::Unorm8x4:
+        return "unorm8x4";
+    case wgpu::VertexFormat::Snorm16x2:
+        return "snorm16x2";
+    case wgpu::VertexFormat::Snorm16x4:
+        return "snorm16x4";
+    case wgpu::VertexFormat::Unorm16x4:
+        return "unorm16x4";
+    case wgpu::VertexFormat::Float32x2:
+        return "float32x2";
+    case wgpu::VertexFormat::Float32x3:
+        return "float32x3";
+    case wgpu::VertexFormat::Float32x4:
+        return "float32x4";
+    default:
+        return "undefined";
+    }
+}
+
+template <typename T>
+void store(char *dst, const T &value)
+{
+    std::memcpy(dst, &value, sizeof(T));
+}
+
+int32_t quantize_snorm(const float v, const int32_t max)
+{
+    return static_cast<int32_t>(std::round(glm::clamp(v, -1.f, 1.f) * max));
+}
+
+uint32_t quantize_unorm(const float v, const uint32_t max)
+{
+    return static_cast<uint32_t>(std::round(glm::clamp(v, 0.f, 1.f) * max));
+}
+
+// Write the components, n of them, in the format at dst
+void encode_components(const wgpu::VertexFormat format,
+                       const float *values,
+                       const uint32_t n,
+                       char *dst)
+{
+    switch (format) {
+    case wgpu::VertexFormat::Snorm8x2:
+    case wgpu::VertexFormat::Snorm8x4:
+        for (uint32_t i = 0; i < n; ++i) {
+            store(dst + i, static_cast<int8_t>(quantize_snorm(values[i], 127)));
+        }
+        break;
+    case wgpu::VertexFormat::Unorm8x4:
+        for (uint32_t i = 0; i < n; ++i) {
+            store(dst + i, static_cast<uint8_t>(quantize_unorm(values[i], 255)));
+        }
+        break;
+    case wgpu::VertexFormat::Snorm16x2:
+    case wgpu::VertexFormat::Snorm16x4:
+        for (uint32_t i = 0; i < n; ++i) {
+            store(dst + 2 * i, static_cast<int16_t>(quantize_snorm(values[i], 32767)));
+        }
+        break;
+    case wgpu::VertexFormat::Unorm16x4:
+        for (uint32_t i = 0; i < n; ++i) {
+            store(dst + 2 * i, static_cast<uint16_t>(quantize_unorm(values[i], 65535)));
+        }
+        break;
+    default:
+        std::memcpy(dst, values, n * sizeof(float));
+        break;
+    }
+}
+
+template <typename T>
+T load(const char *src)
+{
+    T value;
+    std::memcpy(&value, src, sizeof(T));
+    return value;
+}
+
+// Read the first n components of the format at src, the inverse of encode_components
+void decode_components(const wgpu::VertexFormat format,
+                       const char *src,
+                       const uint32_t n,
+                       float *values)
+{
+    switch (format) {
+    case wgpu::VertexFormat::Snorm8x2:
+    case wgpu::VertexFormat::Snorm8x4:
+        for (uint32_t i = 0; i < n; ++i) {
+            values[i] = std::max(load<int8_t>(src + i) / 127.f, -1.f);
+        }
+        break;
+    case wgpu::VertexFormat::Unorm8x4:
+        for (uint32_t i = 0; i < n; ++i) {
+            values[i] = load<uint8_t>(src + i) / 255.f;
+        }
+        break;
+    case wgpu::VertexFormat::Snorm16x2:
+    case wgpu::VertexFormat::Snorm16x4:
+        for (uint32_t i = 0; i < n; ++i) {
+            values[i] = std::max(load<int16_t>(src + 2 * i) / 32767.f, -1.f);
+        }
+        break;
+    case wgpu::VertexFormat::Unorm16x4:
+        for (uint32_t i = 0; i < n; ++i) {
+            values[i] = load<uint16_t>(src + 2 * i) / 65535.f;
+        }
+        break;
+    default:
+        std::memcpy(values, src, n * sizeof(float));
+        break;
+    }
+}
+
+}
+
+bool VertexFormat::has_normals() const
+{
+    return normal != wgpu::VertexFormat::Undefined;
+}
+
+std::vector<wgpu::VertexAttribute> VertexFormat::attributes() const
+{
+    std::vector<wgpu::VertexAttribute> attribs(has_normals() ? 3 : 2);
+    attribs[0].format = position;
+    attribs[0].offset = position_offset;
+    attribs[0].shaderLocation = 0;
+
+    attribs[1].format = color;
+    attribs[1].offset = color_offset;
+    attribs[1].shaderLocation = 1;
+
+    if (has_normals()) {
+        attribs[2].format = normal;
+        attribs[2].offset = normal_offset;
+        attribs[2].shaderLocation = 2;
+    }
+    return attribs;
+}
+
+std::string VertexFormat::name() const
+{
+    std::stringstream ss;
+    ss << format_name(position) << " position, " << format_name(color) << " color, ";
+    if (has_normals()) {
+        ss << "oct " << format_name(normal) << " normal, ";
+    }
+    ss << stride << " bytes";
+    return ss.str();
+}
+
+VertexFormat choose_vertex_format(const glm::vec3 &bounds_min,
+                                  const glm::vec3 &bounds_max,
+                                  const bool has_normals,
+                                  const VertexErrorBounds &error_bounds)
+{
+    VertexFormat format;
+
+    // Snorm positions span the bounds, so the rounding error is half a step of
+    // the largest half extent: 1 / (4 * max) of the largest extent
+    const glm::vec3 half_extent = 0.5f * (bounds_max - bounds_min);
+    if (error_bounds.position >= 1.f / (4.f * 127.f)) {
+        format.position = wgpu::VertexFormat::Snorm8x4;
+    } else if (error_bounds.position >= 1.f / (4.f * 32767.f)) {
+        format.position = wgpu::VertexFormat::Snorm16x4;
+    } else {
+        format.position = wgpu::VertexFormat::Float32x3;
+    }
+    if (format.position != wgpu::VertexFormat::Float32x3) {
+        // Flat axes still need a non-zero scale to decode
+        format.position_scale = glm::max(half_extent, glm::vec3(1e-30f));
+        format.position_bias = 0.5f * (bounds_min + bounds_max);
+    }
+
+    if (error_bounds.color >= 0.5f / 255.f) {
+        format.color = wgpu::VertexFormat::Unorm8x4;
+    } else if (error_bounds.color >= 0.5f / 65535.f) {
+        format.color = wgpu::VertexFormat::Unorm16x4;
+    } else {
+        format.color = wgpu::VertexFormat::Float32x4;
+    }
+
+    if (has_normals) {
+        if (error_bounds.normal_degrees >= OCT_SNORM8_ERROR_DEGREES) {
+            format.normal = wgpu::VertexFormat::Snorm8x2;
+        } else if (error_bounds.normal_degrees >= OCT_SNORM16_ERROR_DEGREES) {
+            format.normal = wgpu::VertexFormat::Snorm16x2;
+        } else {
+            format.normal = wgpu::VertexFormat::Float32x2;
+        }
+    }
+
+    // Each attribute's size is a multiple of the next one's alignment, and the
+    // stride must be a multiple of 4
+    format.position_offset = 0;
+    format.color_offset = format_size(format.position);
+    format.normal_offset = format.color_offset + format_size(format.color);
+    format.stride = format.normal_offset + format_size(format.normal);
+    format.stride = (format.stride + 3) & ~3u;
+    return format;
+}
+
+void encode_vertex(const VertexFormat &format,
+                   const glm::vec3 &position,
+                   const glm::vec3 &color,
+                   const glm::vec3 &normal,
+                   char *dst)
+{
+    // The w component of quantized positions is 1 and ignored by the shader
+    const glm::vec3 p = (position - format.position_bias) / format.position_scale;
+    const float position_values[4] = {p.x, p.y, p.z, 1.f};
+    encode_components(format.position,
+                      position_values,
+                      format.position == wgpu::VertexFormat::Float32x3 ? 3 : 4,
+                      dst + format.position_offset);
+
+    const float color_values[4] = {color.x, color.y, color.z, 1.f};
+    encode_components(format.color, color_values, 4, dst + format.color_offset);
+
+    if (format.has_normals()) {
+        const glm::vec2 e = oct_encode(normal);
+        const float normal_values[2] = {e.x, e.y};
+        encode_components(format.normal, normal_values, 2, dst + format.normal_offset);
+    }
+    const uint32_t end = format.has_normals()
+                             ? format.normal_offset + format_size(format.normal)
+                             : format.color_offset + format_size(format.color);
+    // Zero the padding so the buffer contents are deterministic
+    if (end < format.stride) {
+        std::memset(dst + end, 0, format.stride - end);
+    }
+}
+
+glm::vec3 decode_position(const VertexFormat &format, const char *vertex)
+{
+    float p[3];
+    decode_components(format.position, vertex + format.position_offset, 3, p);
+    return glm::vec3(p[0], p[1], p[2]) * format.position_scale + format.position_bias;
+}
+
+glm::vec2 oct_encode(const glm::vec3 &n)
+{
+    const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (l1 == 0.f) {
+        return glm::vec2(0.f);
+    }
+    glm::vec2 e(n.x / l1, n.y / l1);
+    // Fold the lower hemisphere over the diagonals
+    if (n.z < 0.f) {
+        const glm::vec2 folded(1.f - std::abs(e.y), 1.f - std::abs(e.x));
+        e.x = e.x >= 0.f ? folded.x : -folded.x;
+        e.y = e.y >= 0.f ? folded.y : -folded.y;
+    }
+    return e;
+}
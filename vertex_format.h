@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#ifdef __EMSCRIPTEN__
+#include <webgpu/webgpu_cpp.h>
+#else
+#include <dawn/webgpu_cpp.h>
+#endif
+
+/* The error allowed when quantizing each vertex attribute. Zero keeps the
+ * attribute at full precision.
+ */
+struct VertexErrorBounds {
+    // The max position error, as a fraction of the mesh's largest extent
+    float position = 1e-4f;
+    // The max error of each color channel
+    float color = 0.5f / 255.f;
+    // The max angle between a normal and its encoding, in degrees
+    float normal_degrees = 1.f;
+};
+
+/* The layout of a mesh's interleaved vertices, each a position, color and
+ * optional normal. Positions are quantized to snorm relative to the mesh's
+ * bounds and decoded by the shader as position * position_scale +
+ * position_bias, colors are quantized to unorm, and normals are octahedral
+ * encoded into two snorm components. The vertex fetch unpacks the normalized
+ * formats to floats, so the shader only applies the dequantization transform
+ * and decodes the normals.
+ */
+struct VertexFormat {
+    wgpu::VertexFormat position = wgpu::VertexFormat::Float32x3;
+    wgpu::VertexFormat color = wgpu::VertexFormat::Float32x4;
+    // Undefined if the mesh has no normals
+    wgpu::VertexFormat normal = wgpu::VertexFormat::Undefined;
+    uint32_t position_offset = 0;
+    uint32_t color_offset = 0;
+    uint32_t normal_offset = 0;
+    uint32_t stride = 0;
+    glm::vec3 position_scale = glm::vec3(1.f);
+    glm::vec3 position_bias = glm::vec3(0.f);
+
+    bool has_normals() const;
+
+    // Get the vertex attributes at shader locations 0 (position), 1 (color) and 2 (normal)
+    std::vector<wgpu::VertexAttribute> attributes() const;
+
+    // Describe the format, e.g. "snorm16x4 position, unorm8x4 color, 12 bytes"
+    std::string name() const;
+};
+
+/* Pick the most compact formats that keep each attribute within the error bounds
+ * for a mesh with the given position bounds
+ */
+VertexFormat choose_vertex_format(const glm::vec3 &bounds_min,
+                                  const glm::vec3 &bounds_max,
+                                  const bool has_normals,
+                                  const VertexErrorBounds &error_bounds);
+
+/* Write the vertex to dst in the format. The normal is ignored if the format has
+ * no normals, and must be unit length otherwise.
+ */
+void encode_vertex(const VertexFormat &format,
+                   const glm::vec3 &position,
+                   const glm::vec3 &color,
+                   const glm::vec3 &normal,
+                   char *dst);
+
+/* Read the position of a vertex in the format back as the shader sees it, after
+ * the vertex fetch unpacks it and the dequantization transform is applied
+ */
+glm::vec3 decode_position(const VertexFormat &format, const char *vertex);
+
+// Map a unit vector onto the octahedron unfolded into [-1, 1]^2
+glm::vec2 oct_encode(const glm::vec3 &n);
+
+// The size of the two float32x4 attributes vertices had before quantization
+const uint32_t UNQUANTIZED_VERTEX_SIZE = 32;
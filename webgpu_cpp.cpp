@@ -3,6 +3,10 @@
 
 #include "dawn/webgpu_cpp.h"
 
+#ifdef WGPU_CALL_COUNTERS
+#include "webgpu_cpp_instrumented.h"
+#endif
+
 #if defined(__GNUC__) || defined(__clang__)
 // error: 'offsetof' within non-standard-layout type 'wgpu::XXX' is conditionally-supported
 #pragma GCC diagnostic ignored "-Winvalid-offsetof"
@@ -0,0 +1,498 @@
+#pragma once
+
+/* Redirects the WebGPU C entry points called by webgpu_cpp.cpp through the call
+ * counters in wgpu_call_counters.h. This is included by webgpu_cpp.cpp after the
+ * WebGPU headers when building the webgpu_cpp_instrumented library, so only the
+ * calls made in the wrapper's function bodies are replaced. Each macro refers to
+ * the function it's named after in its expansion, which the preprocessor leaves
+ * as a call to the real function.
+ *
+ * The list covers every entry point called by webgpu_cpp.cpp and must be updated
+ * along with it.
+ */
+
+#include "wgpu_call_counters.h"
+
+// clang-format off
+#define WGPU_COUNTED_CALLS(X) \
+    X(wgpuAdapterCreateDevice) \
+    X(wgpuAdapterEnumerateFeatures) \
+    X(wgpuAdapterGetInstance) \
+    X(wgpuAdapterGetLimits) \
+    X(wgpuAdapterGetProperties) \
+    X(wgpuAdapterHasFeature) \
+    X(wgpuAdapterPropertiesFreeMembers) \
+    X(wgpuAdapterReference) \
+    X(wgpuAdapterRelease) \
+    X(wgpuAdapterRequestDevice) \
+    X(wgpuBindGroupLayoutReference) \
+    X(wgpuBindGroupLayoutRelease) \
+    X(wgpuBindGroupLayoutSetLabel) \
+    X(wgpuBindGroupReference) \
+    X(wgpuBindGroupRelease) \
+    X(wgpuBindGroupSetLabel) \
+    X(wgpuBufferDestroy) \
+    X(wgpuBufferGetConstMappedRange) \
+    X(wgpuBufferGetMapState) \
+    X(wgpuBufferGetMappedRange) \
+    X(wgpuBufferGetSize) \
+    X(wgpuBufferGetUsage) \
+    X(wgpuBufferMapAsync) \
+    X(wgpuBufferMapAsyncF) \
+    X(wgpuBufferReference) \
+    X(wgpuBufferRelease) \
+    X(wgpuBufferSetLabel) \
+    X(wgpuBufferUnmap) \
+    X(wgpuCommandBufferReference) \
+    X(wgpuCommandBufferRelease) \
+    X(wgpuCommandBufferSetLabel) \
+    X(wgpuCommandEncoderBeginComputePass) \
+    X(wgpuCommandEncoderBeginRenderPass) \
+    X(wgpuCommandEncoderClearBuffer) \
+    X(wgpuCommandEncoderCopyBufferToBuffer) \
+    X(wgpuCommandEncoderCopyBufferToTexture) \
+    X(wgpuCommandEncoderCopyTextureToBuffer) \
+    X(wgpuCommandEncoderCopyTextureToTexture) \
+    X(wgpuCommandEncoderFinish) \
+    X(wgpuCommandEncoderInjectValidationError) \
+    X(wgpuCommandEncoderInsertDebugMarker) \
+    X(wgpuCommandEncoderPopDebugGroup) \
+    X(wgpuCommandEncoderPushDebugGroup) \
+    X(wgpuCommandEncoderReference) \
+    X(wgpuCommandEncoderRelease) \
+    X(wgpuCommandEncoderResolveQuerySet) \
+    X(wgpuCommandEncoderSetLabel) \
+    X(wgpuCommandEncoderWriteBuffer) \
+    X(wgpuCommandEncoderWriteTimestamp) \
+    X(wgpuComputePassEncoderDispatchWorkgroups) \
+    X(wgpuComputePassEncoderDispatchWorkgroupsIndirect) \
+    X(wgpuComputePassEncoderEnd) \
+    X(wgpuComputePassEncoderInsertDebugMarker) \
+    X(wgpuComputePassEncoderPopDebugGroup) \
+    X(wgpuComputePassEncoderPushDebugGroup) \
+    X(wgpuComputePassEncoderReference) \
+    X(wgpuComputePassEncoderRelease) \
+    X(wgpuComputePassEncoderSetBindGroup) \
+    X(wgpuComputePassEncoderSetLabel) \
+    X(wgpuComputePassEncoderSetPipeline) \
+    X(wgpuComputePassEncoderWriteTimestamp) \
+    X(wgpuComputePipelineGetBindGroupLayout) \
+    X(wgpuComputePipelineReference) \
+    X(wgpuComputePipelineRelease) \
+    X(wgpuComputePipelineSetLabel) \
+    X(wgpuCreateInstance) \
+    X(wgpuDeviceCreateBindGroup) \
+    X(wgpuDeviceCreateBindGroupLayout) \
+    X(wgpuDeviceCreateBuffer) \
+    X(wgpuDeviceCreateCommandEncoder) \
+    X(wgpuDeviceCreateComputePipeline) \
+    X(wgpuDeviceCreateComputePipelineAsync) \
+    X(wgpuDeviceCreateErrorBuffer) \
+    X(wgpuDeviceCreateErrorExternalTexture) \
+    X(wgpuDeviceCreateErrorShaderModule) \
+    X(wgpuDeviceCreateErrorTexture) \
+    X(wgpuDeviceCreateExternalTexture) \
+    X(wgpuDeviceCreatePipelineLayout) \
+    X(wgpuDeviceCreateQuerySet) \
+    X(wgpuDeviceCreateRenderBundleEncoder) \
+    X(wgpuDeviceCreateRenderPipeline) \
+    X(wgpuDeviceCreateRenderPipelineAsync) \
+    X(wgpuDeviceCreateSampler) \
+    X(wgpuDeviceCreateShaderModule) \
+    X(wgpuDeviceCreateSwapChain) \
+    X(wgpuDeviceCreateTexture) \
+    X(wgpuDeviceDestroy) \
+    X(wgpuDeviceEnumerateFeatures) \
+    X(wgpuDeviceForceLoss) \
+    X(wgpuDeviceGetAdapter) \
+    X(wgpuDeviceGetLimits) \
+    X(wgpuDeviceGetQueue) \
+    X(wgpuDeviceGetSupportedSurfaceUsage) \
+    X(wgpuDeviceHasFeature) \
+    X(wgpuDeviceImportSharedFence) \
+    X(wgpuDeviceImportSharedTextureMemory) \
+    X(wgpuDeviceInjectError) \
+    X(wgpuDevicePopErrorScope) \
+    X(wgpuDevicePushErrorScope) \
+    X(wgpuDeviceReference) \
+    X(wgpuDeviceRelease) \
+    X(wgpuDeviceSetDeviceLostCallback) \
+    X(wgpuDeviceSetLabel) \
+    X(wgpuDeviceSetLoggingCallback) \
+    X(wgpuDeviceSetUncapturedErrorCallback) \
+    X(wgpuDeviceTick) \
+    X(wgpuDeviceValidateTextureDescriptor) \
+    X(wgpuExternalTextureDestroy) \
+    X(wgpuExternalTextureExpire) \
+    X(wgpuExternalTextureReference) \
+    X(wgpuExternalTextureRefresh) \
+    X(wgpuExternalTextureRelease) \
+    X(wgpuExternalTextureSetLabel) \
+    X(wgpuGetInstanceFeatures) \
+    X(wgpuGetProcAddress) \
+    X(wgpuInstanceCreateSurface) \
+    X(wgpuInstanceProcessEvents) \
+    X(wgpuInstanceReference) \
+    X(wgpuInstanceRelease) \
+    X(wgpuInstanceRequestAdapter) \
+    X(wgpuInstanceRequestAdapterF) \
+    X(wgpuInstanceWaitAny) \
+    X(wgpuPipelineLayoutReference) \
+    X(wgpuPipelineLayoutRelease) \
+    X(wgpuPipelineLayoutSetLabel) \
+    X(wgpuQuerySetDestroy) \
+    X(wgpuQuerySetGetCount) \
+    X(wgpuQuerySetGetType) \
+    X(wgpuQuerySetReference) \
+    X(wgpuQuerySetRelease) \
+    X(wgpuQuerySetSetLabel) \
+    X(wgpuQueueCopyExternalTextureForBrowser) \
+    X(wgpuQueueCopyTextureForBrowser) \
+    X(wgpuQueueOnSubmittedWorkDone) \
+    X(wgpuQueueOnSubmittedWorkDoneF) \
+    X(wgpuQueueReference) \
+    X(wgpuQueueRelease) \
+    X(wgpuQueueSetLabel) \
+    X(wgpuQueueSubmit) \
+    X(wgpuQueueWriteBuffer) \
+    X(wgpuQueueWriteTexture) \
+    X(wgpuRenderBundleEncoderDraw) \
+    X(wgpuRenderBundleEncoderDrawIndexed) \
+    X(wgpuRenderBundleEncoderDrawIndexedIndirect) \
+    X(wgpuRenderBundleEncoderDrawIndirect) \
+    X(wgpuRenderBundleEncoderFinish) \
+    X(wgpuRenderBundleEncoderInsertDebugMarker) \
+    X(wgpuRenderBundleEncoderPopDebugGroup) \
+    X(wgpuRenderBundleEncoderPushDebugGroup) \
+    X(wgpuRenderBundleEncoderReference) \
+    X(wgpuRenderBundleEncoderRelease) \
+    X(wgpuRenderBundleEncoderSetBindGroup) \
+    X(wgpuRenderBundleEncoderSetIndexBuffer) \
+    X(wgpuRenderBundleEncoderSetLabel) \
+    X(wgpuRenderBundleEncoderSetPipeline) \
+    X(wgpuRenderBundleEncoderSetVertexBuffer) \
+    X(wgpuRenderBundleReference) \
+    X(wgpuRenderBundleRelease) \
+    X(wgpuRenderBundleSetLabel) \
+    X(wgpuRenderPassEncoderBeginOcclusionQuery) \
+    X(wgpuRenderPassEncoderDraw) \
+    X(wgpuRenderPassEncoderDrawIndexed) \
+    X(wgpuRenderPassEncoderDrawIndexedIndirect) \
+    X(wgpuRenderPassEncoderDrawIndirect) \
+    X(wgpuRenderPassEncoderEnd) \
+    X(wgpuRenderPassEncoderEndOcclusionQuery) \
+    X(wgpuRenderPassEncoderExecuteBundles) \
+    X(wgpuRenderPassEncoderInsertDebugMarker) \
+    X(wgpuRenderPassEncoderPixelLocalStorageBarrier) \
+    X(wgpuRenderPassEncoderPopDebugGroup) \
+    X(wgpuRenderPassEncoderPushDebugGroup) \
+    X(wgpuRenderPassEncoderReference) \
+    X(wgpuRenderPassEncoderRelease) \
+    X(wgpuRenderPassEncoderSetBindGroup) \
+    X(wgpuRenderPassEncoderSetBlendConstant) \
+    X(wgpuRenderPassEncoderSetIndexBuffer) \
+    X(wgpuRenderPassEncoderSetLabel) \
+    X(wgpuRenderPassEncoderSetPipeline) \
+    X(wgpuRenderPassEncoderSetScissorRect) \
+    X(wgpuRenderPassEncoderSetStencilReference) \
+    X(wgpuRenderPassEncoderSetVertexBuffer) \
+    X(wgpuRenderPassEncoderSetViewport) \
+    X(wgpuRenderPassEncoderWriteTimestamp) \
+    X(wgpuRenderPipelineGetBindGroupLayout) \
+    X(wgpuRenderPipelineReference) \
+    X(wgpuRenderPipelineRelease) \
+    X(wgpuRenderPipelineSetLabel) \
+    X(wgpuSamplerReference) \
+    X(wgpuSamplerRelease) \
+    X(wgpuSamplerSetLabel) \
+    X(wgpuShaderModuleGetCompilationInfo) \
+    X(wgpuShaderModuleReference) \
+    X(wgpuShaderModuleRelease) \
+    X(wgpuShaderModuleSetLabel) \
+    X(wgpuSharedFenceExportInfo) \
+    X(wgpuSharedFenceReference) \
+    X(wgpuSharedFenceRelease) \
+    X(wgpuSharedTextureMemoryBeginAccess) \
+    X(wgpuSharedTextureMemoryCreateTexture) \
+    X(wgpuSharedTextureMemoryEndAccess) \
+    X(wgpuSharedTextureMemoryEndAccessStateFreeMembers) \
+    X(wgpuSharedTextureMemoryGetProperties) \
+    X(wgpuSharedTextureMemoryReference) \
+    X(wgpuSharedTextureMemoryRelease) \
+    X(wgpuSharedTextureMemorySetLabel) \
+    X(wgpuSurfaceReference) \
+    X(wgpuSurfaceRelease) \
+    X(wgpuSwapChainGetCurrentTexture) \
+    X(wgpuSwapChainGetCurrentTextureView) \
+    X(wgpuSwapChainPresent) \
+    X(wgpuSwapChainReference) \
+    X(wgpuSwapChainRelease) \
+    X(wgpuTextureCreateView) \
+    X(wgpuTextureDestroy) \
+    X(wgpuTextureGetDepthOrArrayLayers) \
+    X(wgpuTextureGetDimension) \
+    X(wgpuTextureGetFormat) \
+    X(wgpuTextureGetHeight) \
+    X(wgpuTextureGetMipLevelCount) \
+    X(wgpuTextureGetSampleCount) \
+    X(wgpuTextureGetUsage) \
+    X(wgpuTextureGetWidth) \
+    X(wgpuTextureReference) \
+    X(wgpuTextureRelease) \
+    X(wgpuTextureSetLabel) \
+    X(wgpuTextureViewReference) \
+    X(wgpuTextureViewRelease) \
+    X(wgpuTextureViewSetLabel)
+// clang-format on
+
+enum WgpuCallId {
+#define WGPU_CALL_ID(f) WGPU_CALL_##f,
+    WGPU_COUNTED_CALLS(WGPU_CALL_ID)
+#undef WGPU_CALL_ID
+    WGPU_CALL_COUNT
+};
+
+#define WGPU_COUNT_CALL(f, ...) (wgpu_counters_call(WGPU_CALL_##f), f(__VA_ARGS__))
+
+#define WGPU_COUNT_CREATE(f, type, ...) \
+    wgpu_counters_created(WGPU_CALL_##f, #type, f(__VA_ARGS__))
+
+#define WGPU_COUNT_REFERENCE(f, handle) \
+    (wgpu_counters_reference(WGPU_CALL_##f, handle), f(handle))
+
+#define WGPU_COUNT_RELEASE(f, type, handle) \
+    (wgpu_counters_release(WGPU_CALL_##f, #type, handle), f(handle))
+
+// clang-format off
+#define wgpuAdapterCreateDevice(...) WGPU_COUNT_CREATE(wgpuAdapterCreateDevice, Device, __VA_ARGS__)
+#define wgpuAdapterEnumerateFeatures(...) WGPU_COUNT_CALL(wgpuAdapterEnumerateFeatures, __VA_ARGS__)
+#define wgpuAdapterGetInstance(...) WGPU_COUNT_CREATE(wgpuAdapterGetInstance, Instance, __VA_ARGS__)
+#define wgpuAdapterGetLimits(...) WGPU_COUNT_CALL(wgpuAdapterGetLimits, __VA_ARGS__)
+#define wgpuAdapterGetProperties(...) WGPU_COUNT_CALL(wgpuAdapterGetProperties, __VA_ARGS__)
+#define wgpuAdapterHasFeature(...) WGPU_COUNT_CALL(wgpuAdapterHasFeature, __VA_ARGS__)
+#define wgpuAdapterPropertiesFreeMembers(...) WGPU_COUNT_CALL(wgpuAdapterPropertiesFreeMembers, __VA_ARGS__)
+#define wgpuAdapterReference(handle) WGPU_COUNT_REFERENCE(wgpuAdapterReference, handle)
+#define wgpuAdapterRelease(handle) WGPU_COUNT_RELEASE(wgpuAdapterRelease, Adapter, handle)
+#define wgpuAdapterRequestDevice(...) WGPU_COUNT_CALL(wgpuAdapterRequestDevice, __VA_ARGS__)
+#define wgpuBindGroupLayoutReference(handle) WGPU_COUNT_REFERENCE(wgpuBindGroupLayoutReference, handle)
+#define wgpuBindGroupLayoutRelease(handle) WGPU_COUNT_RELEASE(wgpuBindGroupLayoutRelease, BindGroupLayout, handle)
+#define wgpuBindGroupLayoutSetLabel(...) WGPU_COUNT_CALL(wgpuBindGroupLayoutSetLabel, __VA_ARGS__)
+#define wgpuBindGroupReference(handle) WGPU_COUNT_REFERENCE(wgpuBindGroupReference, handle)
+#define wgpuBindGroupRelease(handle) WGPU_COUNT_RELEASE(wgpuBindGroupRelease, BindGroup, handle)
+#define wgpuBindGroupSetLabel(...) WGPU_COUNT_CALL(wgpuBindGroupSetLabel, __VA_ARGS__)
+#define wgpuBufferDestroy(...) WGPU_COUNT_CALL(wgpuBufferDestroy, __VA_ARGS__)
+#define wgpuBufferGetConstMappedRange(...) WGPU_COUNT_CALL(wgpuBufferGetConstMappedRange, __VA_ARGS__)
+#define wgpuBufferGetMapState(...) WGPU_COUNT_CALL(wgpuBufferGetMapState, __VA_ARGS__)
+#define wgpuBufferGetMappedRange(...) WGPU_COUNT_CALL(wgpuBufferGetMappedRange, __VA_ARGS__)
+#define wgpuBufferGetSize(...) WGPU_COUNT_CALL(wgpuBufferGetSize, __VA_ARGS__)
+#define wgpuBufferGetUsage(...) WGPU_COUNT_CALL(wgpuBufferGetUsage, __VA_ARGS__)
+#define wgpuBufferMapAsync(...) WGPU_COUNT_CALL(wgpuBufferMapAsync, __VA_ARGS__)
+#define wgpuBufferMapAsyncF(...) WGPU_COUNT_CALL(wgpuBufferMapAsyncF, __VA_ARGS__)
+#define wgpuBufferReference(handle) WGPU_COUNT_REFERENCE(wgpuBufferReference, handle)
+#define wgpuBufferRelease(handle) WGPU_COUNT_RELEASE(wgpuBufferRelease, Buffer, handle)
+#define wgpuBufferSetLabel(...) WGPU_COUNT_CALL(wgpuBufferSetLabel, __VA_ARGS__)
+#define wgpuBufferUnmap(...) WGPU_COUNT_CALL(wgpuBufferUnmap, __VA_ARGS__)
+#define wgpuCommandBufferReference(handle) WGPU_COUNT_REFERENCE(wgpuCommandBufferReference, handle)
+#define wgpuCommandBufferRelease(handle) WGPU_COUNT_RELEASE(wgpuCommandBufferRelease, CommandBuffer, handle)
+#define wgpuCommandBufferSetLabel(...) WGPU_COUNT_CALL(wgpuCommandBufferSetLabel, __VA_ARGS__)
+#define wgpuCommandEncoderBeginComputePass(...) WGPU_COUNT_CREATE(wgpuCommandEncoderBeginComputePass, ComputePassEncoder, __VA_ARGS__)
+#define wgpuCommandEncoderBeginRenderPass(...) WGPU_COUNT_CREATE(wgpuCommandEncoderBeginRenderPass, RenderPassEncoder, __VA_ARGS__)
+#define wgpuCommandEncoderClearBuffer(...) WGPU_COUNT_CALL(wgpuCommandEncoderClearBuffer, __VA_ARGS__)
+#define wgpuCommandEncoderCopyBufferToBuffer(...) WGPU_COUNT_CALL(wgpuCommandEncoderCopyBufferToBuffer, __VA_ARGS__)
+#define wgpuCommandEncoderCopyBufferToTexture(...) WGPU_COUNT_CALL(wgpuCommandEncoderCopyBufferToTexture, __VA_ARGS__)
+#define wgpuCommandEncoderCopyTextureToBuffer(...) WGPU_COUNT_CALL(wgpuCommandEncoderCopyTextureToBuffer, __VA_ARGS__)
+#define wgpuCommandEncoderCopyTextureToTexture(...) WGPU_COUNT_CALL(wgpuCommandEncoderCopyTextureToTexture, __VA_ARGS__)
+#define wgpuCommandEncoderFinish(...) WGPU_COUNT_CREATE(wgpuCommandEncoderFinish, CommandBuffer, __VA_ARGS__)
+#define wgpuCommandEncoderInjectValidationError(...) WGPU_COUNT_CALL(wgpuCommandEncoderInjectValidationError, __VA_ARGS__)
+#define wgpuCommandEncoderInsertDebugMarker(...) WGPU_COUNT_CALL(wgpuCommandEncoderInsertDebugMarker, __VA_ARGS__)
+#define wgpuCommandEncoderPopDebugGroup(...) WGPU_COUNT_CALL(wgpuCommandEncoderPopDebugGroup, __VA_ARGS__)
+#define wgpuCommandEncoderPushDebugGroup(...) WGPU_COUNT_CALL(wgpuCommandEncoderPushDebugGroup, __VA_ARGS__)
+#define wgpuCommandEncoderReference(handle) WGPU_COUNT_REFERENCE(wgpuCommandEncoderReference, handle)
+#define wgpuCommandEncoderRelease(handle) WGPU_COUNT_RELEASE(wgpuCommandEncoderRelease, CommandEncoder, handle)
+#define wgpuCommandEncoderResolveQuerySet(...) WGPU_COUNT_CALL(wgpuCommandEncoderResolveQuerySet, __VA_ARGS__)
+#define wgpuCommandEncoderSetLabel(...) WGPU_COUNT_CALL(wgpuCommandEncoderSetLabel, __VA_ARGS__)
+#define wgpuCommandEncoderWriteBuffer(encoder, buffer, offset, data, size) \
+    (wgpu_counters_write(WGPU_CALL_wgpuCommandEncoderWriteBuffer, size), wgpuCommandEncoderWriteBuffer(encoder, buffer, offset, data, size))
+#define wgpuCommandEncoderWriteTimestamp(...) WGPU_COUNT_CALL(wgpuCommandEncoderWriteTimestamp, __VA_ARGS__)
+#define wgpuComputePassEncoderDispatchWorkgroups(...) WGPU_COUNT_CALL(wgpuComputePassEncoderDispatchWorkgroups, __VA_ARGS__)
+#define wgpuComputePassEncoderDispatchWorkgroupsIndirect(...) WGPU_COUNT_CALL(wgpuComputePassEncoderDispatchWorkgroupsIndirect, __VA_ARGS__)
+#define wgpuComputePassEncoderEnd(...) WGPU_COUNT_CALL(wgpuComputePassEncoderEnd, __VA_ARGS__)
+#define wgpuComputePassEncoderInsertDebugMarker(...) WGPU_COUNT_CALL(wgpuComputePassEncoderInsertDebugMarker, __VA_ARGS__)
+#define wgpuComputePassEncoderPopDebugGroup(...) WGPU_COUNT_CALL(wgpuComputePassEncoderPopDebugGroup, __VA_ARGS__)
+#define wgpuComputePassEncoderPushDebugGroup(...) WGPU_COUNT_CALL(wgpuComputePassEncoderPushDebugGroup, __VA_ARGS__)
+#define wgpuComputePassEncoderReference(handle) WGPU_COUNT_REFERENCE(wgpuComputePassEncoderReference, handle)
+#define wgpuComputePassEncoderRelease(handle) WGPU_COUNT_RELEASE(wgpuComputePassEncoderRelease, ComputePassEncoder, handle)
+#define wgpuComputePassEncoderSetBindGroup(...) WGPU_COUNT_CALL(wgpuComputePassEncoderSetBindGroup, __VA_ARGS__)
+#define wgpuComputePassEncoderSetLabel(...) WGPU_COUNT_CALL(wgpuComputePassEncoderSetLabel, __VA_ARGS__)
+#define wgpuComputePassEncoderSetPipeline(...) WGPU_COUNT_CALL(wgpuComputePassEncoderSetPipeline, __VA_ARGS__)
+#define wgpuComputePassEncoderWriteTimestamp(...) WGPU_COUNT_CALL(wgpuComputePassEncoderWriteTimestamp, __VA_ARGS__)
+#define wgpuComputePipelineGetBindGroupLayout(...) WGPU_COUNT_CREATE(wgpuComputePipelineGetBindGroupLayout, BindGroupLayout, __VA_ARGS__)
+#define wgpuComputePipelineReference(handle) WGPU_COUNT_REFERENCE(wgpuComputePipelineReference, handle)
+#define wgpuComputePipelineRelease(handle) WGPU_COUNT_RELEASE(wgpuComputePipelineRelease, ComputePipeline, handle)
+#define wgpuComputePipelineSetLabel(...) WGPU_COUNT_CALL(wgpuComputePipelineSetLabel, __VA_ARGS__)
+#define wgpuCreateInstance(...) WGPU_COUNT_CREATE(wgpuCreateInstance, Instance, __VA_ARGS__)
+#define wgpuDeviceCreateBindGroup(...) WGPU_COUNT_CREATE(wgpuDeviceCreateBindGroup, BindGroup, __VA_ARGS__)
+#define wgpuDeviceCreateBindGroupLayout(...) WGPU_COUNT_CREATE(wgpuDeviceCreateBindGroupLayout, BindGroupLayout, __VA_ARGS__)
+#define wgpuDeviceCreateBuffer(...) WGPU_COUNT_CREATE(wgpuDeviceCreateBuffer, Buffer, __VA_ARGS__)
+#define wgpuDeviceCreateCommandEncoder(...) WGPU_COUNT_CREATE(wgpuDeviceCreateCommandEncoder, CommandEncoder, __VA_ARGS__)
+#define wgpuDeviceCreateComputePipeline(...) WGPU_COUNT_CREATE(wgpuDeviceCreateComputePipeline, ComputePipeline, __VA_ARGS__)
+#define wgpuDeviceCreateComputePipelineAsync(...) WGPU_COUNT_CALL(wgpuDeviceCreateComputePipelineAsync, __VA_ARGS__)
+#define wgpuDeviceCreateErrorBuffer(...) WGPU_COUNT_CREATE(wgpuDeviceCreateErrorBuffer, Buffer, __VA_ARGS__)
+#define wgpuDeviceCreateErrorExternalTexture(...) WGPU_COUNT_CREATE(wgpuDeviceCreateErrorExternalTexture, ExternalTexture, __VA_ARGS__)
+#define wgpuDeviceCreateErrorShaderModule(...) WGPU_COUNT_CREATE(wgpuDeviceCreateErrorShaderModule, ShaderModule, __VA_ARGS__)
+#define wgpuDeviceCreateErrorTexture(...) WGPU_COUNT_CREATE(wgpuDeviceCreateErrorTexture, Texture, __VA_ARGS__)
+#define wgpuDeviceCreateExternalTexture(...) WGPU_COUNT_CREATE(wgpuDeviceCreateExternalTexture, ExternalTexture, __VA_ARGS__)
+#define wgpuDeviceCreatePipelineLayout(...) WGPU_COUNT_CREATE(wgpuDeviceCreatePipelineLayout, PipelineLayout, __VA_ARGS__)
+#define wgpuDeviceCreateQuerySet(...) WGPU_COUNT_CREATE(wgpuDeviceCreateQuerySet, QuerySet, __VA_ARGS__)
+#define wgpuDeviceCreateRenderBundleEncoder(...) WGPU_COUNT_CREATE(wgpuDeviceCreateRenderBundleEncoder, RenderBundleEncoder, __VA_ARGS__)
+#define wgpuDeviceCreateRenderPipeline(...) WGPU_COUNT_CREATE(wgpuDeviceCreateRenderPipeline, RenderPipeline, __VA_ARGS__)
+#define wgpuDeviceCreateRenderPipelineAsync(...) WGPU_COUNT_CALL(wgpuDeviceCreateRenderPipelineAsync, __VA_ARGS__)
+#define wgpuDeviceCreateSampler(...) WGPU_COUNT_CREATE(wgpuDeviceCreateSampler, Sampler, __VA_ARGS__)
+#define wgpuDeviceCreateShaderModule(...) WGPU_COUNT_CREATE(wgpuDeviceCreateShaderModule, ShaderModule, __VA_ARGS__)
+#define wgpuDeviceCreateSwapChain(...) WGPU_COUNT_CREATE(wgpuDeviceCreateSwapChain, SwapChain, __VA_ARGS__)
+#define wgpuDeviceCreateTexture(...) WGPU_COUNT_CREATE(wgpuDeviceCreateTexture, Texture, __VA_ARGS__)
+#define wgpuDeviceDestroy(...) WGPU_COUNT_CALL(wgpuDeviceDestroy, __VA_ARGS__)
+#define wgpuDeviceEnumerateFeatures(...) WGPU_COUNT_CALL(wgpuDeviceEnumerateFeatures, __VA_ARGS__)
+#define wgpuDeviceForceLoss(...) WGPU_COUNT_CALL(wgpuDeviceForceLoss, __VA_ARGS__)
+#define wgpuDeviceGetAdapter(...) WGPU_COUNT_CREATE(wgpuDeviceGetAdapter, Adapter, __VA_ARGS__)
+#define wgpuDeviceGetLimits(...) WGPU_COUNT_CALL(wgpuDeviceGetLimits, __VA_ARGS__)
+#define wgpuDeviceGetQueue(...) WGPU_COUNT_CREATE(wgpuDeviceGetQueue, Queue, __VA_ARGS__)
+#define wgpuDeviceGetSupportedSurfaceUsage(...) WGPU_COUNT_CALL(wgpuDeviceGetSupportedSurfaceUsage, __VA_ARGS__)
+#define wgpuDeviceHasFeature(...) WGPU_COUNT_CALL(wgpuDeviceHasFeature, __VA_ARGS__)
+#define wgpuDeviceImportSharedFence(...) WGPU_COUNT_CREATE(wgpuDeviceImportSharedFence, SharedFence, __VA_ARGS__)
+#define wgpuDeviceImportSharedTextureMemory(...) WGPU_COUNT_CREATE(wgpuDeviceImportSharedTextureMemory, SharedTextureMemory, __VA_ARGS__)
+#define wgpuDeviceInjectError(...) WGPU_COUNT_CALL(wgpuDeviceInjectError, __VA_ARGS__)
+#define wgpuDevicePopErrorScope(...) WGPU_COUNT_CALL(wgpuDevicePopErrorScope, __VA_ARGS__)
+#define wgpuDevicePushErrorScope(...) WGPU_COUNT_CALL(wgpuDevicePushErrorScope, __VA_ARGS__)
+#define wgpuDeviceReference(handle) WGPU_COUNT_REFERENCE(wgpuDeviceReference, handle)
+#define wgpuDeviceRelease(handle) WGPU_COUNT_RELEASE(wgpuDeviceRelease, Device, handle)
+#define wgpuDeviceSetDeviceLostCallback(...) WGPU_COUNT_CALL(wgpuDeviceSetDeviceLostCallback, __VA_ARGS__)
+#define wgpuDeviceSetLabel(...) WGPU_COUNT_CALL(wgpuDeviceSetLabel, __VA_ARGS__)
+#define wgpuDeviceSetLoggingCallback(...) WGPU_COUNT_CALL(wgpuDeviceSetLoggingCallback, __VA_ARGS__)
+#define wgpuDeviceSetUncapturedErrorCallback(...) WGPU_COUNT_CALL(wgpuDeviceSetUncapturedErrorCallback, __VA_ARGS__)
+#define wgpuDeviceTick(...) WGPU_COUNT_CALL(wgpuDeviceTick, __VA_ARGS__)
+#define wgpuDeviceValidateTextureDescriptor(...) WGPU_COUNT_CALL(wgpuDeviceValidateTextureDescriptor, __VA_ARGS__)
+#define wgpuExternalTextureDestroy(...) WGPU_COUNT_CALL(wgpuExternalTextureDestroy, __VA_ARGS__)
+#define wgpuExternalTextureExpire(...) WGPU_COUNT_CALL(wgpuExternalTextureExpire, __VA_ARGS__)
+#define wgpuExternalTextureReference(handle) WGPU_COUNT_REFERENCE(wgpuExternalTextureReference, handle)
+#define wgpuExternalTextureRefresh(...) WGPU_COUNT_CALL(wgpuExternalTextureRefresh, __VA_ARGS__)
+#define wgpuExternalTextureRelease(handle) WGPU_COUNT_RELEASE(wgpuExternalTextureRelease, ExternalTexture, handle)
+#define wgpuExternalTextureSetLabel(...) WGPU_COUNT_CALL(wgpuExternalTextureSetLabel, __VA_ARGS__)
+#define wgpuGetInstanceFeatures(...) WGPU_COUNT_CALL(wgpuGetInstanceFeatures, __VA_ARGS__)
+#define wgpuGetProcAddress(...) WGPU_COUNT_CALL(wgpuGetProcAddress, __VA_ARGS__)
+#define wgpuInstanceCreateSurface(...) WGPU_COUNT_CREATE(wgpuInstanceCreateSurface, Surface, __VA_ARGS__)
+#define wgpuInstanceProcessEvents(...) WGPU_COUNT_CALL(wgpuInstanceProcessEvents, __VA_ARGS__)
+#define wgpuInstanceReference(handle) WGPU_COUNT_REFERENCE(wgpuInstanceReference, handle)
+#define wgpuInstanceRelease(handle) WGPU_COUNT_RELEASE(wgpuInstanceRelease, Instance, handle)
+#define wgpuInstanceRequestAdapter(...) WGPU_COUNT_CALL(wgpuInstanceRequestAdapter, __VA_ARGS__)
+#define wgpuInstanceRequestAdapterF(...) WGPU_COUNT_CALL(wgpuInstanceRequestAdapterF, __VA_ARGS__)
+#define wgpuInstanceWaitAny(...) WGPU_COUNT_CALL(wgpuInstanceWaitAny, __VA_ARGS__)
+#define wgpuPipelineLayoutReference(handle) WGPU_COUNT_REFERENCE(wgpuPipelineLayoutReference, handle)
+#define wgpuPipelineLayoutRelease(handle) WGPU_COUNT_RELEASE(wgpuPipelineLayoutRelease, PipelineLayout, handle)
+#define wgpuPipelineLayoutSetLabel(...) WGPU_COUNT_CALL(wgpuPipelineLayoutSetLabel, __VA_ARGS__)
+#define wgpuQuerySetDestroy(...) WGPU_COUNT_CALL(wgpuQuerySetDestroy, __VA_ARGS__)
+#define wgpuQuerySetGetCount(...) WGPU_COUNT_CALL(wgpuQuerySetGetCount, __VA_ARGS__)
+#define wgpuQuerySetGetType(...) WGPU_COUNT_CALL(wgpuQuerySetGetType, __VA_ARGS__)
+#define wgpuQuerySetReference(handle) WGPU_COUNT_REFERENCE(wgpuQuerySetReference, handle)
+#define wgpuQuerySetRelease(handle) WGPU_COUNT_RELEASE(wgpuQuerySetRelease, QuerySet, handle)
+#define wgpuQuerySetSetLabel(...) WGPU_COUNT_CALL(wgpuQuerySetSetLabel, __VA_ARGS__)
+#define wgpuQueueCopyExternalTextureForBrowser(...) WGPU_COUNT_CALL(wgpuQueueCopyExternalTextureForBrowser, __VA_ARGS__)
+#define wgpuQueueCopyTextureForBrowser(...) WGPU_COUNT_CALL(wgpuQueueCopyTextureForBrowser, __VA_ARGS__)
+#define wgpuQueueOnSubmittedWorkDone(...) WGPU_COUNT_CALL(wgpuQueueOnSubmittedWorkDone, __VA_ARGS__)
+#define wgpuQueueOnSubmittedWorkDoneF(...) WGPU_COUNT_CALL(wgpuQueueOnSubmittedWorkDoneF, __VA_ARGS__)
+#define wgpuQueueReference(handle) WGPU_COUNT_REFERENCE(wgpuQueueReference, handle)
+#define wgpuQueueRelease(handle) WGPU_COUNT_RELEASE(wgpuQueueRelease, Queue, handle)
+#define wgpuQueueSetLabel(...) WGPU_COUNT_CALL(wgpuQueueSetLabel, __VA_ARGS__)
+#define wgpuQueueSubmit(...) WGPU_COUNT_CALL(wgpuQueueSubmit, __VA_ARGS__)
+#define wgpuQueueWriteBuffer(queue, buffer, offset, data, size) \
+    (wgpu_counters_write(WGPU_CALL_wgpuQueueWriteBuffer, size), wgpuQueueWriteBuffer(queue, buffer, offset, data, size))
+#define wgpuQueueWriteTexture(queue, destination, data, size, layout, extent) \
+    (wgpu_counters_write(WGPU_CALL_wgpuQueueWriteTexture, size), wgpuQueueWriteTexture(queue, destination, data, size, layout, extent))
+#define wgpuRenderBundleEncoderDraw(...) WGPU_COUNT_CALL(wgpuRenderBundleEncoderDraw, __VA_ARGS__)
+#define wgpuRenderBundleEncoderDrawIndexed(...) WGPU_COUNT_CALL(wgpuRenderBundleEncoderDrawIndexed, __VA_ARGS__)
+#define wgpuRenderBundleEncoderDrawIndexedIndirect(...) WGPU_COUNT_CALL(wgpuRenderBundleEncoderDrawIndexedIndirect, __VA_ARGS__)
+#define wgpuRenderBundleEncoderDrawIndirect(...) WGPU_COUNT_CALL(wgpuRenderBundleEncoderDrawIndirect, __VA_ARGS__)
+#define wgpuRenderBundleEncoderFinish(...) WGPU_COUNT_CREATE(wgpuRenderBundleEncoderFinish, RenderBundle, __VA_ARGS__)
+#define wgpuRenderBundleEncoderInsertDebugMarker(...) WGPU_COUNT_CALL(wgpuRenderBundleEncoderInsertDebugMarker, __VA_ARGS__)
+#define wgpuRenderBundleEncoderPopDebugGroup(...) WGPU_COUNT_CALL(wgpuRenderBundleEncoderPopDebugGroup, __VA_ARGS__)
+#define wgpuRenderBundleEncoderPushDebugGroup(...) WGPU_COUNT_CALL(wgpuRenderBundleEncoderPushDebugGroup, __VA_ARGS__)
+#define wgpuRenderBundleEncoderReference(handle) WGPU_COUNT_REFERENCE(wgpuRenderBundleEncoderReference, handle)
+#define wgpuRenderBundleEncoderRelease(handle) WGPU_COUNT_RELEASE(wgpuRenderBundleEncoderRelease, RenderBundleEncoder, handle)
+#define wgpuRenderBundleEncoderSetBindGroup(...) WGPU_COUNT_CALL(wgpuRenderBundleEncoderSetBindGroup, __VA_ARGS__)
+#define wgpuRenderBundleEncoderSetIndexBuffer(...) WGPU_COUNT_CALL(wgpuRenderBundleEncoderSetIndexBuffer, __VA_ARGS__)
+#define wgpuRenderBundleEncoderSetLabel(...) WGPU_COUNT_CALL(wgpuRenderBundleEncoderSetLabel, __VA_ARGS__)
+#define wgpuRenderBundleEncoderSetPipeline(...) WGPU_COUNT_CALL(wgpuRenderBundleEncoderSetPipeline, __VA_ARGS__)
+#define wgpuRenderBundleEncoderSetVertexBuffer(...) WGPU_COUNT_CALL(wgpuRenderBundleEncoderSetVertexBuffer, __VA_ARGS__)
+#define wgpuRenderBundleReference(handle) WGPU_COUNT_REFERENCE(wgpuRenderBundleReference, handle)
+#define wgpuRenderBundleRelease(handle) WGPU_COUNT_RELEASE(wgpuRenderBundleRelease, RenderBundle, handle)
+#define wgpuRenderBundleSetLabel(...) WGPU_COUNT_CALL(wgpuRenderBundleSetLabel, __VA_ARGS__)
+#define wgpuRenderPassEncoderBeginOcclusionQuery(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderBeginOcclusionQuery, __VA_ARGS__)
+#define wgpuRenderPassEncoderDraw(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderDraw, __VA_ARGS__)
+#define wgpuRenderPassEncoderDrawIndexed(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderDrawIndexed, __VA_ARGS__)
+#define wgpuRenderPassEncoderDrawIndexedIndirect(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderDrawIndexedIndirect, __VA_ARGS__)
+#define wgpuRenderPassEncoderDrawIndirect(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderDrawIndirect, __VA_ARGS__)
+#define wgpuRenderPassEncoderEnd(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderEnd, __VA_ARGS__)
+#define wgpuRenderPassEncoderEndOcclusionQuery(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderEndOcclusionQuery, __VA_ARGS__)
+#define wgpuRenderPassEncoderExecuteBundles(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderExecuteBundles, __VA_ARGS__)
+#define wgpuRenderPassEncoderInsertDebugMarker(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderInsertDebugMarker, __VA_ARGS__)
+#define wgpuRenderPassEncoderPixelLocalStorageBarrier(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderPixelLocalStorageBarrier, __VA_ARGS__)
+#define wgpuRenderPassEncoderPopDebugGroup(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderPopDebugGroup, __VA_ARGS__)
+#define wgpuRenderPassEncoderPushDebugGroup(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderPushDebugGroup, __VA_ARGS__)
+#define wgpuRenderPassEncoderReference(handle) WGPU_COUNT_REFERENCE(wgpuRenderPassEncoderReference, handle)
+#define wgpuRenderPassEncoderRelease(handle) WGPU_COUNT_RELEASE(wgpuRenderPassEncoderRelease, RenderPassEncoder, handle)
+#define wgpuRenderPassEncoderSetBindGroup(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderSetBindGroup, __VA_ARGS__)
+#define wgpuRenderPassEncoderSetBlendConstant(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderSetBlendConstant, __VA_ARGS__)
+#define wgpuRenderPassEncoderSetIndexBuffer(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderSetIndexBuffer, __VA_ARGS__)
+#define wgpuRenderPassEncoderSetLabel(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderSetLabel, __VA_ARGS__)
+#define wgpuRenderPassEncoderSetPipeline(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderSetPipeline, __VA_ARGS__)
+#define wgpuRenderPassEncoderSetScissorRect(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderSetScissorRect, __VA_ARGS__)
+#define wgpuRenderPassEncoderSetStencilReference(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderSetStencilReference, __VA_ARGS__)
+#define wgpuRenderPassEncoderSetVertexBuffer(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderSetVertexBuffer, __VA_ARGS__)
+#define wgpuRenderPassEncoderSetViewport(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderSetViewport, __VA_ARGS__)
+#define wgpuRenderPassEncoderWriteTimestamp(...) WGPU_COUNT_CALL(wgpuRenderPassEncoderWriteTimestamp, __VA_ARGS__)
+#define wgpuRenderPipelineGetBindGroupLayout(...) WGPU_COUNT_CREATE(wgpuRenderPipelineGetBindGroupLayout, BindGroupLayout, __VA_ARGS__)
+#define wgpuRenderPipelineReference(handle) WGPU_COUNT_REFERENCE(wgpuRenderPipelineReference, handle)
+#define wgpuRenderPipelineRelease(handle) WGPU_COUNT_RELEASE(wgpuRenderPipelineRelease, RenderPipeline, handle)
+#define wgpuRenderPipelineSetLabel(...) WGPU_COUNT_CALL(wgpuRenderPipelineSetLabel, __VA_ARGS__)
+#define wgpuSamplerReference(handle) WGPU_COUNT_REFERENCE(wgpuSamplerReference, handle)
+#define wgpuSamplerRelease(handle) WGPU_COUNT_RELEASE(wgpuSamplerRelease, Sampler, handle)
+#define wgpuSamplerSetLabel(...) WGPU_COUNT_CALL(wgpuSamplerSetLabel, __VA_ARGS__)
+#define wgpuShaderModuleGetCompilationInfo(...) WGPU_COUNT_CALL(wgpuShaderModuleGetCompilationInfo, __VA_ARGS__)
+#define wgpuShaderModuleReference(handle) WGPU_COUNT_REFERENCE(wgpuShaderModuleReference, handle)
+#define wgpuShaderModuleRelease(handle) WGPU_COUNT_RELEASE(wgpuShaderModuleRelease, ShaderModule, handle)
+#define wgpuShaderModuleSetLabel(...) WGPU_COUNT_CALL(wgpuShaderModuleSetLabel, __VA_ARGS__)
+#define wgpuSharedFenceExportInfo(...) WGPU_COUNT_CALL(wgpuSharedFenceExportInfo, __VA_ARGS__)
+#define wgpuSharedFenceReference(handle) WGPU_COUNT_REFERENCE(wgpuSharedFenceReference, handle)
+#define wgpuSharedFenceRelease(handle) WGPU_COUNT_RELEASE(wgpuSharedFenceRelease, SharedFence, handle)
+#define wgpuSharedTextureMemoryBeginAccess(...) WGPU_COUNT_CALL(wgpuSharedTextureMemoryBeginAccess, __VA_ARGS__)
+#define wgpuSharedTextureMemoryCreateTexture(...) WGPU_COUNT_CREATE(wgpuSharedTextureMemoryCreateTexture, Texture, __VA_ARGS__)
+#define wgpuSharedTextureMemoryEndAccess(...) WGPU_COUNT_CALL(wgpuSharedTextureMemoryEndAccess, __VA_ARGS__)
+#define wgpuSharedTextureMemoryEndAccessStateFreeMembers(...) WGPU_COUNT_CALL(wgpuSharedTextureMemoryEndAccessStateFreeMembers, __VA_ARGS__)
+#define wgpuSharedTextureMemoryGetProperties(...) WGPU_COUNT_CALL(wgpuSharedTextureMemoryGetProperties, __VA_ARGS__)
+#define wgpuSharedTextureMemoryReference(handle) WGPU_COUNT_REFERENCE(wgpuSharedTextureMemoryReference, handle)
+#define wgpuSharedTextureMemoryRelease(handle) WGPU_COUNT_RELEASE(wgpuSharedTextureMemoryRelease, SharedTextureMemory, handle)
+#define wgpuSharedTextureMemorySetLabel(...) WGPU_COUNT_CALL(wgpuSharedTextureMemorySetLabel, __VA_ARGS__)
+#define wgpuSurfaceReference(handle) WGPU_COUNT_REFERENCE(wgpuSurfaceReference, handle)
+#define wgpuSurfaceRelease(handle) WGPU_COUNT_RELEASE(wgpuSurfaceRelease, Surface, handle)
+#define wgpuSwapChainGetCurrentTexture(...) WGPU_COUNT_CREATE(wgpuSwapChainGetCurrentTexture, Texture, __VA_ARGS__)
+#define wgpuSwapChainGetCurrentTextureView(...) WGPU_COUNT_CREATE(wgpuSwapChainGetCurrentTextureView, TextureView, __VA_ARGS__)
+#define wgpuSwapChainPresent(...) WGPU_COUNT_CALL(wgpuSwapChainPresent, __VA_ARGS__)
+#define wgpuSwapChainReference(handle) WGPU_COUNT_REFERENCE(wgpuSwapChainReference, handle)
+#define wgpuSwapChainRelease(handle) WGPU_COUNT_RELEASE(wgpuSwapChainRelease, SwapChain, handle)
+#define wgpuTextureCreateView(...) WGPU_COUNT_CREATE(wgpuTextureCreateView, TextureView, __VA_ARGS__)
+#define wgpuTextureDestroy(...) WGPU_COUNT_CALL(wgpuTextureDestroy, __VA_ARGS__)
+#define wgpuTextureGetDepthOrArrayLayers(...) WGPU_COUNT_CALL(wgpuTextureGetDepthOrArrayLayers, __VA_ARGS__)
+#define wgpuTextureGetDimension(...) WGPU_COUNT_CALL(wgpuTextureGetDimension, __VA_ARGS__)
+#define wgpuTextureGetFormat(...) WGPU_COUNT_CALL(wgpuTextureGetFormat, __VA_ARGS__)
+#define wgpuTextureGetHeight(...) WGPU_COUNT_CALL(wgpuTextureGetHeight, __VA_ARGS__)
+#define wgpuTextureGetMipLevelCount(...) WGPU_COUNT_CALL(wgpuTextureGetMipLevelCount, __VA_ARGS__)
+#define wgpuTextureGetSampleCount(...) WGPU_COUNT_CALL(wgpuTextureGetSampleCount, __VA_ARGS__)
+#define wgpuTextureGetUsage(...) WGPU_COUNT_CALL(wgpuTextureGetUsage, __VA_ARGS__)
+#define wgpuTextureGetWidth(...) WGPU_COUNT_CALL(wgpuTextureGetWidth, __VA_ARGS__)
+#define wgpuTextureReference(handle) WGPU_COUNT_REFERENCE(wgpuTextureReference, handle)
+#define wgpuTextureRelease(handle) WGPU_COUNT_RELEASE(wgpuTextureRelease, Texture, handle)
+#define wgpuTextureSetLabel(...) WGPU_COUNT_CALL(wgpuTextureSetLabel, __VA_ARGS__)
+#define wgpuTextureViewReference(handle) WGPU_COUNT_REFERENCE(wgpuTextureViewReference, handle)
+#define wgpuTextureViewRelease(handle) WGPU_COUNT_RELEASE(wgpuTextureViewRelease, TextureView, handle)
+#define wgpuTextureViewSetLabel(...) WGPU_COUNT_CALL(wgpuTextureViewSetLabel, __VA_ARGS__)
+// clang-format on
@@ -0,0 +1,191 @@
+#include "wgpu_call_counters.h"
+
+#ifdef WGPU_CALL_COUNTERS
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include "webgpu_cpp_instrumented.h"
+
+namespace {
+
+const char *call_names[] = {
+#define WGPU_CALL_NAME(f) #f,
+    WGPU_COUNTED_CALLS(WGPU_CALL_NAME)
+#undef WGPU_CALL_NAME
+};
+
+// Calls can come from any thread (e.g. the parallel recorder's workers), so the
+// hot counters are atomics and only object lifetime tracking takes a lock
+std::atomic<uint64_t> call_counts[WGPU_CALL_COUNT];
+std::atomic<uint64_t> bytes_written(0);
+std::atomic<uint64_t> references(0);
+std::atomic<uint64_t> releases(0);
+
+struct LiveObject {
+    const char *type = nullptr;
+    uint64_t refs = 0;
+};
+
+std::mutex objects_mutex;
+std::unordered_map<const void *, LiveObject> live_objects;
+std::map<std::string, uint64_t> created;
+std::map<std::string, uint64_t> destroyed;
+
+WgpuFrameCounters last_frame;
+
+// Totals over all frames for the summary
+uint64_t num_frames = 0;
+WgpuFrameCounters totals;
+std::map<std::string, uint64_t> total_calls;
+
+void print_objects(std::ostream &os,
+                   const char *label,
+                   const std::map<std::string, uint64_t> &objects,
+                   double scale)
+{
+    if (objects.empty()) {
+        return;
+    }
+    os << "  " << label << ":";
+    for (const auto &o : objects) {
+        os << " " << o.first << " " << o.second * scale;
+    }
+    os << "\n";
+}
+
+}
+
+void wgpu_counters_call(uint32_t call)
+{
+    call_counts[call].fetch_add(1, std::memory_order_relaxed);
+}
+
+void wgpu_counters_write(uint32_t call, uint64_t bytes)
+{
+    wgpu_counters_call(call);
+    bytes_written.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void wgpu_counters_create(uint32_t call, const char *type, const void *handle)
+{
+    wgpu_counters_call(call);
+    if (!handle) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(objects_mutex);
+    LiveObject &obj = live_objects[handle];
+    obj.type = type;
+    obj.refs = 1;
+    ++created[type];
+}
+
+void wgpu_counters_reference(uint32_t call, const void *handle)
+{
+    wgpu_counters_call(call);
+    references.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(objects_mutex);
+    auto fnd = live_objects.find(handle);
+    if (fnd != live_objects.end()) {
+        ++fnd->second.refs;
+    }
+}
+
+void wgpu_counters_release(uint32_t call, const char *type, const void *handle)
+{
+    wgpu_counters_call(call);
+    releases.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(objects_mutex);
+    auto fnd = live_objects.find(handle);
+    if (fnd != live_objects.end() && --fnd->second.refs == 0) {
+        ++destroyed[type];
+        live_objects.erase(fnd);
+    }
+}
+
+void wgpu_counters_end_frame()
+{
+    WgpuFrameCounters frame;
+    frame.frame = num_frames++;
+    for (size_t i = 0; i < WGPU_CALL_COUNT; ++i) {
+        const uint64_t n = call_counts[i].exchange(0, std::memory_order_relaxed);
+        if (n > 0) {
+            frame.calls.push_back(std::make_pair(std::string(call_names[i]), n));
+            frame.total_calls += n;
+            total_calls[call_names[i]] += n;
+        }
+    }
+    std::sort(frame.calls.begin(),
+              frame.calls.end(),
+              [](const std::pair<std::string, uint64_t> &a,
+                 const std::pair<std::string, uint64_t> &b) { return a.second > b.second; });
+
+    frame.bytes_written = bytes_written.exchange(0, std::memory_order_relaxed);
+    frame.references = references.exchange(0, std::memory_order_relaxed);
+    frame.releases = releases.exchange(0, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(objects_mutex);
+        frame.objects_created.swap(created);
+        frame.objects_destroyed.swap(destroyed);
+    }
+
+    totals.total_calls += frame.total_calls;
+    totals.bytes_written += frame.bytes_written;
+    totals.references += frame.references;
+    totals.releases += frame.releases;
+    for (const auto &o : frame.objects_created) {
+        totals.objects_created[o.first] += o.second;
+    }
+    for (const auto &o : frame.objects_destroyed) {
+        totals.objects_destroyed[o.first] += o.second;
+    }
+
+    last_frame = frame;
+}
+
+const WgpuFrameCounters &wgpu_counters_last_frame()
+{
+    return last_frame;
+}
+
+void wgpu_counters_print_frame(std::ostream &os)
+{
+    const WgpuFrameCounters &f = last_frame;
+    os << "WebGPU calls in frame " << f.frame << ": " << f.total_calls << " calls, "
+       << f.bytes_written << " bytes written, " << f.references << " references, "
+       << f.releases << " releases\n";
+    print_objects(os, "created", f.objects_created, 1.0);
+    print_objects(os, "destroyed", f.objects_destroyed, 1.0);
+    for (const auto &c : f.calls) {
+        os << "  " << c.first << ": " << c.second << "\n";
+    }
+}
+
+void wgpu_counters_print_summary(std::ostream &os)
+{
+    if (num_frames == 0) {
+        return;
+    }
+    const double scale = 1.0 / num_frames;
+    os << "WebGPU calls per frame over " << num_frames << " frames: "
+       << totals.total_calls * scale << " calls, " << totals.bytes_written * scale
+       << " bytes written, " << totals.references * scale << " references, "
+       << totals.releases * scale << " releases\n";
+    print_objects(os, "created", totals.objects_created, scale);
+    print_objects(os, "destroyed", totals.objects_destroyed, scale);
+
+    std::vector<std::pair<std::string, uint64_t>> calls(total_calls.begin(),
+                                                        total_calls.end());
+    std::sort(calls.begin(),
+              calls.end(),
+              [](const std::pair<std::string, uint64_t> &a,
+                 const std::pair<std::string, uint64_t> &b) { return a.second > b.second; });
+    for (const auto &c : calls) {
+        os << "  " << c.first << ": " << c.second * scale << "\n";
+    }
+}
+
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Per-frame counters of the WebGPU API traffic going through the webgpu_cpp
+ * wrapper: the number of calls to each entry point, bytes passed to WriteBuffer
+ * and WriteTexture, objects created and destroyed by type, and reference/release
+ * churn. Counting is only compiled in when linking the webgpu_cpp_instrumented
+ * library (the WEBGPU_CPP_INSTRUMENTED CMake option), which defines
+ * WGPU_CALL_COUNTERS. Otherwise the functions are empty.
+ *
+ * Objects are tracked by handle from their creation through the wrapper until
+ * the wrapper releases its last reference, so objects only referenced from
+ * outside the wrapper aren't counted as destroyed.
+ */
+
+struct WgpuFrameCounters {
+    uint64_t frame = 0;
+    uint64_t total_calls = 0;
+    // The calls made during the frame and their counts, most frequent first
+    std::vector<std::pair<std::string, uint64_t>> calls;
+    uint64_t bytes_written = 0;
+    std::map<std::string, uint64_t> objects_created;
+    std::map<std::string, uint64_t> objects_destroyed;
+    uint64_t references = 0;
+    uint64_t releases = 0;
+};
+
+#ifdef WGPU_CALL_COUNTERS
+
+// Hooks called by the instrumented webgpu_cpp.cpp, see webgpu_cpp_instrumented.h
+void wgpu_counters_call(uint32_t call);
+
+void wgpu_counters_write(uint32_t call, uint64_t bytes);
+
+void wgpu_counters_create(uint32_t call, const char *type, const void *handle);
+
+template <typename T>
+T wgpu_counters_created(uint32_t call, const char *type, T handle)
+{
+    wgpu_counters_create(call, type, handle);
+    return handle;
+}
+
+void wgpu_counters_reference(uint32_t call, const void *handle);
+
+void wgpu_counters_release(uint32_t call, const char *type, const void *handle);
+
+/* Mark the end of a frame, moving the counts accumulated since the last call
+ * into the frame returned by wgpu_counters_last_frame
+ */
+void wgpu_counters_end_frame();
+
+const WgpuFrameCounters &wgpu_counters_last_frame();
+
+// Print the counters of the last frame
+void wgpu_counters_print_frame(std::ostream &os);
+
+// Print the average per-frame counts over all frames ended so far
+void wgpu_counters_print_summary(std::ostream &os);
+
+#else
+
+inline void wgpu_counters_end_frame() {}
+
+inline const WgpuFrameCounters &wgpu_counters_last_frame()
+{
+    static const WgpuFrameCounters empty;
+    return empty;
+}
+
+inline void wgpu_counters_print_frame(std::ostream &) {}
+
+inline void wgpu_counters_print_summary(std::ostream &) {}
+
+#endif